@@ -372,8 +372,16 @@ SRC_C += ../../../component/common/file_system/fatfs/disk_if/src/sdcard.c
 SRC_C += ../../../component/common/application/xmodem/uart_fw_update.c
 #user 
 SRC_C += ../src/ws2812.c
+SRC_C += ../src/noise.c
+SRC_C += ../src/fixmath.c
+SRC_C += ../src/vm.c
+SRC_C += ../src/crc32.c
+SRC_C += ../src/cfglog.c
+SRC_C += ../src/audio.c
 SRC_C += ../src/blinken.c
 SRC_C += ../src/blinkensrv.c
+SRC_C += ../src/assets.c
+SRC_C += ../src/json.c
 
 # Generate obj list
 # -------------------------------------------------------------------
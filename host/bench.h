@@ -0,0 +1,64 @@
+/**
+ * RTL8710 Blinkenlights. WiFi-controlled WS2812B LED strip.
+ * Copyright (C) 2016  Tido Klaassen <tido@4gh.eu>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+#ifndef __BENCH_H__
+#define __BENCH_H__
+
+/* Timing helpers shared by the host benchmarks. */
+#include <stdint.h>
+#include <time.h>
+
+/* Default target for LED count estimates: the RTL8710's Cortex-M3 and
+ * a guess for how many of its cycles one host cycle is worth. */
+#define TARGET_MHZ_DEF      166.0
+#define TARGET_RATIO_DEF    3.0
+#define TARGET_FPS          60.0
+
+static inline double bench_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+#define HAVE_CYCLES 1
+static inline uint64_t bench_cycles(void)
+{
+    uint32_t lo, hi;
+
+    __asm__ volatile("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((uint64_t) hi << 32) | lo;
+}
+#else
+#define HAVE_CYCLES 0
+static inline uint64_t bench_cycles(void)
+{
+    return 0;
+}
+#endif
+
+/* Host cycles spent for a run, assuming a 3 GHz host if there is no
+ * cycle counter. */
+static inline double bench_host_cycles(uint64_t cycles, double secs)
+{
+    return HAVE_CYCLES ? (double) cycles : secs * 3e9;
+}
+
+#endif
@@ -0,0 +1,231 @@
+/**
+ * RTL8710 Blinkenlights. WiFi-controlled WS2812B LED strip.
+ * Copyright (C) 2016  Tido Klaassen <tido@4gh.eu>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/* Host benchmark and test bench for the audio analysis.
+ *
+ * Without a file, runs the analysis for every supported FFT size and
+ * reports its cost next to the time and frequency resolution it buys.
+ * The target estimate is the share of a 60 FPS frame the analysis would
+ * take, what is left has to cover the filters and ws2812_send().
+ *
+ * With -w, plays a 16 bit PCM WAV file through the sample ring at the
+ * firmware's frame rate and prints the per-frame results as CSV, which
+ * helps tuning the beat threshold (-t, 8 fractional bits).
+ *
+ * Usage: bench_fft [-m target MHz] [-r ratio]
+ *        bench_fft [-l log2 size] [-t threshold] -w file.wav
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+#include "bench.h"
+#include "wav.h"
+#include "audio.h"
+
+#define FRAME_MS        10      // BLINKEN_FRAME_MS
+#define ITERATIONS      2000
+
+static int16_t re[AUDIO_FFT_MAX];
+static int16_t im[AUDIO_FFT_MAX];
+static struct audio_ring ring;
+
+/* a bass drum every half second over a tone and some noise */
+static void fill_ring(void)
+{
+    int16_t sample;
+    unsigned int i;
+    double t, kick;
+
+    for(i = 0; i < AUDIO_RING_SIZE; ++i){
+        t = (double) i / AUDIO_RATE;
+        kick = exp(-fmod(t, 0.5) * 20.0) * sin(2 * M_PI * 60.0 * t);
+        sample = (int16_t) (8000.0 * kick
+                            + 3000.0 * sin(2 * M_PI * 1200.0 * t)
+                            + (rand() % 2001) - 1000);
+        audio_ring_put(&ring, &sample, 1);
+    }
+}
+
+static int bench(double mhz, double ratio)
+{
+    struct audio_state st;
+    struct audio_frame frame;
+    unsigned int log2n, n, i;
+    double start, secs, budget, fft_cyc, frame_cyc;
+    uint64_t cstart, cycles;
+
+    fill_ring();
+    budget = mhz * 1e6 / TARGET_FPS;
+
+    printf("target %.0f MHz, %.1fx host cycles, %.0f cycles per frame\n",
+           mhz, ratio, budget);
+    printf("%6s %9s %8s %12s %12s %14s\n", "size", "window ms", "Hz/bin",
+           "fft cycles", "analysis", "target %frame");
+
+    for(log2n = AUDIO_FFT_MIN_LOG2; log2n <= AUDIO_FFT_MAX_LOG2; ++log2n){
+        n = 1u << log2n;
+
+        /* the FFT on its own, refilling its input every time */
+        start = bench_now();
+        cstart = bench_cycles();
+        for(i = 0; i < ITERATIONS; ++i){
+            audio_ring_get(&ring, re, n);
+            memset(im, 0x0, n * sizeof(*im));
+            audio_fft(re, im, log2n);
+        }
+        cycles = bench_cycles() - cstart;
+        secs = bench_now() - start;
+        fft_cyc = bench_host_cycles(cycles, secs) / ITERATIONS;
+
+        /* everything the render task does per frame */
+        audio_init(&st, log2n, re, im);
+        start = bench_now();
+        cstart = bench_cycles();
+        for(i = 0; i < ITERATIONS; ++i){
+            audio_analyse(&st, &ring, FRAME_MS, &frame);
+        }
+        cycles = bench_cycles() - cstart;
+        secs = bench_now() - start;
+        frame_cyc = bench_host_cycles(cycles, secs) / ITERATIONS;
+
+        printf("%6u %9.1f %8.1f %12.0f %12.0f %14.2f\n", n,
+               n * 1000.0 / AUDIO_RATE, (double) AUDIO_RATE / n,
+               fft_cyc, frame_cyc, frame_cyc * ratio * 100.0 / budget);
+    }
+
+    return EXIT_SUCCESS;
+}
+
+static int play(const char *name, unsigned int log2n, uint32_t threshold)
+{
+    struct wav_file wav;
+    struct audio_state st;
+    struct audio_frame frame;
+    int16_t in[256], out;
+    unsigned int i, got, per_frame, produced, ms;
+    uint32_t phase, step;
+
+    if(wav_open(&wav, name) != 0){
+        return EXIT_FAILURE;
+    }
+
+    if(audio_init(&st, log2n, re, im) != 0){
+        fprintf(stderr, "FFT size out of range\n");
+        wav_close(&wav);
+        return EXIT_FAILURE;
+    }
+    st.threshold = threshold;
+
+    /* nearest sample resampling to the firmware's rate, 16 bit fraction */
+    step = (uint32_t) (((uint64_t) wav.rate << 16) / AUDIO_RATE);
+    per_frame = AUDIO_RATE * FRAME_MS / 1000;
+
+    printf("ms,level");
+    for(i = 0; i < AUDIO_BANDS; ++i){
+        printf(",band%u", i);
+    }
+    printf(",beat,onset\n");
+
+    phase = 0;
+    got = 0;
+    ms = 0;
+    while(1){
+        for(produced = 0; produced < per_frame; ++produced){
+            while((phase >> 16) >= got){
+                phase -= got << 16;
+                got = wav_read(&wav, in, sizeof(in) / sizeof(*in));
+                if(got == 0){
+                    goto out;
+                }
+            }
+
+            out = in[phase >> 16];
+            audio_ring_put(&ring, &out, 1);
+            phase += step;
+        }
+
+        audio_analyse(&st, &ring, FRAME_MS, &frame);
+        ms += FRAME_MS;
+
+        printf("%u,%u", ms, frame.level);
+        for(i = 0; i < AUDIO_BANDS; ++i){
+            printf(",%u", frame.band[i]);
+        }
+        printf(",%u,%u\n", frame.beat, frame.onset);
+    }
+
+out:
+    wav_close(&wav);
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char *argv[])
+{
+    double mhz, ratio;
+    unsigned int log2n;
+    uint32_t threshold;
+    char *wav;
+    int opt;
+
+    mhz = TARGET_MHZ_DEF;
+    ratio = TARGET_RATIO_DEF;
+    log2n = AUDIO_FFT_LOG2;
+    threshold = AUDIO_THRESHOLD_DEF;
+    wav = NULL;
+
+    while((opt = getopt(argc, argv, "m:r:l:t:w:")) != -1){
+        switch(opt){
+        case 'm':
+            mhz = atof(optarg);
+            break;
+        case 'r':
+            ratio = atof(optarg);
+            break;
+        case 'l':
+            log2n = strtoul(optarg, NULL, 10);
+            break;
+        case 't':
+            threshold = strtoul(optarg, NULL, 10);
+            break;
+        case 'w':
+            wav = optarg;
+            break;
+        default:
+            goto usage;
+        }
+    }
+
+    if(mhz <= 0.0 || ratio <= 0.0 || optind != argc){
+        goto usage;
+    }
+
+    if(wav != NULL){
+        return play(wav, log2n, threshold);
+    }
+
+    return bench(mhz, ratio);
+
+usage:
+    fprintf(stderr, "usage: %s [-m target MHz] [-r ratio]\n"
+            "       %s [-l log2 size] [-t threshold] -w file.wav\n",
+            argv[0], argv[0]);
+    return EXIT_FAILURE;
+}
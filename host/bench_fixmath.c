@@ -0,0 +1,175 @@
+/**
+ * RTL8710 Blinkenlights. WiFi-controlled WS2812B LED strip.
+ * Copyright (C) 2016  Tido Klaassen <tido@4gh.eu>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/* Host benchmark for the fixed point helpers.
+ *
+ * Reports calls per second and host cycles per call of the table sine, the
+ * easing curves and the interpolations, next to the float sine from libm
+ * for comparison. Like bench_noise it estimates the target's cost from the
+ * host cycles, which is only a rough guide: the Cortex-M3 has no FPU, so
+ * the float sine is much slower there than the figure suggests.
+ *
+ * Usage: bench_fixmath [target MHz] [cycles per host cycle]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <math.h>
+#include "bench.h"
+#include "fixmath.h"
+
+#define CALLS               (1u << 24)
+
+static volatile uint32_t sink;
+static volatile float fsink;
+
+struct result {
+    double secs;
+    uint64_t cycles;
+};
+
+enum func {
+    func_sinf,
+    func_fix_sin,
+    func_sin8,
+    func_ease,      // followed by all curves
+};
+
+static const char *curve_names[ease_last] = {
+    "linear", "in_quad", "out_quad", "inout_quad", "in_cubic", "out_cubic",
+    "inout_cubic", "smooth", "inout_sine",
+};
+
+static struct result bench(unsigned int func)
+{
+    struct result res;
+    uint32_t i, acc;
+    float facc;
+    double start;
+    uint64_t cstart;
+
+    acc = 0;
+    facc = 0.0f;
+    start = bench_now();
+    cstart = bench_cycles();
+
+    /* step through the angles like an effect running along the strip */
+    switch(func){
+    case func_sinf:
+        for(i = 0; i < CALLS; ++i){
+            facc += sinf((float) (i * 97u & 0xffff) * (float) (M_PI / 32768));
+        }
+        break;
+    case func_fix_sin:
+        for(i = 0; i < CALLS; ++i){
+            acc += fix_sin(i * 97u);
+        }
+        break;
+    case func_sin8:
+        for(i = 0; i < CALLS; ++i){
+            acc += sin8(i * 7u);
+        }
+        break;
+    default:
+        for(i = 0; i < CALLS; ++i){
+            acc += ease16(func - func_ease, i * 97u);
+        }
+        break;
+    }
+
+    res.cycles = bench_cycles() - cstart;
+    res.secs = bench_now() - start;
+    sink = acc;
+    fsink = facc;
+
+    return res;
+}
+
+static struct result bench_lerp(void)
+{
+    struct result res;
+    uint32_t i, acc;
+    double start;
+    uint64_t cstart;
+
+    acc = 0;
+    start = bench_now();
+    cstart = bench_cycles();
+
+    for(i = 0; i < CALLS; ++i){
+        acc += lerp8(i, i >> 8, i >> 16);
+        acc += q8_8_lerp(i, i >> 4, i & 0xff);
+        acc += q16_16_lerp(i, i << 8, i & 0xffff);
+    }
+
+    res.cycles = bench_cycles() - cstart;
+    res.secs = bench_now() - start;
+    sink = acc;
+
+    /* three calls per iteration */
+    res.cycles /= 3;
+    res.secs /= 3.0;
+
+    return res;
+}
+
+static void print(const char *name, struct result res, double mhz,
+                  double ratio)
+{
+    double rate, cpc;
+
+    rate = CALLS / res.secs;
+    cpc = bench_host_cycles(res.cycles, res.secs) / CALLS;
+
+    printf("%-18s %14.0f %12.1f %18.0f\n", name, rate, cpc,
+           (mhz * 1e6 / TARGET_FPS) / (cpc * ratio));
+}
+
+int main(int argc, char *argv[])
+{
+    char name[32];
+    double mhz, ratio;
+    unsigned int curve;
+
+    mhz = argc > 1 ? atof(argv[1]) : TARGET_MHZ_DEF;
+    ratio = argc > 2 ? atof(argv[2]) : TARGET_RATIO_DEF;
+    if(mhz <= 0.0 || ratio <= 0.0){
+        fprintf(stderr, "usage: %s [target MHz] [cycles per host cycle]\n",
+                argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    printf("%u calls per run, target %.0f MHz, %.1fx host cycles\n",
+           CALLS, mhz, ratio);
+    printf("%-18s %14s %12s %18s\n",
+           "func", "calls/s", "cycles/call", "target calls/frame");
+
+    print("sinf", bench(func_sinf), mhz, ratio);
+    print("fix_sin", bench(func_fix_sin), mhz, ratio);
+    print("sin8", bench(func_sin8), mhz, ratio);
+
+    for(curve = 0; curve < ease_last; ++curve){
+        snprintf(name, sizeof(name), "ease16 %s", curve_names[curve]);
+        print(name, bench(func_ease + curve), mhz, ratio);
+    }
+
+    print("lerp", bench_lerp(), mhz, ratio);
+
+    return EXIT_SUCCESS;
+}
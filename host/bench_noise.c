@@ -0,0 +1,109 @@
+/**
+ * RTL8710 Blinkenlights. WiFi-controlled WS2812B LED strip.
+ * Copyright (C) 2016  Tido Klaassen <tido@4gh.eu>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/* Host benchmark for the integer noise functions.
+ *
+ * Reports samples per second on the host and, from a cycles-per-sample
+ * estimate, how many LEDs the target could update at 60 FPS. The host
+ * cycle count is only a lower bound for the Cortex-M3, which has no
+ * cache for flash-resident tables and a slower multiplier, so the
+ * target estimate should be read as an upper limit.
+ *
+ * Usage: bench_noise [target MHz] [cycles per host cycle]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include "bench.h"
+#include "noise.h"
+
+#define SAMPLES             (1u << 24)
+
+static volatile uint32_t sink;
+
+struct result {
+    double secs;
+    uint64_t cycles;
+};
+
+static struct result bench(unsigned int dim)
+{
+    struct result res;
+    uint32_t i, acc, x, t;
+    double start;
+    uint64_t cstart;
+
+    acc = 0;
+    start = bench_now();
+    cstart = bench_cycles();
+
+    /* walk along x like the filter does, advancing time every 256 LEDs */
+    for(i = 0; i < SAMPLES; ++i){
+        x = i * 16u;
+        t = (i >> 8) * 7u;
+        switch(dim){
+        case 1:
+            acc += noise1(x);
+            break;
+        case 2:
+            acc += noise2(x, t);
+            break;
+        default:
+            acc += noise3(x, t, t >> 1);
+            break;
+        }
+    }
+
+    res.cycles = bench_cycles() - cstart;
+    res.secs = bench_now() - start;
+    sink = acc;
+
+    return res;
+}
+
+int main(int argc, char *argv[])
+{
+    struct result res;
+    double mhz, ratio, rate, cps, leds;
+    unsigned int dim;
+
+    mhz = argc > 1 ? atof(argv[1]) : TARGET_MHZ_DEF;
+    ratio = argc > 2 ? atof(argv[2]) : TARGET_RATIO_DEF;
+    if(mhz <= 0.0 || ratio <= 0.0){
+        fprintf(stderr, "usage: %s [target MHz] [cycles per host cycle]\n",
+                argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    printf("%u samples per run, target %.0f MHz, %.1fx host cycles\n",
+           SAMPLES, mhz, ratio);
+    printf("%-8s %14s %14s %18s\n",
+           "func", "samples/s", "cycles/sample", "target LEDs@60FPS");
+
+    for(dim = 1; dim <= 3; ++dim){
+        res = bench(dim);
+        rate = SAMPLES / res.secs;
+        cps = bench_host_cycles(res.cycles, res.secs) / SAMPLES;
+
+        leds = (mhz * 1e6 / TARGET_FPS) / (cps * ratio);
+        printf("noise%-3u %14.0f %14.1f %18.0f\n", dim, rate, cps, leds);
+    }
+
+    return EXIT_SUCCESS;
+}
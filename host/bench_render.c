@@ -0,0 +1,306 @@
+/**
+ * RTL8710 Blinkenlights. WiFi-controlled WS2812B LED strip.
+ * Copyright (C) 2016  Tido Klaassen <tido@4gh.eu>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/* Host benchmark for the render engine.
+ *
+ * Builds the real blinken.c and ws2812.c against the simulator's shims and
+ * times the stages of a frame for a range of strip lengths and filter
+ * mixes: the filter chains alone, HSV to RGB conversion, encoding for the
+ * SPI DMA and the complete frame. The firmware is included here instead of
+ * being linked, so its static functions can be called directly, and it is
+ * built for up to BENCH_MAX_LEDS LEDs.
+ *
+ * The result is printed as CSV. host_fps is what the host manages for the
+ * whole frame, target_fps estimates the RTL8710 from the host cycles, the
+ * given clock and cycle ratio and the time the transfer to the strip takes,
+ * which the render task waits for. wire_fps is the limit set by the
+ * transfer alone.
+ *
+ * Usage: bench_render [-m target MHz] [-r ratio] [-p program.bin]
+ */
+#define main blinken_main
+#include "blinken.c"
+#undef main
+
+#include <unistd.h>
+#include <fcntl.h>
+#include "bench.h"
+#include "sim.h"
+
+#define MIN_SECS        0.02
+#define MIN_RUNS        10
+#define SPI_HZ          3200000.0
+#define PROG_DEF        "vm/plasma.bin"
+
+/* stubs for the parts of the SDK main() expects */
+int g_user_ap_sta_num = 0;
+
+void console_init(void)
+{
+}
+
+void start_blinken_server(void)
+{
+}
+
+void sim_frame(const uint8_t *data, size_t len)
+{
+}
+
+static const unsigned int lengths[] = {
+    10, 30, 100, 300, 1000, 3000, 5000
+};
+
+enum mix_flags {
+    mix_palette = (1 << 0),
+    mix_vm = (1 << 1),
+};
+
+/* filters run on the base layer and on the first overlay */
+struct mix {
+    const char *name;
+    uint32_t filters;
+    uint32_t layer;
+    uint32_t flags;
+};
+
+#define ALL_FILTERS     (ZONE_FILTER_DEFAULT | FILTER_NOISE | FILTER_VM)
+
+static const struct mix mixes[] = {
+    { "rainbow",    FILTER_RAINBOW,   0,                0 },
+    { "fade",       FILTER_FADE,      0,                0 },
+    { "flicker",    FILTER_FLICKER,   0,                0 },
+    { "eye",        FILTER_EYE,       0,                0 },
+    { "noise",      FILTER_NOISE,     0,                0 },
+    { "vm",         FILTER_VM,        0,                mix_vm },
+    { "particles",  0,                FILTER_PARTICLES, 0 },
+    { "sprites",    0,                FILTER_SPRITES,   0 },
+    { "palette",    0,                0,                mix_palette },
+    { "all",        ALL_FILTERS,      FILTER_PARTICLES, mix_vm },
+};
+
+struct timing {
+    double secs;
+    double cycles;
+};
+
+static struct strip_handler *bench_handler;
+static ws2812_t *bench_ws2812;
+
+static void stage_filters(void)
+{
+    struct led_layer *overlays[BLINKEN_MAX_LAYERS - 1];
+
+    /* let the effects move on as if a frame had been sent */
+    sim_advance(BLINKEN_FRAME_MS * 1000);
+    clock_update(&bench_handler->clock);
+    render_layers(bench_handler, overlays);
+}
+
+static void stage_hsv(void)
+{
+    unsigned int i;
+
+    for(i = 0; i < bench_handler->strip_len; ++i){
+        ws2812_hsv2rgb(&hsv_buffer[i], &rgb_buffer[i]);
+    }
+}
+
+static void stage_encode(void)
+{
+    ws2812_send_rgb(bench_ws2812, rgb_buffer, bench_handler->strip_len, 0);
+}
+
+static void stage_frame(void)
+{
+    render_frame(bench_handler, bench_ws2812);
+}
+
+/* average time per call, repeated until the clock resolution is no issue */
+static struct timing measure(void (*stage)(void))
+{
+    struct timing res;
+    unsigned long runs;
+    uint64_t cstart;
+    double start, secs;
+
+    stage();
+
+    runs = 0;
+    start = bench_now();
+    cstart = bench_cycles();
+    do{
+        stage();
+        ++runs;
+        secs = bench_now() - start;
+    }while(runs < MIN_RUNS || secs < MIN_SECS);
+
+    res.secs = secs / runs;
+    res.cycles = bench_host_cycles(bench_cycles() - cstart, secs) / runs;
+
+    return res;
+}
+
+static int setup(const struct blinken_cfg *defaults, const struct mix *mix,
+                 unsigned int len)
+{
+    static struct blinken_cfg cfg;
+
+    memmove(&cfg, defaults, sizeof(cfg));
+    cfg.strip_len = len;
+    cfg.filters = mix->filters;
+    cfg.layers[0].filters = mix->layer;
+    cfg.palette.enabled = (mix->flags & mix_palette) != 0;
+
+    release_handler(bench_handler);
+    activate_handler(bench_handler, bench_ws2812);
+
+    return init_handler(bench_handler, &cfg, bench_ws2812, false);
+}
+
+static int load(const char *name)
+{
+    FILE *fp;
+    size_t len;
+
+    fp = fopen(name, "rb");
+    if(fp == NULL){
+        return -1;
+    }
+
+    len = fread(&vm_prog, 1, sizeof(vm_prog), fp);
+    fclose(fp);
+
+    if(vm_verify(&vm_prog, len) != 0){
+        memset(&vm_prog, 0x0, sizeof(vm_prog));
+        return -1;
+    }
+
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    static struct blinken_cfg defaults;
+    struct timing filters, hsv, encode, frame;
+    const struct mix *mix;
+    unsigned int i, j, len;
+    double mhz, ratio, wire, target;
+    bool have_prog;
+    char *prog;
+    FILE *out;
+    int opt, fd;
+
+    mhz = TARGET_MHZ_DEF;
+    ratio = TARGET_RATIO_DEF;
+    prog = PROG_DEF;
+
+    while((opt = getopt(argc, argv, "m:r:p:")) != -1){
+        switch(opt){
+        case 'm':
+            mhz = atof(optarg);
+            break;
+        case 'r':
+            ratio = atof(optarg);
+            break;
+        case 'p':
+            prog = optarg;
+            break;
+        default:
+            goto usage;
+        }
+    }
+
+    if(mhz <= 0.0 || ratio <= 0.0 || optind != argc){
+        goto usage;
+    }
+
+    have_prog = load(prog) == 0;
+    if(!have_prog){
+        fprintf(stderr, "%s: no valid program, skipping the vm mixes\n",
+                prog);
+    }
+
+    /* keep the CSV apart from the firmware's log messages */
+    fd = dup(STDOUT_FILENO);
+    out = fd >= 0 ? fdopen(fd, "w") : NULL;
+    fd = open("/dev/null", O_WRONLY);
+    if(out == NULL || fd < 0 || dup2(fd, STDOUT_FILENO) < 0){
+        perror("stdout");
+        return EXIT_FAILURE;
+    }
+
+    sim_flash_open(NULL);
+
+    bench_ws2812 = ws2812_init(BLINKEN_MAX_LEDS);
+    if(bench_ws2812 == NULL){
+        fprintf(stderr, "ws2812_init() failed\n");
+        return EXIT_FAILURE;
+    }
+
+    /* let the firmware fill in its defaults once */
+    bench_handler = &handlers[0];
+    bench_handler->active = true;
+    if(init_handler(bench_handler, &defaults, bench_ws2812, false) != 0){
+        fprintf(stderr, "init_handler() failed\n");
+        return EXIT_FAILURE;
+    }
+
+    fprintf(out, "leds,mix,filters_us,hsv_us,encode_us,frame_us,"
+            "host_fps,target_fps,wire_fps\n");
+
+    for(i = 0; i < sizeof(lengths) / sizeof(*lengths); ++i){
+        len = lengths[i];
+        wire = WS2812_DMABUF_LEN(len) * 8 / SPI_HZ;
+
+        for(j = 0; j < sizeof(mixes) / sizeof(*mixes); ++j){
+            mix = &mixes[j];
+            if((mix->flags & mix_vm) && !have_prog){
+                continue;
+            }
+
+            if(setup(&defaults, mix, len) != 0){
+                fprintf(stderr, "setting up %s failed\n", mix->name);
+                return EXIT_FAILURE;
+            }
+            clock_init(&bench_handler->clock);
+
+            filters = measure(stage_filters);
+            hsv = measure(stage_hsv);
+            encode = measure(stage_encode);
+            frame = measure(stage_frame);
+
+            target = frame.cycles * ratio / (mhz * 1e6) + wire;
+
+            fprintf(out, "%u,%s,%.2f,%.2f,%.2f,%.2f,%.0f,%.1f,%.1f\n",
+                    len, mix->name, filters.secs * 1e6, hsv.secs * 1e6,
+                    encode.secs * 1e6, frame.secs * 1e6, 1.0 / frame.secs,
+                    1.0 / target, 1.0 / wire);
+            fflush(out);
+        }
+    }
+
+    fclose(out);
+    return EXIT_SUCCESS;
+
+usage:
+    fprintf(stderr, "usage: %s [-m target MHz] [-r ratio] [-p program.bin]\n",
+            argv[0]);
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,163 @@
+/**
+ * RTL8710 Blinkenlights. WiFi-controlled WS2812B LED strip.
+ * Copyright (C) 2016  Tido Klaassen <tido@4gh.eu>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/* Host benchmark for the effect VM.
+ *
+ * Runs assembled programs over a strip and reports the interpreted cost
+ * per LED, both in instructions and in time. For per-frame programs the
+ * cost of the whole frame is spread over the strip. From the instruction count
+ * it also derives how many LEDs the default per-frame budget covers, and
+ * from host cycles an estimate of how many LEDs the target could drive
+ * at 60 FPS.
+ *
+ * Usage: bench_vm [-n leds] [-m target MHz] [-r ratio] program.bin...
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "bench.h"
+#include "vm.h"
+
+#define LEDS_DEF        300
+#define FRAMES          2000
+#define MAX_INSTR       1000    // per LED, stops programs that do not end
+
+static int load(const char *name, struct vm_program *prog)
+{
+    FILE *fp;
+    size_t len;
+
+    fp = fopen(name, "rb");
+    if(fp == NULL){
+        perror(name);
+        return -1;
+    }
+
+    memset(prog, 0x0, sizeof(*prog));
+    len = fread(prog, 1, sizeof(*prog), fp);
+    fclose(fp);
+
+    if(vm_verify(prog, len) != 0){
+        fprintf(stderr, "%s: invalid program\n", name);
+        return -1;
+    }
+
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    static struct vm_program prog;
+    struct vm_state vm;
+    struct vm_env env;
+    uint8_t *hsv;
+    unsigned int leds, frame;
+    uint64_t instr, cstart, cycles;
+    double mhz, ratio, start, secs, ipl, cpl;
+    int opt, i, result;
+
+    leds = LEDS_DEF;
+    mhz = TARGET_MHZ_DEF;
+    ratio = TARGET_RATIO_DEF;
+
+    while((opt = getopt(argc, argv, "n:m:r:")) != -1){
+        switch(opt){
+        case 'n':
+            leds = strtoul(optarg, NULL, 10);
+            break;
+        case 'm':
+            mhz = atof(optarg);
+            break;
+        case 'r':
+            ratio = atof(optarg);
+            break;
+        default:
+            goto usage;
+        }
+    }
+
+    if(optind >= argc || leds == 0 || mhz <= 0.0 || ratio <= 0.0){
+        goto usage;
+    }
+
+    hsv = calloc(leds, 3);
+    if(hsv == NULL){
+        perror("calloc");
+        return EXIT_FAILURE;
+    }
+
+    printf("%u LEDs, %u frames, target %.0f MHz, %.1fx host cycles\n",
+           leds, FRAMES, mhz, ratio);
+    printf("%-16s %6s %10s %10s %12s %14s %18s\n", "program", "mode",
+           "instr/LED", "ns/LED", "cycles/LED", "LEDs in budget",
+           "target LEDs@60FPS");
+
+    for(i = optind; i < argc; ++i){
+        if(load(argv[i], &prog) != 0){
+            continue;
+        }
+
+        /* a generous budget, we want to know what the program costs */
+        vm_reset(&vm, MAX_INSTR * leds, 1);
+        env.delta = 256 / 60;
+
+        instr = 0;
+        result = 0;
+
+        start = bench_now();
+        cstart = bench_cycles();
+        for(frame = 0; frame < FRAMES && result == 0; ++frame){
+            env.time = (int32_t) ((frame << 8) / 60);
+            result = vm_run(&prog, &vm, &env, hsv, leds);
+            instr += vm.used;
+        }
+        cycles = bench_cycles() - cstart;
+        secs = bench_now() - start;
+
+        if(result < 0){
+            printf("%-16s fault at %u: %s\n", argv[i],
+                   (unsigned int) vm.fault_pc, vm.fault);
+            continue;
+        }
+
+        if(result > 0){
+            printf("%-16s out of budget after %u instructions\n", argv[i],
+                   (unsigned int) vm.used);
+            continue;
+        }
+
+        ipl = (double) instr / ((double) frame * leds);
+        cpl = bench_host_cycles(cycles, secs) / ((double) frame * leds);
+
+        printf("%-16s %6s %10.1f %10.1f %12.1f %14.0f %18.0f\n", argv[i],
+               prog.hdr.mode == vm_frame ? "frame" : "pixel", ipl,
+               secs * 1e9 / ((double) frame * leds), cpl,
+               VM_BUDGET_DEF / ipl,
+               (mhz * 1e6 / TARGET_FPS) / (cpl * ratio));
+    }
+
+    free(hsv);
+    return EXIT_SUCCESS;
+
+usage:
+    fprintf(stderr, "usage: %s [-n leds] [-m target MHz] [-r ratio] "
+            "program.bin...\n", argv[0]);
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,49 @@
+/**
+ * RTL8710 Blinkenlights. WiFi-controlled WS2812B LED strip.
+ * Copyright (C) 2016  Tido Klaassen <tido@4gh.eu>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/* Generates the quarter wave sine table for src/fixmath.c:
+ *
+ *   ./gen_sine > ../src/fixmath_tab.h
+ *
+ * The entries are sin(x) in Q15, rounded to nearest, for FIX_SIN_STEPS
+ * steps over the first quarter turn and its end point.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "fixmath.h"
+
+int main(void)
+{
+    unsigned int i;
+    long val;
+
+    printf("/* generated by host/gen_sine, do not edit */\n");
+    printf("const int16_t fix_sin_tab[FIX_SIN_STEPS + 1] = {\n");
+
+    for(i = 0; i <= FIX_SIN_STEPS; ++i){
+        val = lround(32767.0 * sin(M_PI / 2.0 * i / FIX_SIN_STEPS));
+        printf("%s%6ld,%s", i % 10 == 0 ? "   " : "", val,
+               i % 10 == 9 || i == FIX_SIN_STEPS ? "\n" : "");
+    }
+
+    printf("};\n");
+
+    return EXIT_SUCCESS;
+}
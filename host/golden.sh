@@ -0,0 +1,68 @@
+#!/bin/sh
+#
+# RTL8710 Blinkenlights. WiFi-controlled WS2812B LED strip.
+# Copyright (C) 2016  Tido Klaassen <tido@4gh.eu>
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+#
+# Replays the scenarios in golden/scenarios in the simulator and compares
+# the per frame hashes of the HSV and DMA buffers to the stored ones.
+# With -u the stored hashes are replaced instead, only do this for changes
+# that are meant to alter the output.
+
+update=0
+if [ "$1" = "-u" ]; then
+    update=1
+elif [ $# -ne 0 ]; then
+    echo "usage: $0 [-u]" >&2
+    exit 1
+fi
+
+cd "$(dirname "$0")" || exit 1
+
+tmp=$(mktemp) || exit 1
+trap 'rm -f "$tmp"' EXIT
+
+failed=0
+while read -r name frames args; do
+    case "$name" in
+        ''|'#'*) continue ;;
+    esac
+
+    # shellcheck disable=SC2086
+    if ! ./blinkensim -q -n "$frames" -g "$tmp" $args 2>/dev/null; then
+        echo "$name: simulator failed"
+        failed=1
+        continue
+    fi
+
+    golden="golden/$name.txt"
+    if [ $update -eq 1 ]; then
+        cat "$tmp" > "$golden"
+        echo "$name: updated"
+    elif [ ! -f "$golden" ]; then
+        echo "$name: no golden file"
+        failed=1
+    elif cmp -s "$tmp" "$golden"; then
+        echo "$name: ok"
+    else
+        # report the first frame that differs
+        echo "$name: FAILED"
+        diff "$golden" "$tmp" | sed -n '2p;4p'
+        failed=1
+    fi
+done < golden/scenarios
+
+exit $failed
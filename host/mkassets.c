@@ -0,0 +1,163 @@
+/**
+ * RTL8710 Blinkenlights. WiFi-controlled WS2812B LED strip.
+ * Copyright (C) 2016  Tido Klaassen <tido@4gh.eu>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/* Compresses the static web files for the firmware:
+ *
+ *   ./mkassets ../web/style.css ../web/wifi.js > ../src/assets.c
+ *
+ * Each file is served under its base name, with a content type guessed
+ * from the extension. The gzip header carries no time stamp or file name,
+ * so the output only changes when the files do.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+#include "assets.h"
+#include "crc32.h"
+
+#define MAX_ASSET_SIZE  (64 * 1024)
+#define MAX_ASSETS      64
+
+static const struct
+{
+    const char *ext;
+    const char *type;
+} types[] = {
+    { ".html",  "text/html" },
+    { ".css",   "text/css" },
+    { ".js",    "application/javascript" },
+    { ".svg",   "image/svg+xml" },
+    { ".ico",   "image/x-icon" },
+    { ".png",   "image/png" },
+};
+
+static const char *guess_type(const char *name)
+{
+    size_t len, ext_len;
+    unsigned int i;
+
+    len = strlen(name);
+    for(i = 0; i < sizeof(types) / sizeof(*types); ++i){
+        ext_len = strlen(types[i].ext);
+        if(len > ext_len && !strcmp(name + len - ext_len, types[i].ext)){
+            return types[i].type;
+        }
+    }
+
+    return "application/octet-stream";
+}
+
+/* gzip file into out, returns the compressed size or 0 on failure */
+static size_t compress_file(const char *file, uint8_t *out, size_t size)
+{
+    static uint8_t in[MAX_ASSET_SIZE];
+    z_stream strm;
+    size_t in_len;
+    FILE *fp;
+    int result;
+
+    fp = fopen(file, "rb");
+    if(fp == NULL){
+        perror(file);
+        return 0;
+    }
+
+    in_len = fread(in, 1, sizeof(in), fp);
+    if(!feof(fp)){
+        fprintf(stderr, "%s: too large\n", file);
+        fclose(fp);
+        return 0;
+    }
+
+    fclose(fp);
+
+    memset(&strm, 0x0, sizeof(strm));
+    /* 16 + window bits asks for a gzip instead of a zlib header */
+    result = deflateInit2(&strm, Z_BEST_COMPRESSION, Z_DEFLATED, 16 + 15, 9,
+                          Z_DEFAULT_STRATEGY);
+    if(result != Z_OK){
+        fprintf(stderr, "%s: deflateInit2 failed\n", file);
+        return 0;
+    }
+
+    strm.next_in = in;
+    strm.avail_in = in_len;
+    strm.next_out = out;
+    strm.avail_out = size;
+
+    result = deflate(&strm, Z_FINISH);
+    deflateEnd(&strm);
+
+    if(result != Z_STREAM_END){
+        fprintf(stderr, "%s: compression failed\n", file);
+        return 0;
+    }
+
+    return size - strm.avail_out;
+}
+
+int main(int argc, char *argv[])
+{
+    static uint8_t out[MAX_ASSET_SIZE + 1024];
+    static uint32_t crcs[MAX_ASSETS];
+    const char *name;
+    size_t len, i;
+    int n;
+
+    if(argc < 2 || argc > MAX_ASSETS + 1){
+        fprintf(stderr, "usage: %s file...\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    printf("/* generated by host/mkassets, do not edit */\n");
+    printf("#include \"assets.h\"\n");
+
+    for(n = 1; n < argc; ++n){
+        len = compress_file(argv[n], out, sizeof(out));
+        if(len == 0){
+            return EXIT_FAILURE;
+        }
+
+        crcs[n - 1] = crc32_update(0, out, len);
+
+        printf("\nstatic const uint8_t asset_%d[%zu] = {\n", n - 1, len);
+        for(i = 0; i < len; ++i){
+            printf("%s0x%02x,%s", i % 12 == 0 ? "   " : "", out[i],
+                   i % 12 == 11 || i == len - 1 ? "\n" : "");
+        }
+        printf("};\n");
+    }
+
+    printf("\nconst struct blinken_asset blinken_assets[] = {\n");
+    for(n = 1; n < argc; ++n){
+        name = strrchr(argv[n], '/');
+        name = name != NULL ? name + 1 : argv[n];
+
+        printf("    { \"/%s\", \"%s\", asset_%d, sizeof(asset_%d), "
+               "0x%08x },\n",
+               name, guess_type(name), n - 1, n - 1,
+               (unsigned int) crcs[n - 1]);
+    }
+    printf("};\n");
+
+    printf("\nconst unsigned int blinken_num_assets = %d;\n", argc - 1);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,73 @@
+/**
+ * RTL8710 Blinkenlights. WiFi-controlled WS2812B LED strip.
+ * Copyright (C) 2016  Tido Klaassen <tido@4gh.eu>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+#ifndef __SIM_FREERTOS_H__
+#define __SIM_FREERTOS_H__
+
+/* Just enough of the FreeRTOS API for the firmware sources. Tasks are
+ * threads, time is virtual and only advances when the strip is sent to or
+ * a task delays. See rtos.c. */
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef uint32_t TickType_t;
+typedef long BaseType_t;
+typedef unsigned long UBaseType_t;
+typedef void *TaskHandle_t;
+typedef void *SemaphoreHandle_t;
+typedef void *QueueHandle_t;
+typedef void *EventGroupHandle_t;
+typedef uint32_t EventBits_t;
+typedef void (*TaskFunction_t)(void *);
+
+#define pdTRUE                  1
+#define pdFALSE                 0
+#define pdPASS                  1
+#define pdFAIL                  0
+
+#define configTICK_RATE_HZ      1000
+#define configMINIMAL_STACK_SIZE 128
+#define portTICK_PERIOD_MS      1
+#define portTICK_RATE_MS        1
+#define portMAX_DELAY           0xffffffffUL
+#define tskIDLE_PRIORITY        0
+
+#define portYIELD_FROM_ISR(x)   ((void) (x))
+#define configASSERT(x)         ((void) (x))
+
+#define taskENTER_CRITICAL()    sim_enter_critical()
+#define taskEXIT_CRITICAL()     sim_exit_critical()
+
+extern void sim_enter_critical(void);
+extern void sim_exit_critical(void);
+
+extern TickType_t xTaskGetTickCount(void);
+extern void vTaskDelay(TickType_t ticks);
+extern BaseType_t xTaskCreate(TaskFunction_t fn, const char *name,
+                              uint16_t stack, void *param,
+                              UBaseType_t prio, TaskHandle_t *handle);
+extern void vTaskDelete(TaskHandle_t task);
+extern void vTaskStartScheduler(void);
+
+/* from portable.h, only declared for the web server's compile check */
+extern size_t xPortGetFreeHeapSize(void);
+
+#endif
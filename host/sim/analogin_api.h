@@ -0,0 +1,36 @@
+/**
+ * RTL8710 Blinkenlights. WiFi-controlled WS2812B LED strip.
+ * Copyright (C) 2016  Tido Klaassen <tido@4gh.eu>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+#ifndef __SIM_ANALOGIN_API_H__
+#define __SIM_ANALOGIN_API_H__
+
+#include <stdint.h>
+
+typedef struct {
+    int pin;
+} analogin_t;
+
+enum {
+    AD_1, AD_2, AD_3,
+};
+
+extern void analogin_init(analogin_t *obj, int pin);
+extern void analogin_deinit(analogin_t *obj);
+extern uint16_t analogin_read_u16(analogin_t *obj);
+
+#endif
@@ -0,0 +1,95 @@
+/**
+ * RTL8710 Blinkenlights. WiFi-controlled WS2812B LED strip.
+ * Copyright (C) 2016  Tido Klaassen <tido@4gh.eu>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+#ifndef __SIM_DLIST_H__
+#define __SIM_DLIST_H__
+
+/* The SDK's doubly linked list, with its four argument iterators. */
+#include <stddef.h>
+
+struct list_head {
+    struct list_head *next, *prev;
+};
+
+#define LIST_HEAD_INIT(name)    { &(name), &(name) }
+#define LIST_HEAD(name)         struct list_head name = LIST_HEAD_INIT(name)
+#define INIT_LIST_HEAD(ptr) \
+    do{ (ptr)->next = (ptr); (ptr)->prev = (ptr); }while(0)
+
+static inline void __list_add(struct list_head *entry,
+                              struct list_head *prev, struct list_head *next)
+{
+    next->prev = entry;
+    entry->next = next;
+    entry->prev = prev;
+    prev->next = entry;
+}
+
+static inline void list_add(struct list_head *entry, struct list_head *head)
+{
+    __list_add(entry, head, head->next);
+}
+
+static inline void list_add_tail(struct list_head *entry,
+                                 struct list_head *head)
+{
+    __list_add(entry, head->prev, head);
+}
+
+static inline void list_del(struct list_head *entry)
+{
+    entry->next->prev = entry->prev;
+    entry->prev->next = entry->next;
+    entry->next = NULL;
+    entry->prev = NULL;
+}
+
+static inline void list_del_init(struct list_head *entry)
+{
+    entry->next->prev = entry->prev;
+    entry->prev->next = entry->next;
+    INIT_LIST_HEAD(entry);
+}
+
+static inline int list_empty(struct list_head *head)
+{
+    return head->next == head;
+}
+
+#define list_entry(ptr, type, member) \
+    ((type *) ((char *) (ptr) - offsetof(type, member)))
+
+#define list_for_each(pos, head) \
+    for(pos = (head)->next; pos != (head); pos = pos->next)
+
+#define list_for_each_safe(pos, n, head) \
+    for(pos = (head)->next, n = pos->next; pos != (head); \
+        pos = n, n = pos->next)
+
+#define list_for_each_entry(pos, head, member, type) \
+    for(pos = list_entry((head)->next, type, member); \
+        &pos->member != (head); \
+        pos = list_entry(pos->member.next, type, member))
+
+#define list_for_each_entry_safe(pos, n, head, member, type) \
+    for(pos = list_entry((head)->next, type, member), \
+        n = list_entry(pos->member.next, type, member); \
+        &pos->member != (head); \
+        pos = n, n = list_entry(n->member.next, type, member))
+
+#endif
@@ -0,0 +1,35 @@
+/**
+ * RTL8710 Blinkenlights. WiFi-controlled WS2812B LED strip.
+ * Copyright (C) 2016  Tido Klaassen <tido@4gh.eu>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+#ifndef __SIM_EVENT_GROUPS_H__
+#define __SIM_EVENT_GROUPS_H__
+
+#include "FreeRTOS.h"
+
+extern EventGroupHandle_t xEventGroupCreate(void);
+extern void vEventGroupDelete(EventGroupHandle_t group);
+extern EventBits_t xEventGroupClearBits(EventGroupHandle_t group,
+                                        EventBits_t bits);
+extern BaseType_t xEventGroupSetBitsFromISR(EventGroupHandle_t group,
+                                            EventBits_t bits,
+                                            BaseType_t *woken);
+extern EventBits_t xEventGroupWaitBits(EventGroupHandle_t group,
+                                       EventBits_t bits, BaseType_t clear,
+                                       BaseType_t all, TickType_t timeout);
+
+#endif
@@ -0,0 +1,36 @@
+/**
+ * RTL8710 Blinkenlights. WiFi-controlled WS2812B LED strip.
+ * Copyright (C) 2016  Tido Klaassen <tido@4gh.eu>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+#ifndef __SIM_FLASH_API_H__
+#define __SIM_FLASH_API_H__
+
+/* NOR flash kept in memory and optionally mirrored to a file, see hal.c.
+ * Writes can only clear bits, like on the real part. */
+#include <stdint.h>
+
+typedef struct {
+    int unused;
+} flash_t;
+
+extern void flash_erase_sector(flash_t *obj, uint32_t address);
+extern int flash_stream_read(flash_t *obj, uint32_t address, uint32_t len,
+                             uint8_t *data);
+extern int flash_stream_write(flash_t *obj, uint32_t address, uint32_t len,
+                              uint8_t *data);
+
+#endif
@@ -0,0 +1,286 @@
+/**
+ * RTL8710 Blinkenlights. WiFi-controlled WS2812B LED strip.
+ * Copyright (C) 2016  Tido Klaassen <tido@4gh.eu>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+/* Emulated peripherals: flash, the SPI DMA that feeds the strip, and the
+ * ADC sampled by a hardware timer. */
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+#include "flash_api.h"
+#include "device_lock.h"
+#include "spi_ex_api.h"
+#include "analogin_api.h"
+#include "timer_api.h"
+#include "../wav.h"
+#include "sim.h"
+
+static uint8_t flash_mem[SIM_FLASH_SIZE];
+static int flash_fd = -1;
+static pthread_mutex_t dev_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Back the flash with a file, so settings and programs survive between
+ * runs. A missing file starts out erased, without a file the flash only
+ * lives in memory. */
+int sim_flash_open(const char *name)
+{
+    ssize_t len;
+
+    memset(flash_mem, 0xff, sizeof(flash_mem));
+    if(name == NULL){
+        return 0;
+    }
+
+    flash_fd = open(name, O_RDWR | O_CREAT, 0644);
+    if(flash_fd < 0){
+        perror(name);
+        return -1;
+    }
+
+    len = pread(flash_fd, flash_mem, sizeof(flash_mem), 0);
+    if(len < 0){
+        perror(name);
+        return -1;
+    }
+
+    /* a new or short file gets the erased remainder written out */
+    if((size_t) len < sizeof(flash_mem)
+       && pwrite(flash_fd, flash_mem + len, sizeof(flash_mem) - len, len)
+            != (ssize_t) (sizeof(flash_mem) - len)){
+        perror(name);
+        return -1;
+    }
+
+    return 0;
+}
+
+/* keep working on the memory copy only */
+void sim_flash_detach(void)
+{
+    if(flash_fd >= 0){
+        close(flash_fd);
+        flash_fd = -1;
+    }
+}
+
+static void flash_sync(uint32_t address, uint32_t len)
+{
+    if(flash_fd >= 0
+       && pwrite(flash_fd, flash_mem + address, len, address)
+            != (ssize_t) len){
+        perror("flash image");
+    }
+}
+
+void flash_erase_sector(flash_t *obj, uint32_t address)
+{
+    address &= ~(SIM_SECTOR_SIZE - 1);
+    if(address >= SIM_FLASH_SIZE){
+        return;
+    }
+
+    memset(flash_mem + address, 0xff, SIM_SECTOR_SIZE);
+    flash_sync(address, SIM_SECTOR_SIZE);
+}
+
+int flash_stream_read(flash_t *obj, uint32_t address, uint32_t len,
+                      uint8_t *data)
+{
+    if(address > SIM_FLASH_SIZE || len > SIM_FLASH_SIZE - address){
+        return 0;
+    }
+
+    memcpy(data, flash_mem + address, len);
+    return 1;
+}
+
+/* programming can only clear bits */
+int flash_stream_write(flash_t *obj, uint32_t address, uint32_t len,
+                       uint8_t *data)
+{
+    uint32_t i;
+
+    if(address > SIM_FLASH_SIZE || len > SIM_FLASH_SIZE - address){
+        return 0;
+    }
+
+    for(i = 0; i < len; ++i){
+        flash_mem[address + i] &= data[i];
+    }
+
+    flash_sync(address, len);
+    return 1;
+}
+
+void device_mutex_lock(int dev)
+{
+    pthread_mutex_lock(&dev_lock);
+}
+
+void device_mutex_unlock(int dev)
+{
+    pthread_mutex_unlock(&dev_lock);
+}
+
+static spi_irq_handler spi_handler = NULL;
+static int spi_hz = 1;
+
+void spi_init(spi_t *obj, PinName mosi, PinName miso, PinName sclk,
+              PinName ssel)
+{
+    obj->state = 0;
+}
+
+void spi_format(spi_t *obj, int bits, int mode, int slave)
+{
+}
+
+void spi_frequency(spi_t *obj, int hz)
+{
+    spi_hz = hz > 0 ? hz : 1;
+}
+
+/* The id is the driver's context cast to 32 bits, which does not hold a
+ * host pointer. The driver's spi_t is the first member of its context, so
+ * the handler is passed the spi_t itself instead. */
+void spi_irq_hook(spi_t *obj, spi_irq_handler handler, uint32_t id)
+{
+    spi_handler = handler;
+}
+
+/* The transfer completes at once, in virtual time it takes as long as
+ * shifting the buffer out at the configured clock. */
+int32_t spi_master_write_stream_dma(spi_t *obj, char *tx_buffer,
+                                    uint32_t length)
+{
+    sim_frame((const uint8_t *) tx_buffer, length);
+    sim_advance((uint32_t) ((uint64_t) length * 8 * 1000000 / spi_hz));
+
+    if(spi_handler != NULL){
+        spi_handler(obj, SpiTxIrq);
+    }
+
+    return 0;
+}
+
+/* ADC samples come from a WAV file if one was given, silence otherwise */
+static struct wav_file audio_wav;
+static bool audio_open = false;
+static uint32_t audio_phase, audio_step;
+static int16_t audio_buf[256];
+static unsigned int audio_len;
+static uint16_t adc_value = 0x8000;
+
+static void (*timer_handler)(uint32_t) = NULL;
+static uint32_t timer_id, timer_period, timer_acc;
+
+int sim_audio_open(const char *name)
+{
+    if(wav_open(&audio_wav, name) != 0){
+        return -1;
+    }
+
+    audio_open = true;
+    return 0;
+}
+
+/* nearest sample at the timer's rate, 16 bit fraction */
+static int16_t audio_next(void)
+{
+    int16_t sample;
+
+    if(!audio_open){
+        return 0;
+    }
+
+    while((audio_phase >> 16) >= audio_len){
+        audio_phase -= audio_len << 16;
+        audio_len = wav_read(&audio_wav, audio_buf,
+                             sizeof(audio_buf) / sizeof(*audio_buf));
+        if(audio_len == 0){
+            wav_close(&audio_wav);
+            audio_open = false;
+            return 0;
+        }
+    }
+
+    sample = audio_buf[audio_phase >> 16];
+    audio_phase += audio_step;
+
+    return sample;
+}
+
+/* fire the sampling timer as often as it would have in usecs */
+void sim_audio_tick(uint32_t usecs)
+{
+    if(timer_handler == NULL){
+        return;
+    }
+
+    timer_acc += usecs;
+    while(timer_acc >= timer_period){
+        timer_acc -= timer_period;
+        adc_value = (uint16_t) (audio_next() + 0x8000);
+        timer_handler(timer_id);
+    }
+}
+
+void analogin_init(analogin_t *obj, int pin)
+{
+    obj->pin = pin;
+}
+
+void analogin_deinit(analogin_t *obj)
+{
+}
+
+uint16_t analogin_read_u16(analogin_t *obj)
+{
+    return adc_value;
+}
+
+void gtimer_init(gtimer_t *obj, uint32_t tid)
+{
+    obj->tid = tid;
+}
+
+void gtimer_deinit(gtimer_t *obj)
+{
+}
+
+void gtimer_start_periodical(gtimer_t *obj, uint32_t duration_us,
+                             void *handler, uint32_t hid)
+{
+    timer_period = duration_us > 0 ? duration_us : 1;
+    timer_id = hid;
+    timer_acc = 0;
+
+    if(audio_open){
+        audio_step = (uint32_t) (((uint64_t) audio_wav.rate << 16)
+                                 * timer_period / 1000000);
+    }
+
+    timer_handler = (void (*)(uint32_t)) handler;
+}
+
+void gtimer_stop(gtimer_t *obj)
+{
+    timer_handler = NULL;
+}
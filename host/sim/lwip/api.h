@@ -0,0 +1,101 @@
+/**
+ * RTL8710 Blinkenlights. WiFi-controlled WS2812B LED strip.
+ * Copyright (C) 2016  Tido Klaassen <tido@4gh.eu>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+#ifndef __SIM_LWIP_API_H__
+#define __SIM_LWIP_API_H__
+
+/* The parts of lwIP 1.4.1's netconn API and the SDK's port macros the web
+ * server uses. Only for compile checks, nothing implements them. */
+#include <stdint.h>
+#include <stddef.h>
+
+/* pulled in by the SDK's lwIP headers through its port and options */
+#include <ctype.h>
+#include <platform_opts.h>
+#include "dlist.h"
+
+typedef uint8_t  u8_t;
+typedef uint16_t u16_t;
+typedef uint32_t u32_t;
+typedef int8_t   s8_t;
+typedef int16_t  s16_t;
+typedef int32_t  s32_t;
+typedef s8_t     err_t;
+
+#define ERR_OK          0
+#define ERR_MEM         -1
+#define ERR_BUF         -2
+#define ERR_TIMEOUT     -3
+#define ERR_VAL         -6
+#define ERR_CLSD        -12
+
+#define NETCONN_NOFLAG  0x00
+#define NETCONN_NOCOPY  0x00
+#define NETCONN_COPY    0x01
+#define NETCONN_MORE    0x02
+#define NETCONN_TCP     0x10
+
+#define SOF_REUSEADDR   0x04
+#define TCP_MSS         1460
+
+typedef struct ip_addr {
+    u32_t addr;
+} ip_addr_t;
+
+struct ip_pcb {
+    u8_t so_options;
+};
+
+struct netconn {
+    union {
+        struct ip_pcb *ip;
+    } pcb;
+    int recv_timeout;
+};
+
+struct netbuf;
+
+#define ip_set_option(pcb, opt) ((pcb)->so_options |= (opt))
+
+extern struct netconn *netconn_new(int type);
+extern err_t netconn_bind(struct netconn *conn, ip_addr_t *addr, u16_t port);
+extern err_t netconn_listen(struct netconn *conn);
+extern err_t netconn_accept(struct netconn *conn, struct netconn **new_conn);
+extern err_t netconn_recv(struct netconn *conn, struct netbuf **new_buf);
+extern err_t netconn_write_partly(struct netconn *conn, const void *data,
+                                  size_t size, u8_t flags,
+                                  size_t *bytes_written);
+extern err_t netconn_close(struct netconn *conn);
+extern err_t netconn_delete(struct netconn *conn);
+extern err_t netconn_abort(struct netconn *conn);
+
+#define netconn_write(conn, data, size, flags) \
+    netconn_write_partly(conn, data, size, flags, NULL)
+
+#define port_netconn_recv(conn, buf, ret) \
+    do { (ret) = netconn_recv(conn, &(buf)); } while(0)
+#define port_netconn_accept(conn, new_conn, ret) \
+    do { (ret) = netconn_accept(conn, &(new_conn)); } while(0)
+
+extern err_t netbuf_data(struct netbuf *buf, void **data, u16_t *len);
+extern s8_t netbuf_next(struct netbuf *buf);
+extern void netbuf_delete(struct netbuf *buf);
+
+extern const char *lwip_strerr(err_t err);
+
+#endif
@@ -0,0 +1,31 @@
+/**
+ * RTL8710 Blinkenlights. WiFi-controlled WS2812B LED strip.
+ * Copyright (C) 2016  Tido Klaassen <tido@4gh.eu>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+#ifndef __SIM_QUEUE_H__
+#define __SIM_QUEUE_H__
+
+#include "FreeRTOS.h"
+
+extern QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size);
+extern BaseType_t xQueueSend(QueueHandle_t queue, const void *item,
+                             TickType_t timeout);
+extern BaseType_t xQueueReceive(QueueHandle_t queue, void *item,
+                                TickType_t timeout);
+extern UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue);
+
+#endif
@@ -0,0 +1,434 @@
+/**
+ * RTL8710 Blinkenlights. WiFi-controlled WS2812B LED strip.
+ * Copyright (C) 2016  Tido Klaassen <tido@4gh.eu>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+/* FreeRTOS on top of POSIX threads.
+ *
+ * Every task is a thread, but time is virtual: the tick count only moves
+ * when a task delays or the strip is sent out. Blocking calls wait on one
+ * condition variable that is signalled whenever a semaphore, an event
+ * group or the clock changes. That keeps timeouts like the persist task's
+ * settle time meaningful without slowing the simulation down.
+ */
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+#include "event_groups.h"
+#include "sim.h"
+
+struct sim_sema {
+    UBaseType_t count;
+    UBaseType_t max;
+};
+
+struct sim_events {
+    EventBits_t bits;
+};
+
+struct sim_task {
+    TaskFunction_t fn;
+    void *param;
+    struct sim_task *next;
+};
+
+static pthread_mutex_t kernel = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t changed = PTHREAD_COND_INITIALIZER;
+static pthread_mutex_t critical = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+
+static uint64_t elapsed_us = 0;
+static TickType_t ticks = 0;
+static bool running = false;
+static bool stopped = false;
+static bool realtime = false;
+static struct timespec started;
+static struct sim_task *waiting = NULL;
+
+void sim_enter_critical(void)
+{
+    pthread_mutex_lock(&critical);
+}
+
+void sim_exit_critical(void)
+{
+    pthread_mutex_unlock(&critical);
+}
+
+void sim_realtime(bool enable)
+{
+    realtime = enable;
+    clock_gettime(CLOCK_MONOTONIC, &started);
+}
+
+/* keep virtual time from running ahead of the wall clock */
+static void pace(uint64_t usecs)
+{
+    struct timespec ts;
+
+    ts.tv_sec = started.tv_sec + usecs / 1000000;
+    ts.tv_nsec = started.tv_nsec + (usecs % 1000000) * 1000;
+    if(ts.tv_nsec >= 1000000000){
+        ts.tv_nsec -= 1000000000;
+        ++ts.tv_sec;
+    }
+
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+}
+
+void sim_advance(uint32_t usecs)
+{
+    uint64_t now;
+
+    pthread_mutex_lock(&kernel);
+    elapsed_us += usecs;
+    now = elapsed_us;
+    ticks = (TickType_t) (elapsed_us / 1000);
+    pthread_cond_broadcast(&changed);
+    pthread_mutex_unlock(&kernel);
+
+    sim_audio_tick(usecs);
+
+    if(realtime){
+        pace(now);
+    }
+}
+
+uint64_t sim_elapsed(void)
+{
+    uint64_t now;
+
+    pthread_mutex_lock(&kernel);
+    now = elapsed_us;
+    pthread_mutex_unlock(&kernel);
+
+    return now;
+}
+
+void sim_stop(void)
+{
+    pthread_mutex_lock(&kernel);
+    stopped = true;
+    pthread_cond_broadcast(&changed);
+    pthread_mutex_unlock(&kernel);
+}
+
+/* a task that has nothing left to do waits here until the process ends */
+void sim_park(void)
+{
+    pthread_mutex_lock(&kernel);
+    while(1){
+        pthread_cond_wait(&changed, &kernel);
+    }
+}
+
+/* Wait with the kernel lock held until ready() or the timeout expires.
+ * Once the simulation is stopped, nothing returns from here any more. */
+static bool wait_for(bool (*ready)(void *), void *arg, TickType_t timeout)
+{
+    TickType_t deadline;
+
+    deadline = ticks + timeout;
+    while(stopped || !ready(arg)){
+        if(!stopped && timeout != portMAX_DELAY
+           && (int32_t) (ticks - deadline) >= 0){
+            return false;
+        }
+
+        pthread_cond_wait(&changed, &kernel);
+    }
+
+    return true;
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    TickType_t now;
+
+    pthread_mutex_lock(&kernel);
+    now = ticks;
+    pthread_mutex_unlock(&kernel);
+
+    return now;
+}
+
+void vTaskDelay(TickType_t delay)
+{
+    if(delay == 0){
+        sched_yield();
+        return;
+    }
+
+    sim_advance(delay * 1000u);
+}
+
+static void *task_entry(void *arg)
+{
+    struct sim_task task;
+
+    task = *(struct sim_task *) arg;
+    free(arg);
+
+    task.fn(task.param);
+
+    return NULL;
+}
+
+static int task_start(struct sim_task *task)
+{
+    pthread_t thread;
+
+    if(pthread_create(&thread, NULL, task_entry, task) != 0){
+        free(task);
+        return -1;
+    }
+
+    pthread_detach(thread);
+    return 0;
+}
+
+/* Like FreeRTOS, tasks created before the scheduler runs only start with
+ * it. */
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint16_t stack,
+                       void *param, UBaseType_t prio, TaskHandle_t *handle)
+{
+    struct sim_task *task;
+    bool now;
+
+    task = calloc(1, sizeof(*task));
+    if(task == NULL){
+        return pdFAIL;
+    }
+
+    task->fn = fn;
+    task->param = param;
+
+    pthread_mutex_lock(&kernel);
+    now = running;
+    if(!now){
+        task->next = waiting;
+        waiting = task;
+    }
+    pthread_mutex_unlock(&kernel);
+
+    if(now && task_start(task) != 0){
+        return pdFAIL;
+    }
+
+    if(handle != NULL){
+        *handle = (TaskHandle_t) task;
+    }
+
+    return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+    if(task == NULL){
+        pthread_exit(NULL);
+    }
+}
+
+/* Start all tasks created so far and return once the simulation has been
+ * stopped. */
+void vTaskStartScheduler(void)
+{
+    struct sim_task *task, *next;
+
+    pthread_mutex_lock(&kernel);
+    running = true;
+    task = waiting;
+    waiting = NULL;
+    pthread_mutex_unlock(&kernel);
+
+    for(; task != NULL; task = next){
+        next = task->next;
+        task_start(task);
+    }
+
+    pthread_mutex_lock(&kernel);
+    while(!stopped){
+        pthread_cond_wait(&changed, &kernel);
+    }
+    pthread_mutex_unlock(&kernel);
+}
+
+static SemaphoreHandle_t sema_create(UBaseType_t max, UBaseType_t initial)
+{
+    struct sim_sema *sema;
+
+    sema = malloc(sizeof(*sema));
+    if(sema != NULL){
+        sema->max = max;
+        sema->count = initial;
+    }
+
+    return sema;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    return sema_create(1, 1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void)
+{
+    return sema_create(1, 0);
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max,
+                                           UBaseType_t initial)
+{
+    return sema_create(max, initial);
+}
+
+static bool sema_ready(void *arg)
+{
+    return ((struct sim_sema *) arg)->count > 0;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t handle, TickType_t timeout)
+{
+    struct sim_sema *sema;
+    bool ok;
+
+    sema = handle;
+
+    pthread_mutex_lock(&kernel);
+    ok = wait_for(sema_ready, sema, timeout);
+    if(ok){
+        --sema->count;
+    }
+    pthread_mutex_unlock(&kernel);
+
+    return ok ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t handle)
+{
+    struct sim_sema *sema;
+    BaseType_t result;
+
+    sema = handle;
+    result = pdFALSE;
+
+    pthread_mutex_lock(&kernel);
+    if(sema->count < sema->max){
+        ++sema->count;
+        result = pdTRUE;
+        pthread_cond_broadcast(&changed);
+    }
+    pthread_mutex_unlock(&kernel);
+
+    return result;
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t sema)
+{
+    free(sema);
+}
+
+void vQueueDelete(QueueHandle_t queue)
+{
+    free(queue);
+}
+
+EventGroupHandle_t xEventGroupCreate(void)
+{
+    return calloc(1, sizeof(struct sim_events));
+}
+
+void vEventGroupDelete(EventGroupHandle_t group)
+{
+    free(group);
+}
+
+EventBits_t xEventGroupClearBits(EventGroupHandle_t handle, EventBits_t bits)
+{
+    struct sim_events *group;
+    EventBits_t old;
+
+    group = handle;
+
+    pthread_mutex_lock(&kernel);
+    old = group->bits;
+    group->bits &= ~bits;
+    pthread_mutex_unlock(&kernel);
+
+    return old;
+}
+
+BaseType_t xEventGroupSetBitsFromISR(EventGroupHandle_t handle,
+                                     EventBits_t bits, BaseType_t *woken)
+{
+    struct sim_events *group;
+
+    group = handle;
+
+    pthread_mutex_lock(&kernel);
+    group->bits |= bits;
+    pthread_cond_broadcast(&changed);
+    pthread_mutex_unlock(&kernel);
+
+    if(woken != NULL){
+        *woken = pdFALSE;
+    }
+
+    return pdPASS;
+}
+
+struct wait_bits {
+    struct sim_events *group;
+    EventBits_t bits;
+    bool all;
+};
+
+static bool bits_ready(void *arg)
+{
+    struct wait_bits *wait;
+    EventBits_t set;
+
+    wait = arg;
+    set = wait->group->bits & wait->bits;
+
+    return wait->all ? set == wait->bits : set != 0;
+}
+
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t handle, EventBits_t bits,
+                                BaseType_t clear, BaseType_t all,
+                                TickType_t timeout)
+{
+    struct wait_bits wait;
+    EventBits_t result;
+    bool ok;
+
+    wait.group = handle;
+    wait.bits = bits;
+    wait.all = (all != pdFALSE);
+
+    pthread_mutex_lock(&kernel);
+    ok = wait_for(bits_ready, &wait, timeout);
+    result = wait.group->bits;
+    if(ok && clear != pdFALSE){
+        wait.group->bits &= ~bits;
+    }
+    pthread_mutex_unlock(&kernel);
+
+    return result;
+}
@@ -0,0 +1,34 @@
+/**
+ * RTL8710 Blinkenlights. WiFi-controlled WS2812B LED strip.
+ * Copyright (C) 2016  Tido Klaassen <tido@4gh.eu>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+#ifndef __SIM_SEMPHR_H__
+#define __SIM_SEMPHR_H__
+
+#include "FreeRTOS.h"
+
+/* mutexes are plain binary semaphores, nothing takes one recursively */
+extern SemaphoreHandle_t xSemaphoreCreateMutex(void);
+extern SemaphoreHandle_t xSemaphoreCreateBinary(void);
+extern SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max,
+                                                  UBaseType_t initial);
+extern BaseType_t xSemaphoreTake(SemaphoreHandle_t sema, TickType_t timeout);
+extern BaseType_t xSemaphoreGive(SemaphoreHandle_t sema);
+extern void vSemaphoreDelete(SemaphoreHandle_t sema);
+extern void vQueueDelete(QueueHandle_t queue);
+
+#endif
@@ -0,0 +1,564 @@
+/**
+ * RTL8710 Blinkenlights. WiFi-controlled WS2812B LED strip.
+ * Copyright (C) 2016  Tido Klaassen <tido@4gh.eu>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+/* Runs the unmodified render engine on the host. The firmware's tasks run
+ * on the FreeRTOS emulation in rtos.c, every buffer the SPI DMA sends out
+ * is decoded back into LED colours and written out as an image or shown on
+ * the terminal.
+ *
+ * Settings can be overridden with -s, e.g. -s rainbow.cycle_steps=200.
+ * They are applied to the config in flash before the firmware boots, so
+ * the very first frame already runs with them. If the flash holds no
+ * config yet, a throw-away copy of the firmware is booted first to get
+ * the defaults filled in.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/wait.h>
+#include "blinken.h"
+#include "cfglog.h"
+#include "crc32.h"
+#include "flash_api.h"
+#include "device_lock.h"
+#include "platform_opts.h"
+#include "sim.h"
+
+/* main() of the firmware, renamed when building it for the simulator */
+extern void blinken_main(void);
+
+/* base layer of the render engine, hashed along with the DMA buffer */
+extern hsvValue_t hsv_buffer[];
+
+/* stubs for the parts of the SDK main() expects */
+int g_user_ap_sta_num = 0;
+
+void console_init(void)
+{
+}
+
+void start_blinken_server(void)
+{
+}
+
+#define MAX_OVERRIDES   64
+
+struct cfg_field {
+    const char *name;
+    size_t offset;
+};
+
+#define FIELD(name, member) { name, offsetof(struct blinken_cfg, member) }
+#define ZONE(n) \
+    FIELD("zone" #n ".offset", zones[n - 1].offset), \
+    FIELD("zone" #n ".len", zones[n - 1].len), \
+    FIELD("zone" #n ".filters", zones[n - 1].filters)
+#define LAYER(n) \
+    FIELD("layer" #n ".mode", layers[n - 1].mode), \
+    FIELD("layer" #n ".opacity", layers[n - 1].opacity), \
+    FIELD("layer" #n ".filters", layers[n - 1].filters)
+
+static const struct cfg_field cfg_fields[] = {
+    FIELD("strip_len", strip_len),
+    FIELD("delay", delay),
+    FIELD("brightness", brightness),
+    FIELD("filters", filters),
+    FIELD("rainbow.hue_min", rainbow.hue_min),
+    FIELD("rainbow.hue_max", rainbow.hue_max),
+    FIELD("rainbow.hue_steps", rainbow.hue_steps),
+    FIELD("rainbow.cycle_steps", rainbow.cycle_steps),
+    FIELD("fade.min", fade.min),
+    FIELD("fade.max", fade.max),
+    FIELD("fade.steps", fade.steps),
+    FIELD("flicker.rate", flicker.rate),
+    FIELD("eye.rate", eye.rate),
+    LAYER(1),
+    LAYER(2),
+    ZONE(1),
+    ZONE(2),
+    ZONE(3),
+    FIELD("particles.mode", particles.mode),
+    FIELD("particles.rate", particles.rate),
+    FIELD("particles.speed", particles.speed),
+    FIELD("particles.life", particles.life),
+    FIELD("particles.hue", particles.hue),
+    FIELD("particles.gravity", particles.gravity),
+    FIELD("particles.decay", particles.decay),
+    FIELD("noise.scale", noise.scale),
+    FIELD("noise.speed", noise.speed),
+    FIELD("noise.hue_min", noise.hue_min),
+    FIELD("noise.hue_max", noise.hue_max),
+    FIELD("noise.val_min", noise.val_min),
+    FIELD("palette.enabled", palette.enabled),
+    FIELD("palette.hue_min", palette.hue_min),
+    FIELD("palette.hue_max", palette.hue_max),
+    FIELD("palette.saturation", palette.saturation),
+    FIELD("palette.value", palette.value),
+    FIELD("palette.repeat", palette.repeat),
+    FIELD("palette.rotate", palette.rotate),
+    FIELD("vm.budget", vm.budget),
+    FIELD("audio.enabled", audio.enabled),
+    FIELD("audio.threshold", audio.threshold),
+    FIELD("audio.fade_depth", audio.fade_depth),
+    FIELD("audio.speed_depth", audio.speed_depth),
+    FIELD("sprites.count", sprites.count),
+    FIELD("sprites.mode", sprites.mode),
+    FIELD("sprites.shape", sprites.shape),
+    FIELD("sprites.size", sprites.size),
+    FIELD("sprites.speed", sprites.speed),
+    FIELD("sprites.hue", sprites.hue),
+    FIELD("sprites.hue_step", sprites.hue_step),
+    FIELD("sprites.value", sprites.value),
+};
+
+enum sim_mode {
+    mode_probe,     // boot only to get the default config
+    mode_run,
+};
+
+static enum sim_mode mode = mode_run;
+static int probe_fd = -1;
+
+static unsigned long frames_max = 0;
+static unsigned long frames = 0;
+static FILE *ppm_out = NULL;
+static FILE *ansi_out = NULL;
+static FILE *hash_out = NULL;
+static bool realtime = false;
+static unsigned int width = 0;
+static rgbValue_t leds[BLINKEN_MAX_LEDS];
+
+/* Each DMA byte carries two bits of colour, 0xe in a nibble is a one.
+ * Returns the number of LEDs found in the buffer. */
+static unsigned int decode(const uint8_t *data, size_t len)
+{
+    unsigned int num, i, j, k;
+    uint8_t colour[3];
+
+    if(len < WS2812_RESET_LEN){
+        return 0;
+    }
+
+    num = min((len - WS2812_RESET_LEN) / 12, BLINKEN_MAX_LEDS);
+    for(i = 0; i < num; ++i){
+        for(j = 0; j < 3; ++j){
+            colour[j] = 0;
+            for(k = 0; k < 4; ++k){
+                colour[j] <<= 2;
+                colour[j] |= ((*data >> 4) == 0xe) << 1;
+                colour[j] |= (*data & 0xf) == 0xe;
+                ++data;
+            }
+        }
+
+        leds[i].green = colour[0];
+        leds[i].red = colour[1];
+        leds[i].blue = colour[2];
+    }
+
+    return num;
+}
+
+static void write_ppm(unsigned int num)
+{
+    static const uint8_t off[3] = { 0, 0, 0 };
+    unsigned int i;
+
+    if(frames == 0){
+        fprintf(ppm_out, "P6\n%u %lu\n255\n", width, frames_max);
+    }
+
+    for(i = 0; i < width; ++i){
+        if(i < num){
+            fputc(leds[i].red, ppm_out);
+            fputc(leds[i].green, ppm_out);
+            fputc(leds[i].blue, ppm_out);
+        } else {
+            fwrite(off, sizeof(off), 1, ppm_out);
+        }
+    }
+}
+
+static void write_ansi(unsigned int num)
+{
+    unsigned int i;
+
+    for(i = 0; i < num; ++i){
+        fprintf(ansi_out, "\x1b[48;2;%u;%u;%um ",
+                leds[i].red, leds[i].green, leds[i].blue);
+    }
+
+    /* in realtime mode the strip is redrawn in place */
+    fprintf(ansi_out, "\x1b[0m%s", realtime ? "\r" : "\n");
+    fflush(ansi_out);
+}
+
+/* Called from the render task with every transfer to the strip. */
+void sim_frame(const uint8_t *data, size_t len)
+{
+    struct blinken_cfg *cfg;
+    unsigned int num;
+
+    if(mode == mode_probe){
+        cfg = blinken_get_config();
+        if(cfg == NULL
+           || write(probe_fd, cfg, sizeof(*cfg)) != sizeof(*cfg)){
+            _exit(EXIT_FAILURE);
+        }
+        _exit(EXIT_SUCCESS);
+    }
+
+    if(frames_max > 0 && frames >= frames_max){
+        return;
+    }
+
+    num = decode(data, len);
+    if(frames == 0){
+        width = num;
+    }
+
+    if(ppm_out != NULL){
+        write_ppm(num);
+    }
+
+    if(ansi_out != NULL){
+        write_ansi(num);
+    }
+
+    /* urand() starts from the same state on every boot and time only
+     * moves with the frames, so a replay hashes the same every time */
+    if(hash_out != NULL){
+        fprintf(hash_out, "%lu %08x %08x\n", frames,
+                (unsigned int) crc32_update(0, hsv_buffer,
+                                            num * sizeof(*hsv_buffer)),
+                (unsigned int) crc32_update(0, data, len));
+    }
+
+    ++frames;
+    if(frames_max > 0 && frames >= frames_max){
+        sim_stop();
+    }
+}
+
+/* Boot a copy of the firmware on the flash contents and let it report the
+ * config it ends up running with. */
+static int probe_config(struct blinken_cfg *cfg)
+{
+    int fds[2], status, null;
+    size_t done;
+    ssize_t len;
+    pid_t pid;
+
+    if(pipe(fds) != 0){
+        perror("pipe");
+        return -1;
+    }
+
+    pid = fork();
+    if(pid < 0){
+        perror("fork");
+        return -1;
+    }
+
+    if(pid == 0){
+        close(fds[0]);
+        sim_flash_detach();
+
+        null = open("/dev/null", O_WRONLY);
+        if(null >= 0){
+            dup2(null, STDOUT_FILENO);
+        }
+
+        mode = mode_probe;
+        probe_fd = fds[1];
+        blinken_main();
+        _exit(EXIT_FAILURE);
+    }
+
+    close(fds[1]);
+    for(done = 0; done < sizeof(*cfg); done += len){
+        len = read(fds[0], (uint8_t *) cfg + done, sizeof(*cfg) - done);
+        if(len <= 0){
+            break;
+        }
+    }
+    close(fds[0]);
+
+    waitpid(pid, &status, 0);
+    if(done != sizeof(*cfg) || !WIFEXITED(status)
+       || WEXITSTATUS(status) != EXIT_SUCCESS){
+        fprintf(stderr, "getting the default config failed\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+static int apply_override(struct blinken_cfg *cfg, const char *arg)
+{
+    const char *value;
+    char *end;
+    size_t len;
+    long num;
+    int32_t field;
+    unsigned int i;
+
+    value = strchr(arg, '=');
+    if(value == NULL){
+        goto err_out;
+    }
+
+    len = value - arg;
+    ++value;
+
+    num = strtol(value, &end, 0);
+    if(*value == '\0' || *end != '\0'){
+        goto err_out;
+    }
+
+    for(i = 0; i < sizeof(cfg_fields) / sizeof(*cfg_fields); ++i){
+        if(strlen(cfg_fields[i].name) == len
+           && strncmp(cfg_fields[i].name, arg, len) == 0){
+            field = (int32_t) num;
+            memcpy((uint8_t *) cfg + cfg_fields[i].offset, &field,
+                   sizeof(field));
+            return 0;
+        }
+    }
+
+err_out:
+    fprintf(stderr, "invalid setting: %s\n", arg);
+    return -1;
+}
+
+static int set_config(char *overrides[], unsigned int num)
+{
+    struct blinken_cfg cfg;
+    unsigned int i, pass;
+
+    memset(&cfg, 0x0, sizeof(cfg));
+    cfglog_init();
+    if(cfglog_read(&cfg, sizeof(cfg)) != 0
+       || cfg.magic != BLINKEN_CFG_MAGIC){
+        if(probe_config(&cfg) != 0){
+            return -1;
+        }
+    }
+
+    /* A filter fills in its defaults only when it is set up, which would
+     * overwrite settings for filters the overrides have just enabled. Boot
+     * once more on the result to get those defaults, then apply the
+     * overrides again. The firmware sanitises the values when it loads
+     * them. */
+    for(pass = 0; pass < 2; ++pass){
+        if(pass > 0 && probe_config(&cfg) != 0){
+            return -1;
+        }
+
+        for(i = 0; i < num; ++i){
+            if(apply_override(&cfg, overrides[i]) != 0){
+                return -1;
+            }
+        }
+
+        cfglog_init();
+        if(cfglog_write(&cfg, sizeof(cfg)) != 0){
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static int load_program(const char *name)
+{
+    static struct vm_program prog;
+    flash_t flash;
+    size_t len;
+    FILE *fp;
+
+    fp = fopen(name, "rb");
+    if(fp == NULL){
+        perror(name);
+        return -1;
+    }
+
+    len = fread(&prog, 1, sizeof(prog), fp);
+    fclose(fp);
+
+    if(vm_verify(&prog, len) != 0){
+        fprintf(stderr, "%s: not a valid program\n", name);
+        return -1;
+    }
+
+    flash_erase_sector(&flash, BLINKEN_VM_SECTOR);
+    if(flash_stream_write(&flash, BLINKEN_VM_SECTOR, len,
+                          (uint8_t *) &prog) != 1){
+        return -1;
+    }
+
+    return 0;
+}
+
+static double wall_clock(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+int main(int argc, char *argv[])
+{
+    char *overrides[MAX_OVERRIDES];
+    unsigned int num_overrides;
+    char *ppm, *hashes, *flash_img, *prog, *wav;
+    bool ansi, quiet;
+    double start, wall, virt;
+    int opt, out;
+
+    ppm = hashes = flash_img = prog = wav = NULL;
+    ansi = quiet = false;
+    num_overrides = 0;
+
+    while((opt = getopt(argc, argv, "n:o:g:arF:s:p:w:q")) != -1){
+        switch(opt){
+        case 'n':
+            frames_max = strtoul(optarg, NULL, 10);
+            break;
+        case 'o':
+            ppm = optarg;
+            break;
+        case 'g':
+            hashes = optarg;
+            break;
+        case 'a':
+            ansi = true;
+            break;
+        case 'r':
+            realtime = true;
+            break;
+        case 'F':
+            flash_img = optarg;
+            break;
+        case 's':
+            if(num_overrides >= MAX_OVERRIDES){
+                goto usage;
+            }
+            overrides[num_overrides++] = optarg;
+            break;
+        case 'p':
+            prog = optarg;
+            break;
+        case 'w':
+            wav = optarg;
+            break;
+        case 'q':
+            quiet = true;
+            break;
+        default:
+            goto usage;
+        }
+    }
+
+    if(optind != argc
+       || ((ppm != NULL || hashes != NULL) && frames_max == 0)){
+        goto usage;
+    }
+
+    /* the firmware logs to stdout, keep that for the strip on a terminal */
+    if(ansi){
+        out = dup(STDOUT_FILENO);
+        ansi_out = out >= 0 ? fdopen(out, "w") : NULL;
+        if(ansi_out == NULL){
+            perror("stdout");
+            return EXIT_FAILURE;
+        }
+    }
+
+    out = quiet ? open("/dev/null", O_WRONLY) : STDERR_FILENO;
+    if(out < 0 || dup2(out, STDOUT_FILENO) < 0){
+        perror("stdout");
+        return EXIT_FAILURE;
+    }
+    setvbuf(stdout, NULL, _IOLBF, 0);
+
+    if(sim_flash_open(flash_img) != 0
+       || (prog != NULL && load_program(prog) != 0)
+       || (wav != NULL && sim_audio_open(wav) != 0)
+       || (num_overrides > 0 && set_config(overrides, num_overrides) != 0)){
+        return EXIT_FAILURE;
+    }
+
+    if(ppm != NULL){
+        ppm_out = fopen(ppm, "wb");
+        if(ppm_out == NULL){
+            perror(ppm);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if(hashes != NULL){
+        hash_out = fopen(hashes, "w");
+        if(hash_out == NULL){
+            perror(hashes);
+            return EXIT_FAILURE;
+        }
+    }
+
+    sim_realtime(realtime);
+
+    start = wall_clock();
+    blinken_main();
+    wall = wall_clock() - start;
+    virt = sim_elapsed() / 1e6;
+
+    /* do not cut off a flash write of the persist task */
+    device_mutex_lock(RT_DEV_LOCK_FLASH);
+
+    if(ppm_out != NULL){
+        fclose(ppm_out);
+    }
+
+    if(hash_out != NULL){
+        fclose(hash_out);
+    }
+
+    if(ansi_out != NULL){
+        fputc('\n', ansi_out);
+        fclose(ansi_out);
+    }
+
+    fprintf(stderr, "%lu frames, %.3f s simulated (%.1f fps), "
+            "%.3f s wall clock (%.0f fps)\n",
+            frames, virt, virt > 0.0 ? frames / virt : 0.0,
+            wall, wall > 0.0 ? frames / wall : 0.0);
+
+    return EXIT_SUCCESS;
+
+usage:
+    fprintf(stderr, "usage: %s [-n frames] [-o out.ppm] [-g hashes.txt] "
+            "[-a] [-r] [-F flash.img]\n"
+            "          [-s name=value]... [-p program.bin] [-w sound.wav] "
+            "[-q]\n", argv[0]);
+    return EXIT_FAILURE;
+}
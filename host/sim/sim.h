@@ -0,0 +1,51 @@
+/**
+ * RTL8710 Blinkenlights. WiFi-controlled WS2812B LED strip.
+ * Copyright (C) 2016  Tido Klaassen <tido@4gh.eu>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+#ifndef __SIM_H__
+#define __SIM_H__
+
+/* Internal interface of the host simulator. rtos.c keeps the virtual
+ * clock, hal.c the emulated peripherals, sim.c the frame output. */
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#define SIM_FLASH_SIZE      0x100000
+#define SIM_SECTOR_SIZE     0x1000
+
+/* Advance virtual time, e.g. by the duration of a DMA transfer. Blocked
+ * tasks whose timeout passes are woken, the ADC timer fires as often as
+ * it would have in the meantime. */
+extern void sim_advance(uint32_t usecs);
+extern uint64_t sim_elapsed(void);
+extern void sim_realtime(bool enable);
+
+/* stop all tasks at their next blocking call, vTaskStartScheduler()
+ * returns afterwards */
+extern void sim_stop(void);
+extern void sim_park(void);
+
+extern int sim_flash_open(const char *name);
+extern void sim_flash_detach(void);
+extern int sim_audio_open(const char *name);
+extern void sim_audio_tick(uint32_t usecs);
+
+/* called with every buffer the SPI DMA sends out */
+extern void sim_frame(const uint8_t *data, size_t len);
+
+#endif
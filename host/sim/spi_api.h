@@ -0,0 +1,49 @@
+/**
+ * RTL8710 Blinkenlights. WiFi-controlled WS2812B LED strip.
+ * Copyright (C) 2016  Tido Klaassen <tido@4gh.eu>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+#ifndef __SIM_SPI_API_H__
+#define __SIM_SPI_API_H__
+
+#include <stdint.h>
+#include <stdio.h>
+
+typedef enum {
+    SpiRxIrq,
+    SpiTxIrq,
+} SpiIrq;
+
+typedef void (*spi_irq_handler)(void *data, SpiIrq event);
+
+typedef struct {
+    volatile uint32_t state;
+} spi_t;
+
+#define SPI_STATE_TX_BUSY   (1 << 2)
+
+typedef enum {
+    PC_0, PC_1, PC_2, PC_3,
+} PinName;
+
+#define DBG_8195A           printf
+
+extern void spi_init(spi_t *obj, PinName mosi, PinName miso, PinName sclk,
+                     PinName ssel);
+extern void spi_format(spi_t *obj, int bits, int mode, int slave);
+extern void spi_frequency(spi_t *obj, int hz);
+
+#endif
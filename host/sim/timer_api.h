@@ -0,0 +1,38 @@
+/**
+ * RTL8710 Blinkenlights. WiFi-controlled WS2812B LED strip.
+ * Copyright (C) 2016  Tido Klaassen <tido@4gh.eu>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+#ifndef __SIM_TIMER_API_H__
+#define __SIM_TIMER_API_H__
+
+#include <stdint.h>
+
+typedef struct {
+    uint32_t tid;
+} gtimer_t;
+
+enum {
+    TIMER0, TIMER1, TIMER2, TIMER3, TIMER4,
+};
+
+extern void gtimer_init(gtimer_t *obj, uint32_t tid);
+extern void gtimer_deinit(gtimer_t *obj);
+extern void gtimer_start_periodical(gtimer_t *obj, uint32_t duration_us,
+                                    void *handler, uint32_t hid);
+extern void gtimer_stop(gtimer_t *obj);
+
+#endif
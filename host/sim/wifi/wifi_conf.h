@@ -0,0 +1,62 @@
+/**
+ * RTL8710 Blinkenlights. WiFi-controlled WS2812B LED strip.
+ * Copyright (C) 2016  Tido Klaassen <tido@4gh.eu>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+#ifndef __SIM_WIFI_CONF_H__
+#define __SIM_WIFI_CONF_H__
+
+/* The SDK's WiFi types and calls used by the web server. */
+typedef enum {
+    RTW_SECURITY_OPEN = 0,
+    RTW_SECURITY_WPA2_AES_PSK = 0x00400004,
+} rtw_security_t;
+
+typedef enum {
+    RTW_MODE_NONE = 0,
+    RTW_MODE_STA,
+    RTW_MODE_AP,
+    RTW_MODE_STA_AP,
+    RTW_MODE_PROMISC,
+    RTW_MODE_P2P,
+} rtw_mode_t;
+
+typedef struct {
+    rtw_mode_t mode;
+    unsigned char ssid[33];
+    unsigned char channel;
+    rtw_security_t security_type;
+    unsigned char password[65];
+    unsigned char key_idx;
+} rtw_wifi_setting_t;
+
+typedef struct {
+    unsigned int boot_mode;
+    unsigned char ssid[32];
+    unsigned char ssid_len;
+    unsigned char security_type;
+    unsigned char password[65];
+    unsigned char password_len;
+    unsigned char channel;
+} rtw_wifi_config_t;
+
+extern int wifi_on(rtw_mode_t mode);
+extern int wifi_get_setting(const char *ifname, rtw_wifi_setting_t *setting);
+extern int wifi_restart_ap(unsigned char *ssid, rtw_security_t security_type,
+                           unsigned char *password, int ssid_len,
+                           int password_len, int channel);
+
+#endif
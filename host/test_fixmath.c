@@ -0,0 +1,273 @@
+/**
+ * RTL8710 Blinkenlights. WiFi-controlled WS2812B LED strip.
+ * Copyright (C) 2016  Tido Klaassen <tido@4gh.eu>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/* Accuracy checks for the fixed point helpers in src/fixmath.h against the
+ * floating point results. Prints one line per check and fails if any of
+ * them exceeds its error bound.
+ *
+ * Usage: test_fixmath
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+#include "fixmath.h"
+
+static unsigned int failures = 0;
+
+static void report(const char *name, double err, double bound)
+{
+    bool ok;
+
+    ok = err <= bound;
+    printf("%-16s max error %10.4f, bound %8.4f: %s\n", name, err, bound,
+           ok ? "ok" : "FAILED");
+
+    if(!ok){
+        ++failures;
+    }
+}
+
+static void check(const char *name, bool ok)
+{
+    printf("%-16s %s\n", name, ok ? "ok" : "FAILED");
+
+    if(!ok){
+        ++failures;
+    }
+}
+
+static void test_table(void)
+{
+    unsigned int i;
+    double err, ref;
+
+    err = 0.0;
+    for(i = 0; i <= FIX_SIN_STEPS; ++i){
+        ref = 32767.0 * sin(M_PI / 2.0 * i / FIX_SIN_STEPS);
+        err = fmax(err, fabs(fix_sin_tab[i] - ref));
+    }
+
+    report("fix_sin_tab", err, 0.5);
+}
+
+static void test_sin(void)
+{
+    uint32_t a;
+    double err_sin, err_cos, rad;
+    bool sym;
+
+    err_sin = err_cos = 0.0;
+    sym = true;
+    for(a = 0; a <= UINT16_MAX; ++a){
+        rad = 2.0 * M_PI * a / 65536.0;
+        err_sin = fmax(err_sin, fabs(fix_sin(a) - 32767.0 * sin(rad)));
+        err_cos = fmax(err_cos, fabs(fix_cos(a) - 32767.0 * cos(rad)));
+
+        if(fix_sin(a) != -fix_sin((uint16_t) -a)){
+            sym = false;
+        }
+    }
+
+    report("fix_sin", err_sin, 2.0);
+    report("fix_cos", err_cos, 2.0);
+    check("fix_sin odd", sym);
+}
+
+static void test_sin8(void)
+{
+    unsigned int t;
+    double err;
+
+    err = 0.0;
+    for(t = 0; t < 256; ++t){
+        err = fmax(err, fabs(sin8(t) - (128.0 + 127.996 * sin(2.0 * M_PI
+                                                        * t / 256.0))));
+    }
+
+    report("sin8", err, 1.0);
+}
+
+static double ease_ref(enum ease_curve curve, double t)
+{
+    switch(curve){
+    case ease_in_quad:
+        return t * t;
+    case ease_out_quad:
+        return 1.0 - (1.0 - t) * (1.0 - t);
+    case ease_inout_quad:
+        return t < 0.5 ? 2.0 * t * t : 1.0 - 2.0 * (1.0 - t) * (1.0 - t);
+    case ease_in_cubic:
+        return t * t * t;
+    case ease_out_cubic:
+        return 1.0 - pow(1.0 - t, 3.0);
+    case ease_inout_cubic:
+        return t < 0.5 ? 4.0 * t * t * t : 1.0 - 4.0 * pow(1.0 - t, 3.0);
+    case ease_smooth:
+        return t * t * (3.0 - 2.0 * t);
+    case ease_inout_sine:
+        return (1.0 - cos(M_PI * t)) / 2.0;
+    case ease_linear:
+    default:
+        return t;
+    }
+}
+
+static void test_ease(void)
+{
+    static const char *names[ease_last] = {
+        "ease_linear", "ease_in_quad", "ease_out_quad", "ease_inout_quad",
+        "ease_in_cubic", "ease_out_cubic", "ease_inout_cubic", "ease_smooth",
+        "ease_inout_sine",
+    };
+    enum ease_curve curve;
+    uint32_t t;
+    uint16_t val, last;
+    double err;
+    bool mono;
+
+    for(curve = 0; curve < ease_last; ++curve){
+        err = 0.0;
+        mono = ease16(curve, 0) == 0 && ease16(curve, UINT16_MAX) == UINT16_MAX
+                && ease8(curve, 0) == 0 && ease8(curve, 255) == 255;
+        last = 0;
+
+        for(t = 0; t <= UINT16_MAX; ++t){
+            val = ease16(curve, t);
+            err = fmax(err, fabs(val - 65535.0 * ease_ref(curve,
+                                                          t / 65535.0)));
+            if(val < last){
+                mono = false;
+            }
+            last = val;
+        }
+
+        report(names[curve], err, 4.0);
+        check(names[curve], mono);
+    }
+}
+
+static void test_saturate(void)
+{
+    check("qadd8", qadd8(200, 100) == 255 && qadd8(20, 30) == 50);
+    check("qsub8", qsub8(20, 30) == 0 && qsub8(30, 20) == 10);
+    check("qadd16", qadd16(30000, 30000) == INT16_MAX
+                    && qadd16(-30000, -30000) == INT16_MIN
+                    && qadd16(-300, 200) == -100);
+    check("qsub16", qsub16(-30000, 30000) == INT16_MIN
+                    && qsub16(30000, -30000) == INT16_MAX);
+    check("q8_8_mul", q8_8_mul(3 * Q8_8_ONE, Q8_8_ONE / 2) == 384
+                      && q8_8_mul(100 * Q8_8_ONE, 100 * Q8_8_ONE)
+                            == INT16_MAX
+                      && q8_8_mul(-100 * Q8_8_ONE, 100 * Q8_8_ONE)
+                            == INT16_MIN);
+    check("q16_16_mul", q16_16_mul(3 * Q16_16_ONE, Q16_16_ONE / 4)
+                            == 3 * Q16_16_ONE / 4
+                        && q16_16_mul(20000 * Q16_16_ONE, Q16_16_ONE / 4)
+                            == 5000 * Q16_16_ONE
+                        && q16_16_mul(30000 * Q16_16_ONE, 30000 * Q16_16_ONE)
+                            == INT32_MAX);
+}
+
+static void test_mul(void)
+{
+    unsigned int x, y;
+    uint32_t a, b;
+    bool ok8, ok16;
+
+    ok8 = true;
+    for(x = 0; x < 256; ++x){
+        for(y = 0; y < 256; ++y){
+            if(mul8(x, y) != (x * y + 127) / 255){
+                ok8 = false;
+            }
+        }
+    }
+
+    ok16 = true;
+    for(a = 0; a <= UINT16_MAX; a += 251){
+        for(b = 0; b <= UINT16_MAX; b += 257){
+            if(mul16(a, b) != (a * b + 32767) / 65535){
+                ok16 = false;
+            }
+        }
+    }
+
+    check("mul8", ok8);
+    check("mul16", ok16 && mul16(UINT16_MAX, UINT16_MAX) == UINT16_MAX);
+}
+
+static void test_lerp(void)
+{
+    unsigned int x, y, t;
+    double err8, err88, err1616, ref;
+    int32_t a, b;
+
+    err8 = 0.0;
+    for(x = 0; x < 256; x += 5){
+        for(y = 0; y < 256; y += 3){
+            for(t = 0; t < 256; ++t){
+                ref = x + (y - (double) x) * t / 255.0;
+                err8 = fmax(err8, fabs(lerp8(x, y, t) - ref));
+            }
+        }
+    }
+
+    err88 = err1616 = 0.0;
+    for(a = -32768; a < 32768; a += 4099){
+        for(b = -32768; b < 32768; b += 3001){
+            for(t = 0; t <= Q8_8_ONE; ++t){
+                ref = a + (b - (double) a) * t / Q8_8_ONE;
+                err88 = fmax(err88, fabs(q8_8_lerp(a, b, t) - ref));
+
+                ref = a * 65536.0 + (b - (double) a) * 65536.0 * t / 256.0;
+                err1616 = fmax(err1616, fabs(q16_16_lerp(a * 65536, b * 65536,
+                                                         t << 8) - ref));
+            }
+        }
+    }
+
+    report("lerp8", err8, 0.5);
+    report("q8_8_lerp", err88, 1.0);
+    report("q16_16_lerp", err1616, 1.0);
+    check("lerp ends", lerp8(17, 230, 0) == 17 && lerp8(17, 230, 255) == 230
+                       && q8_8_lerp(-5, 700, Q8_8_ONE) == 700
+                       && q16_16_lerp(-5, 700000, Q16_16_ONE) == 700000);
+}
+
+int main(void)
+{
+    test_table();
+    test_sin();
+    test_sin8();
+    test_ease();
+    test_saturate();
+    test_mul();
+    test_lerp();
+
+    if(failures > 0){
+        printf("%u checks FAILED\n", failures);
+        return EXIT_FAILURE;
+    }
+
+    printf("all checks passed\n");
+
+    return EXIT_SUCCESS;
+}
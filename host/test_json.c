@@ -0,0 +1,183 @@
+/**
+ * RTL8710 Blinkenlights. WiFi-controlled WS2812B LED strip.
+ * Copyright (C) 2016  Tido Klaassen <tido@4gh.eu>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/* Checks for the JSON tokenizer in src/json.c. Prints one line per check
+ * and fails if any of them does not give the expected result.
+ *
+ * Usage: test_json
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "json.h"
+
+static unsigned int failures = 0;
+
+static void check(const char *name, bool ok)
+{
+    printf("%-32s %s\n", name, ok ? "ok" : "FAILED");
+
+    if(!ok){
+        ++failures;
+    }
+}
+
+/* run the tokenizer over all of text, true if it reached the end */
+static bool parses(const char *text)
+{
+    struct json_parser p;
+    struct json_token tok;
+    enum json_type type;
+
+    json_init(&p, text, strlen(text));
+    do{
+        type = json_next(&p, &tok);
+    }while(type != json_end && type != json_error);
+
+    return type == json_end;
+}
+
+static void test_syntax(void)
+{
+    static const char *const good[] = {
+        "{}", " [ ] ", "0", "-12.5e+3", "\"a\\u00e4\\n\"", "true",
+        "{\"a\":{\"b\":[1,2,{\"c\":null}]},\"d\":false}",
+    };
+    static const char *const bad[] = {
+        "", "{", "{\"a\"}", "{\"a\":}", "{\"a\":1,}", "[1,]", "[1 2]",
+        "{\"a\":1]", "01", "1.", "-", "tru", "nullx", "\"\\x\"",
+        "\"\\u12g4\"", "\"open", "{} {}", "{'a':1}", "\"a\nb\"",
+    };
+    char name[32];
+    unsigned int i;
+
+    for(i = 0; i < sizeof(good) / sizeof(*good); ++i){
+        snprintf(name, sizeof(name), "valid %u", i);
+        check(name, parses(good[i]));
+    }
+
+    for(i = 0; i < sizeof(bad) / sizeof(*bad); ++i){
+        snprintf(name, sizeof(name), "invalid %u", i);
+        check(name, !parses(bad[i]));
+    }
+}
+
+static void test_tokens(void)
+{
+    static const char text[] = "{ \"fade\" : { \"min\": 10 }, \"x\": [true] }";
+    static const char broken[] = "{\"a\":1 x";
+    static const enum json_type expect[] = {
+        json_obj_start, json_key, json_obj_start, json_key, json_number,
+        json_obj_end, json_key, json_arr_start, json_literal, json_arr_end,
+        json_obj_end, json_end,
+    };
+    struct json_parser p;
+    struct json_token tok;
+    unsigned int i;
+    bool ok;
+
+    json_init(&p, text, strlen(text));
+    ok = true;
+    for(i = 0; i < sizeof(expect) / sizeof(*expect); ++i){
+        if(json_next(&p, &tok) != expect[i]){
+            ok = false;
+        }
+
+        if(i == 1){
+            ok = ok && tok.len == 4 && !memcmp(tok.start, "fade", 4);
+        }
+    }
+
+    check("token sequence", ok);
+
+    /* errors point at the offending character */
+    json_init(&p, broken, strlen(broken));
+    while(json_next(&p, &tok) != json_error)
+        ;
+
+    check("error position", tok.start - broken == 7);
+}
+
+static void test_skip(void)
+{
+    static const char text[] = "{\"a\":{\"b\":[1,{\"c\":2}]},\"d\":3}";
+    struct json_parser p;
+    struct json_token tok;
+    bool ok;
+
+    json_init(&p, text, strlen(text));
+    json_next(&p, &tok);
+    json_next(&p, &tok);
+    json_next(&p, &tok);
+    ok = json_skip(&p, &tok) == 0;
+    ok = ok && json_next(&p, &tok) == json_key && tok.len == 1
+            && tok.start[0] == 'd';
+
+    check("skip nested value", ok);
+
+    json_init(&p, "{\"a\":[1,", 8);
+    json_next(&p, &tok);
+    json_next(&p, &tok);
+    json_next(&p, &tok);
+    check("skip truncated value", json_skip(&p, &tok) != 0);
+}
+
+static bool int_value(const char *text, int32_t *value)
+{
+    struct json_parser p;
+    struct json_token tok;
+
+    json_init(&p, text, strlen(text));
+    json_next(&p, &tok);
+
+    return json_int(&tok, value) == 0;
+}
+
+static void test_int(void)
+{
+    int32_t val;
+
+    check("int 0", int_value("0", &val) && val == 0);
+    check("int -1000", int_value("-1000", &val) && val == -1000);
+    check("int max", int_value("2147483647", &val) && val == INT32_MAX);
+    check("int min", int_value("-2147483648", &val) && val == INT32_MIN);
+    check("int overflow", !int_value("2147483648", &val));
+    check("int fraction", !int_value("1.5", &val));
+    check("int exponent", !int_value("1e3", &val));
+    check("int string", !int_value("\"1\"", &val));
+}
+
+int main(void)
+{
+    test_syntax();
+    test_tokens();
+    test_skip();
+    test_int();
+
+    if(failures > 0){
+        printf("%u checks FAILED\n", failures);
+        return EXIT_FAILURE;
+    }
+
+    printf("all checks passed\n");
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,344 @@
+/**
+ * RTL8710 Blinkenlights. WiFi-controlled WS2812B LED strip.
+ * Copyright (C) 2016  Tido Klaassen <tido@4gh.eu>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/* Assembler for blinken effect programs.
+ *
+ * One instruction per line, comments start with ';'. Labels end with ':'
+ * and may be used as jump targets. Numbers are fixed point, so "push 0.5"
+ * pushes 128. The smallest push encoding is chosen automatically.
+ *
+ *     .mode pixel|frame
+ *     loop:   ld r0
+ *             push 1.5
+ *             add
+ *             jnz loop
+ *
+ * Usage: vmasm [-o output] input
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include "crc32.h"
+#include "vm.h"
+
+#define MAX_LABELS      128
+#define MAX_NAME        32
+#define MAX_LINE        256
+
+struct label {
+    char name[MAX_NAME];
+    unsigned int addr;
+};
+
+struct asm_state {
+    const char *file;
+    unsigned int line;
+    struct label labels[MAX_LABELS];
+    unsigned int num_labels;
+    struct vm_program prog;
+    unsigned int pc;
+    int pass;
+};
+
+static void asm_error(struct asm_state *as, const char *msg, const char *arg)
+{
+    fprintf(stderr, "%s:%u: %s%s%s\n", as->file, as->line, msg,
+            arg != NULL ? ": " : "", arg != NULL ? arg : "");
+    exit(EXIT_FAILURE);
+}
+
+static struct label *find_label(struct asm_state *as, const char *name)
+{
+    unsigned int i;
+
+    for(i = 0; i < as->num_labels; ++i){
+        if(!strcmp(as->labels[i].name, name)){
+            return &as->labels[i];
+        }
+    }
+
+    return NULL;
+}
+
+static void add_label(struct asm_state *as, const char *name)
+{
+    struct label *label;
+
+    /* labels are collected in the first pass only */
+    if(as->pass != 1){
+        return;
+    }
+
+    if(find_label(as, name) != NULL){
+        asm_error(as, "duplicate label", name);
+    }
+
+    if(as->num_labels >= MAX_LABELS || strlen(name) >= MAX_NAME){
+        asm_error(as, "too many labels or name too long", name);
+    }
+
+    label = &as->labels[as->num_labels++];
+    strcpy(label->name, name);
+    label->addr = as->pc;
+}
+
+static void emit(struct asm_state *as, uint32_t val, unsigned int bytes)
+{
+    unsigned int i;
+
+    if(as->pc + bytes > VM_MAX_CODE){
+        asm_error(as, "program too large", NULL);
+    }
+
+    for(i = 0; i < bytes; ++i){
+        as->prog.code[as->pc++] = (uint8_t) (val >> (8 * i));
+    }
+}
+
+static int find_op(const char *name)
+{
+    unsigned int i;
+
+    for(i = 0; i < VM_OP_LAST; ++i){
+        if(!strcmp(vm_opinfo[i].name, name)){
+            return (int) i;
+        }
+    }
+
+    return -1;
+}
+
+static int32_t parse_number(struct asm_state *as, const char *arg)
+{
+    char *end;
+    double val;
+
+    if(arg == NULL){
+        asm_error(as, "missing operand", NULL);
+    }
+
+    val = strtod(arg, &end);
+    if(*end != '\0'){
+        asm_error(as, "bad number", arg);
+    }
+
+    val = round(val * 256.0);
+    if(val > INT32_MAX || val < INT32_MIN){
+        asm_error(as, "number out of range", arg);
+    }
+
+    return (int32_t) val;
+}
+
+static void assemble_op(struct asm_state *as, char *mnem, char *arg)
+{
+    struct label *label;
+    unsigned int reg;
+    int32_t val;
+    char *end;
+    int op;
+
+    if(!strcmp(mnem, "push")){
+        val = parse_number(as, arg);
+        if(val >= INT8_MIN && val <= INT8_MAX){
+            op = VM_PUSH8;
+        } else if(val >= INT16_MIN && val <= INT16_MAX){
+            op = VM_PUSH16;
+        } else {
+            op = VM_PUSH32;
+        }
+
+        emit(as, (uint32_t) op, 1);
+        emit(as, (uint32_t) val, vm_opinfo[op].imm);
+        return;
+    }
+
+    op = find_op(mnem);
+    if(op < 0){
+        asm_error(as, "unknown instruction", mnem);
+    }
+
+    if(vm_opinfo[op].imm == 0 && arg != NULL){
+        asm_error(as, "unexpected operand", arg);
+    }
+
+    emit(as, (uint32_t) op, 1);
+
+    switch(op){
+    case VM_PUSH8:
+    case VM_PUSH16:
+    case VM_PUSH32:
+        emit(as, (uint32_t) parse_number(as, arg), vm_opinfo[op].imm);
+        break;
+    case VM_LD:
+    case VM_ST:
+        if(arg == NULL){
+            asm_error(as, "missing register", NULL);
+        }
+
+        reg = strtoul(arg[0] == 'r' ? arg + 1 : arg, &end, 10);
+        if(*end != '\0' || reg >= VM_NUM_REGS){
+            asm_error(as, "bad register", arg);
+        }
+
+        emit(as, reg, 1);
+        break;
+    case VM_JMP:
+    case VM_JZ:
+    case VM_JNZ:
+        if(arg == NULL){
+            asm_error(as, "missing jump target", NULL);
+        }
+
+        label = find_label(as, arg);
+        if(label == NULL && as->pass == 2){
+            asm_error(as, "unknown label", arg);
+        }
+
+        emit(as, label != NULL ? label->addr : 0, 2);
+        break;
+    default:
+        break;
+    }
+}
+
+static void assemble_line(struct asm_state *as, char *line)
+{
+    char *tok, *arg, *colon, *p;
+
+    p = strchr(line, ';');
+    if(p != NULL){
+        *p = '\0';
+    }
+
+    for(p = line; *p; ++p){
+        *p = tolower((unsigned char) *p);
+    }
+
+    tok = strtok(line, " \t\r\n");
+    if(tok == NULL){
+        return;
+    }
+
+    colon = strchr(tok, ':');
+    if(colon != NULL){
+        if(colon[1] != '\0'){
+            asm_error(as, "bad label", tok);
+        }
+
+        *colon = '\0';
+        add_label(as, tok);
+
+        tok = strtok(NULL, " \t\r\n");
+        if(tok == NULL){
+            return;
+        }
+    }
+
+    arg = strtok(NULL, " \t\r\n");
+    if(strtok(NULL, " \t\r\n") != NULL){
+        asm_error(as, "too many operands", tok);
+    }
+
+    if(!strcmp(tok, ".mode")){
+        if(arg != NULL && !strcmp(arg, "pixel")){
+            as->prog.hdr.mode = vm_pixel;
+        } else if(arg != NULL && !strcmp(arg, "frame")){
+            as->prog.hdr.mode = vm_frame;
+        } else {
+            asm_error(as, "mode must be pixel or frame", arg);
+        }
+        return;
+    }
+
+    assemble_op(as, tok, arg);
+}
+
+int main(int argc, char *argv[])
+{
+    static struct asm_state as;
+    char line[MAX_LINE];
+    const char *in_name, *out_name;
+    FILE *in, *out;
+    size_t len;
+
+    in_name = NULL;
+    out_name = "a.bin";
+
+    if(argc == 4 && !strcmp(argv[1], "-o")){
+        out_name = argv[2];
+        in_name = argv[3];
+    } else if(argc == 2){
+        in_name = argv[1];
+    } else {
+        fprintf(stderr, "usage: %s [-o output] input\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    in = fopen(in_name, "r");
+    if(in == NULL){
+        perror(in_name);
+        return EXIT_FAILURE;
+    }
+
+    as.file = in_name;
+    for(as.pass = 1; as.pass <= 2; ++as.pass){
+        rewind(in);
+        as.line = 0;
+        as.pc = 0;
+        as.prog.hdr.mode = vm_pixel;
+
+        while(fgets(line, sizeof(line), in) != NULL){
+            ++as.line;
+            assemble_line(&as, line);
+        }
+    }
+    fclose(in);
+
+    as.prog.hdr.magic = VM_MAGIC;
+    as.prog.hdr.version = VM_VERSION;
+    as.prog.hdr.code_len = (uint16_t) as.pc;
+    as.prog.hdr.crc = crc32_update(0, as.prog.code, as.pc);
+
+    len = sizeof(as.prog.hdr) + as.pc;
+    if(vm_verify(&as.prog, len) != 0){
+        fprintf(stderr, "%s: program failed verification\n", in_name);
+        return EXIT_FAILURE;
+    }
+
+    out = fopen(out_name, "wb");
+    if(out == NULL){
+        perror(out_name);
+        return EXIT_FAILURE;
+    }
+
+    if(fwrite(&as.prog, 1, len, out) != len){
+        perror(out_name);
+        fclose(out);
+        return EXIT_FAILURE;
+    }
+    fclose(out);
+
+    printf("%s: %u bytes of code, %s mode\n", out_name, as.pc,
+           as.prog.hdr.mode == vm_frame ? "frame" : "pixel");
+
+    return EXIT_SUCCESS;
+}
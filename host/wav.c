@@ -0,0 +1,133 @@
+/**
+ * RTL8710 Blinkenlights. WiFi-controlled WS2812B LED strip.
+ * Copyright (C) 2016  Tido Klaassen <tido@4gh.eu>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "wav.h"
+
+static uint32_t get_le32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+static uint16_t get_le16(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+int wav_open(struct wav_file *wav, const char *name)
+{
+    uint8_t hdr[16];
+    uint32_t len;
+    int have_fmt;
+
+    memset(wav, 0x0, sizeof(*wav));
+
+    wav->fp = fopen(name, "rb");
+    if(wav->fp == NULL){
+        perror(name);
+        return -1;
+    }
+
+    if(fread(hdr, 1, 12, wav->fp) != 12
+       || memcmp(hdr, "RIFF", 4) != 0 || memcmp(hdr + 8, "WAVE", 4) != 0){
+        fprintf(stderr, "%s: not a WAV file\n", name);
+        goto err_out;
+    }
+
+    /* walk the chunks up to the sample data */
+    have_fmt = 0;
+    while(fread(hdr, 1, 8, wav->fp) == 8){
+        len = get_le32(hdr + 4);
+
+        if(memcmp(hdr, "fmt ", 4) == 0){
+            if(len < 16 || fread(hdr, 1, 16, wav->fp) != 16){
+                break;
+            }
+
+            if(get_le16(hdr) != 1 || get_le16(hdr + 14) != 16){
+                fprintf(stderr, "%s: only 16 bit PCM is supported\n", name);
+                goto err_out;
+            }
+
+            wav->channels = get_le16(hdr + 2);
+            wav->rate = get_le32(hdr + 4);
+            have_fmt = 1;
+
+            len -= 16;
+        } else if(memcmp(hdr, "data", 4) == 0){
+            if(!have_fmt || wav->channels == 0 || wav->rate == 0){
+                break;
+            }
+
+            wav->remaining = len;
+            return 0;
+        }
+
+        /* chunks are padded to an even length */
+        if(fseek(wav->fp, len + (len & 1), SEEK_CUR) != 0){
+            break;
+        }
+    }
+
+    fprintf(stderr, "%s: no sample data found\n", name);
+
+err_out:
+    fclose(wav->fp);
+    wav->fp = NULL;
+    return -1;
+}
+
+unsigned int wav_read(struct wav_file *wav, int16_t samples[],
+                      unsigned int num)
+{
+    uint8_t frame[2 * 8];
+    unsigned int i, ch, size;
+    int32_t sum;
+
+    size = 2 * wav->channels;
+    if(size > sizeof(frame)){
+        return 0;
+    }
+
+    for(i = 0; i < num && wav->remaining >= size; ++i){
+        if(fread(frame, 1, size, wav->fp) != size){
+            wav->remaining = 0;
+            break;
+        }
+        wav->remaining -= size;
+
+        sum = 0;
+        for(ch = 0; ch < wav->channels; ++ch){
+            sum += (int16_t) get_le16(frame + 2 * ch);
+        }
+
+        samples[i] = (int16_t) (sum / (int32_t) wav->channels);
+    }
+
+    return i;
+}
+
+void wav_close(struct wav_file *wav)
+{
+    if(wav->fp != NULL){
+        fclose(wav->fp);
+        wav->fp = NULL;
+    }
+}
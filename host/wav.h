@@ -0,0 +1,41 @@
+/**
+ * RTL8710 Blinkenlights. WiFi-controlled WS2812B LED strip.
+ * Copyright (C) 2016  Tido Klaassen <tido@4gh.eu>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+#ifndef __WAV_H__
+#define __WAV_H__
+
+/* Minimal reader for 16 bit PCM WAV files, used to feed recorded sound
+ * into the audio analysis on the host. */
+#include <stdio.h>
+#include <stdint.h>
+
+struct wav_file {
+    FILE *fp;
+    unsigned int rate;
+    unsigned int channels;
+    uint32_t remaining;     // bytes of sample data left
+};
+
+extern int wav_open(struct wav_file *wav, const char *name);
+
+/* Read up to num samples, mixed down to mono. Returns the number read. */
+extern unsigned int wav_read(struct wav_file *wav, int16_t samples[],
+                             unsigned int num);
+extern void wav_close(struct wav_file *wav);
+
+#endif
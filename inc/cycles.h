@@ -0,0 +1,45 @@
+/**
+ * RTL8710 Blinkenlights. WiFi-controlled WS2812B LED strip.
+ * Copyright (C) 2016  Tido Klaassen <tido@4gh.eu>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+#ifndef __CYCLES_H__
+#define __CYCLES_H__
+
+/* Cycle counter of the Cortex-M3's DWT unit. At 166 MHz it wraps after
+ * about 25 s, differences of two readings are fine for anything shorter. */
+#include <stdint.h>
+
+#define DWT_CTRL            (*(volatile uint32_t *) 0xE0001000)
+#define DWT_CYCCNT          (*(volatile uint32_t *) 0xE0001004)
+#define SCB_DEMCR           (*(volatile uint32_t *) 0xE000EDFC)
+
+#define DWT_CTRL_CYCCNTENA  (1UL << 0)
+#define SCB_DEMCR_TRCENA    (1UL << 24)
+
+static inline void cycles_init(void)
+{
+    SCB_DEMCR |= SCB_DEMCR_TRCENA;
+    DWT_CYCCNT = 0;
+    DWT_CTRL |= DWT_CTRL_CYCCNTENA;
+}
+
+static inline uint32_t cycles_now(void)
+{
+    return DWT_CYCCNT;
+}
+
+#endif
@@ -49,6 +49,10 @@
 #define AP_SETTING_SECTOR		0x000FE000
 #define UART_SETTING_SECTOR		0x000FC000
 #define LED_SETTINGS_SECTOR     0x000FA000
+#define BLINKEN_VM_SECTOR       0x000F9000
+#define BLINKEN_LOG_SECTOR      0x000F5000
+#define BLINKEN_LOG_SECTORS     4
+#define BLINKEN_PRESET_SECTOR   0x000F4000
 #define FAST_RECONNECT_DATA 	(0x80000 - 0x1000)
 
 /**
@@ -0,0 +1,78 @@
+/* generated by host/mkassets, do not edit */
+#include "assets.h"
+
+static const uint8_t asset_0[396] = {
+   0x1f,0x8b,0x08,0x00,0x00,0x00,0x00,0x00,0x02,0x03,0xa5,0x93,
+   0x4d,0x6e,0x83,0x30,0x14,0x84,0xf7,0x9c,0x02,0x29,0xaa,0xb2,
+   0xa2,0x32,0x3f,0xa9,0x5a,0xb3,0x2b,0x12,0x52,0xd7,0x55,0x0f,
+   0x60,0xb0,0x01,0xab,0xc4,0xcf,0x32,0xa6,0x49,0x1a,0xf5,0xee,
+   0xb5,0xc1,0x69,0x20,0x21,0xd9,0x74,0x87,0xb1,0x67,0xde,0xe7,
+   0x61,0x28,0x80,0x1e,0xfc,0xa3,0xa7,0xd9,0x5e,0x07,0xa4,0xe5,
+   0xb5,0xc0,0x25,0x13,0x9a,0xa9,0xd4,0xab,0x40,0xe8,0xa0,0x22,
+   0x5b,0xde,0x1e,0xb0,0xbf,0x7e,0x67,0x35,0x30,0xff,0xe3,0x6d,
+   0x9d,0x7a,0x3f,0xde,0xe3,0x4e,0x11,0x29,0x99,0x9a,0x0b,0x5b,
+   0x56,0xe9,0xd4,0xdb,0x12,0x55,0x73,0x81,0x91,0x4f,0x7a,0x0d,
+   0xa7,0x65,0xa0,0x41,0xe2,0x08,0x21,0xb9,0x4f,0xbd,0x02,0x14,
+   0x65,0x0a,0xaf,0x10,0x42,0xa9,0xb7,0xe3,0x54,0x37,0x78,0x33,
+   0xee,0x18,0xe3,0x86,0x11,0x3a,0xf8,0x16,0xa4,0xfc,0xac,0x15,
+   0xf4,0x82,0x06,0x25,0xb4,0x60,0xce,0x67,0xf9,0x8b,0x83,0xea,
+   0xf8,0x37,0xc3,0xe1,0xb3,0x95,0xb4,0x5c,0xb0,0xa0,0x61,0xbc,
+   0x6e,0xb4,0x71,0xb1,0x6f,0x16,0x6e,0x62,0x7c,0x41,0x30,0x7b,
+   0xd4,0x18,0x8f,0x13,0x43,0x84,0x1e,0x4e,0x28,0x81,0x05,0xc7,
+   0xab,0x3c,0x8b,0xfd,0x70,0xb0,0x98,0x0c,0xd9,0xd8,0xb5,0xf3,
+   0x8f,0x87,0xcd,0xc9,0x85,0x62,0x07,0x6d,0xf5,0x8b,0xc8,0x79,
+   0x8e,0xe6,0x88,0xa3,0x85,0x5b,0x8c,0x0c,0x23,0x4f,0x6c,0x1f,
+   0xab,0x16,0x88,0x76,0x31,0x4a,0x42,0x29,0x17,0xf5,0xc8,0x16,
+   0x9d,0xe2,0x51,0x56,0x68,0x46,0x39,0x88,0xf9,0x66,0x01,0xfb,
+   0xbf,0xfb,0x25,0xd6,0xcf,0xcd,0x89,0x9e,0x27,0xdc,0x17,0x12,
+   0x2d,0x6e,0x67,0xed,0xe4,0xc9,0x9d,0x58,0xad,0x9e,0x0b,0xd9,
+   0x5b,0xa6,0x49,0x6a,0x4f,0x57,0xa9,0xb9,0xd4,0x37,0xd3,0x06,
+   0xa0,0xcb,0x0f,0x78,0x15,0xf0,0xe6,0x7c,0x3a,0x50,0x84,0xf2,
+   0xbe,0x73,0xe8,0x4b,0x51,0xe7,0x73,0x22,0xdc,0xc0,0x17,0x53,
+   0x47,0xaf,0xec,0x55,0x67,0x0e,0x48,0xe0,0x23,0xf5,0x82,0xf4,
+   0x35,0x41,0x49,0x32,0xa8,0x2b,0x00,0x7d,0xe7,0x6f,0x98,0x74,
+   0x62,0xca,0x1d,0xcd,0x7a,0x9d,0x65,0x99,0xf5,0x5a,0xc9,0x1d,
+   0x35,0x56,0x94,0x77,0xb2,0x25,0x07,0x2c,0x4c,0x03,0xed,0x6b,
+   0xe8,0xf5,0x18,0xd7,0x7f,0xda,0x12,0x9e,0xdb,0x32,0x34,0xe2,
+   0x46,0x5d,0x7e,0x01,0xfe,0xce,0xcf,0xd9,0xdc,0x03,0x00,0x00,
+};
+
+static const uint8_t asset_1[354] = {
+   0x1f,0x8b,0x08,0x00,0x00,0x00,0x00,0x00,0x02,0x03,0x95,0x92,
+   0x5d,0x4f,0x83,0x30,0x14,0x86,0xef,0xf9,0x15,0x67,0xc4,0x0b,
+   0x3a,0x03,0xe8,0x76,0x33,0xa3,0x98,0xcc,0xaf,0x64,0x77,0x4b,
+   0xf0,0x4a,0xa3,0xa6,0xc0,0x81,0x11,0xbb,0x96,0xd0,0xe2,0xc6,
+   0xdc,0xfe,0xfb,0x0a,0x13,0x99,0x53,0xe7,0xec,0x45,0xd3,0xb4,
+   0xef,0xf9,0x78,0x9f,0xd3,0xb8,0xe0,0xa1,0x4a,0x05,0x07,0xc1,
+   0xaf,0x27,0x94,0x27,0xe8,0x63,0x78,0x5f,0x66,0x68,0x11,0xe3,
+   0xdd,0x00,0xbd,0xe6,0x5e,0x24,0xc2,0x62,0x8a,0x5c,0x39,0x09,
+   0xaa,0x5b,0x86,0xd5,0xf1,0xaa,0x1c,0x45,0x96,0x29,0x31,0x34,
+   0xc9,0x79,0xad,0x2a,0x7f,0x57,0x65,0xb3,0xa8,0x51,0xa5,0xb1,
+   0x35,0x77,0xde,0x28,0x2b,0x10,0x3c,0x0f,0x4c,0x91,0x21,0x37,
+   0xc9,0xa6,0x4c,0x9d,0xc4,0x91,0xaa,0x64,0xe8,0x44,0xa9,0xcc,
+   0x18,0x2d,0x3d,0x93,0x0b,0x8e,0xe6,0x26,0x74,0x85,0x4c,0xe2,
+   0x1e,0x69,0xc0,0x44,0xf8,0xda,0x68,0x8d,0x95,0x61,0xc4,0xad,
+   0x31,0xbf,0x08,0xa6,0xa9,0xba,0x13,0xf9,0xf4,0x10,0x57,0xbe,
+   0x4c,0xa3,0xff,0xd9,0x5a,0xec,0x55,0xbd,0x68,0xc3,0xdf,0x01,
+   0x38,0x0c,0x79,0xa2,0x26,0x97,0xfd,0x1e,0xa9,0x5f,0x5a,0x6b,
+   0x94,0x61,0xae,0x74,0x1b,0x22,0x56,0xc3,0x31,0xf8,0xfe,0xe8,
+   0x06,0x52,0x09,0x4a,0x08,0x60,0x82,0x27,0x1d,0xeb,0xd4,0xd6,
+   0x31,0x4d,0xc2,0x6a,0xe5,0xa8,0x8a,0x9c,0x43,0x4c,0x35,0xa1,
+   0x06,0x40,0xb5,0xbb,0x5d,0x5d,0xae,0x63,0xb9,0xcf,0x8f,0x43,
+   0xfb,0x81,0xda,0x8b,0x13,0xfb,0xec,0xe9,0xf8,0xc8,0x75,0x14,
+   0x4a,0xd5,0xb4,0x41,0xc8,0x01,0xe5,0x43,0x5a,0x51,0x64,0x25,
+   0x04,0x08,0x5b,0xb9,0xfe,0xe8,0xa1,0xeb,0x36,0x96,0x77,0x86,
+   0x55,0xcf,0x7e,0x33,0xaf,0xdd,0xe2,0x5a,0x6c,0x2d,0xbe,0x00,
+   0x82,0x0b,0x18,0x90,0xe5,0x72,0xe7,0xb6,0xc2,0x46,0x3e,0xa3,
+   0xda,0xf8,0x2d,0x03,0x63,0x2a,0xe5,0x4c,0xe4,0x11,0x7c,0xe4,
+   0xd1,0x0c,0x03,0x54,0x33,0x44,0x0e,0x03,0x4d,0x13,0xfa,0xbd,
+   0xed,0xfe,0x7f,0xf6,0xd0,0xb2,0xac,0xbe,0xd4,0x1a,0x79,0x82,
+   0x6d,0x3c,0x2b,0x03,0x00,0x00,
+};
+
+const struct blinken_asset blinken_assets[] = {
+    { "/style.css", "text/css", asset_0, sizeof(asset_0), 0x67cf1e07 },
+    { "/wifi.js", "application/javascript", asset_1, sizeof(asset_1), 0x05d5c71a },
+};
+
+const unsigned int blinken_num_assets = 2;
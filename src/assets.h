@@ -0,0 +1,39 @@
+/**
+ * RTL8710 Blinkenlights. WiFi-controlled WS2812B LED strip.
+ * Copyright (C) 2016  Tido Klaassen <tido@4gh.eu>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+#ifndef __ASSETS_H__
+#define __ASSETS_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* The files in web/, gzip compressed by host/mkassets and linked into the
+ * firmware as constant data. They are served from where they are. */
+struct blinken_asset
+{
+    const char *path;
+    const char *type;
+    const uint8_t *data;
+    size_t len;
+    uint32_t crc;       // of data, serves as ETag
+};
+
+extern const struct blinken_asset blinken_assets[];
+extern const unsigned int blinken_num_assets;
+
+#endif
@@ -0,0 +1,250 @@
+/**
+ * RTL8710 Blinkenlights. WiFi-controlled WS2812B LED strip.
+ * Copyright (C) 2016  Tido Klaassen <tido@4gh.eu>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "fixmath.h"
+#include "audio.h"
+
+/* band edges in Hz, the last one is the Nyquist frequency */
+static const uint16_t edge_hz[AUDIO_BANDS + 1] = {
+    40, 250, 1000, 2500, AUDIO_RATE / 2
+};
+
+/* smallest band amplitude the gain control will scale up to full range */
+#define AUDIO_FLOOR     16u
+#define AUDIO_AGC_MS    4000u
+#define AUDIO_AVG_MS    1000
+#define AUDIO_BEAT_MS   250u
+#define AUDIO_HOLDOFF   250u    // at most 240 beats per minute
+
+/* k is given in 1/AUDIO_FFT_MAX turns, which falls on the entries of the
+ * shared sine table */
+static inline int32_t sin_q15(uint32_t k)
+{
+    return fix_sin((uint16_t) (k << (16 - AUDIO_FFT_MAX_LOG2)));
+}
+
+static inline int32_t cos_q15(uint32_t k)
+{
+    return fix_cos((uint16_t) (k << (16 - AUDIO_FFT_MAX_LOG2)));
+}
+
+void audio_ring_put(struct audio_ring *ring,
+                    const int16_t samples[], unsigned int num)
+{
+    uint32_t head;
+    unsigned int i;
+
+    head = ring->head;
+    for(i = 0; i < num; ++i){
+        ring->samples[(head + i) & (AUDIO_RING_SIZE - 1)] = samples[i];
+    }
+
+    __sync_synchronize();
+    ring->head = head + num;
+}
+
+/* Copy the latest num samples, num must not exceed AUDIO_RING_SIZE. */
+void audio_ring_get(const struct audio_ring *ring,
+                    int16_t samples[], unsigned int num)
+{
+    uint32_t start;
+    unsigned int i;
+
+    start = ring->head - num;
+    __sync_synchronize();
+
+    for(i = 0; i < num; ++i){
+        samples[i] = ring->samples[(start + i) & (AUDIO_RING_SIZE - 1)];
+    }
+}
+
+void audio_fft(int16_t re[], int16_t im[], unsigned int log2n)
+{
+    uint32_t n, i, j, k, bit, len, half, step;
+    int32_t wr, wi, tr, ti, ur, ui;
+    int16_t tmp;
+
+    n = 1u << log2n;
+
+    /* bit reversed reordering */
+    for(i = 1, j = 0; i < n; ++i){
+        for(bit = n >> 1; j & bit; bit >>= 1){
+            j ^= bit;
+        }
+        j ^= bit;
+
+        if(i < j){
+            tmp = re[i];
+            re[i] = re[j];
+            re[j] = tmp;
+
+            tmp = im[i];
+            im[i] = im[j];
+            im[j] = tmp;
+        }
+    }
+
+    for(len = 2; len <= n; len <<= 1){
+        half = len >> 1;
+        step = AUDIO_FFT_MAX / len;
+
+        /* each twiddle factor is looked up once per stage */
+        for(k = 0; k < half; ++k){
+            wr = cos_q15(k * step);
+            wi = -sin_q15(k * step);
+
+            for(i = k; i < n; i += len){
+                j = i + half;
+
+                tr = (wr * re[j] - wi * im[j]) >> 15;
+                ti = (wr * im[j] + wi * re[j]) >> 15;
+                ur = re[i];
+                ui = im[i];
+
+                re[i] = (int16_t) ((ur + tr) >> 1);
+                im[i] = (int16_t) ((ui + ti) >> 1);
+                re[j] = (int16_t) ((ur - tr) >> 1);
+                im[j] = (int16_t) ((ui - ti) >> 1);
+            }
+        }
+    }
+}
+
+int audio_init(struct audio_state *st, unsigned int log2n,
+               int16_t re[], int16_t im[])
+{
+    unsigned int i, n, bin;
+
+    if(log2n < AUDIO_FFT_MIN_LOG2 || log2n > AUDIO_FFT_MAX_LOG2
+       || re == NULL || im == NULL){
+        return -1;
+    }
+
+    memset(st, 0x0, sizeof(*st));
+    st->log2n = log2n;
+    st->re = re;
+    st->im = im;
+    st->threshold = AUDIO_THRESHOLD_DEF;
+    st->peak = AUDIO_FLOOR;
+
+    /* small FFTs have wide bins, keep every band at least one bin wide */
+    n = 1u << log2n;
+    for(i = 0; i <= AUDIO_BANDS; ++i){
+        bin = (edge_hz[i] * n) / AUDIO_RATE;
+        if(i > 0 && bin <= st->edge[i - 1]){
+            bin = st->edge[i - 1] + 1;
+        }
+
+        st->edge[i] = (uint16_t) bin;
+    }
+
+    /* skip the DC bin */
+    if(st->edge[0] == 0){
+        for(i = 0; i <= AUDIO_BANDS; ++i){
+            ++st->edge[i];
+        }
+    }
+
+    st->edge[AUDIO_BANDS] = (uint16_t) (n / 2);
+
+    return 0;
+}
+
+/* |x| approximated as max + min / 2, good to about 12% */
+static inline uint32_t magnitude(int32_t re, int32_t im)
+{
+    uint32_t a, b;
+
+    a = re < 0 ? -re : re;
+    b = im < 0 ? -im : im;
+
+    return a > b ? a + (b >> 1) : b + (a >> 1);
+}
+
+void audio_analyse(struct audio_state *st, const struct audio_ring *ring,
+                   uint32_t delta, struct audio_frame *out)
+{
+    uint32_t amp[AUDIO_BANDS];
+    uint32_t n, i, b, step, sum, loudest, decay, val;
+    int32_t dc, w;
+
+    n = 1u << st->log2n;
+    audio_ring_get(ring, st->re, n);
+
+    /* drop the input's DC offset and apply a Hann window */
+    dc = 0;
+    for(i = 0; i < n; ++i){
+        dc += st->re[i];
+    }
+    dc >>= st->log2n;
+
+    step = AUDIO_FFT_MAX >> st->log2n;
+    for(i = 0; i < n; ++i){
+        w = (32767 - cos_q15(i * step)) >> 1;
+        st->re[i] = sat16(((st->re[i] - dc) * w) >> 15);
+        st->im[i] = 0;
+    }
+
+    audio_fft(st->re, st->im, st->log2n);
+
+    loudest = 0;
+    for(b = 0; b < AUDIO_BANDS; ++b){
+        sum = 0;
+        for(i = st->edge[b]; i < st->edge[b + 1]; ++i){
+            sum += magnitude(st->re[i], st->im[i]);
+        }
+
+        amp[b] = sum / (st->edge[b + 1] - st->edge[b]);
+        loudest = amp[b] > loudest ? amp[b] : loudest;
+    }
+
+    /* the gain control follows a loud passage at once and lets go slowly */
+    decay = (st->peak * delta) / AUDIO_AGC_MS;
+    st->peak = st->peak - decay > AUDIO_FLOOR ? st->peak - decay
+                                              : AUDIO_FLOOR;
+    st->peak = loudest > st->peak ? loudest : st->peak;
+
+    out->level = 0;
+    for(b = 0; b < AUDIO_BANDS; ++b){
+        val = (amp[b] * 255u) / st->peak;
+        out->band[b] = (uint8_t) (val > 255u ? 255u : val);
+        out->level = out->band[b] > out->level ? out->band[b] : out->level;
+    }
+
+    /* A beat is a bass amplitude well above its running average. The
+     * average is only updated afterwards, so the onset is not part of it. */
+    decay = (255u * delta) / AUDIO_BEAT_MS;
+    st->beat = st->beat > decay ? st->beat - decay : 0;
+    st->holdoff = st->holdoff > delta ? st->holdoff - delta : 0;
+
+    out->onset = false;
+    if(st->holdoff == 0 && amp[0] > AUDIO_FLOOR
+       && ((uint64_t) amp[0] << 16) > (uint64_t) st->avg * st->threshold){
+        out->onset = true;
+        st->beat = 255u;
+        st->holdoff = AUDIO_HOLDOFF;
+    }
+
+    st->avg += (((int32_t) amp[0] << 8) - (int32_t) st->avg)
+                * (int32_t) delta / AUDIO_AVG_MS;
+
+    out->beat = (uint8_t) st->beat;
+}
@@ -0,0 +1,86 @@
+/**
+ * RTL8710 Blinkenlights. WiFi-controlled WS2812B LED strip.
+ * Copyright (C) 2016  Tido Klaassen <tido@4gh.eu>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+#ifndef __AUDIO_H__
+#define __AUDIO_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Sound analysis for audio-reactive effects. Samples are collected into a
+ * ring buffer by whatever drives the input, the render task then looks at
+ * the latest window once per frame. */
+#define AUDIO_RATE          8000
+#define AUDIO_RING_SIZE     1024    // must be a power of two
+#define AUDIO_BANDS         4
+
+/* FFT sizes are given as log2. The twiddle table covers up to
+ * AUDIO_FFT_MAX points, the firmware uses AUDIO_FFT_LOG2. */
+#define AUDIO_FFT_MIN_LOG2  6
+#define AUDIO_FFT_MAX_LOG2  10
+#define AUDIO_FFT_MAX       (1u << AUDIO_FFT_MAX_LOG2)
+#define AUDIO_FFT_LOG2      8
+
+/* beat threshold, bass energy over its running average, 8 fractional bits */
+#define AUDIO_THRESHOLD_DEF 384
+#define AUDIO_THRESHOLD_MIN 256
+#define AUDIO_THRESHOLD_MAX 1024
+
+/* Single producer, single consumer. head counts all samples ever written,
+ * so the reader can tell where the latest window starts. */
+struct audio_ring {
+    int16_t samples[AUDIO_RING_SIZE];
+    volatile uint32_t head;
+};
+
+/* per-frame result, all values scaled to 0-255 */
+struct audio_frame {
+    uint8_t level;
+    uint8_t band[AUDIO_BANDS];
+    uint8_t beat;       // 255 on a beat, decaying afterwards
+    bool onset;         // set only in the frame the beat was detected
+};
+
+struct audio_state {
+    unsigned int log2n;
+    int16_t *re;        // work buffers of 1 << log2n entries each
+    int16_t *im;
+    uint16_t edge[AUDIO_BANDS + 1];
+    uint32_t threshold;
+    uint32_t avg;       // running average of the bass band
+    uint32_t peak;      // slowly decaying peak for the gain control
+    uint32_t holdoff;   // ms until the next beat may be detected
+    uint32_t beat;
+};
+
+extern void audio_ring_put(struct audio_ring *ring,
+                           const int16_t samples[], unsigned int num);
+extern void audio_ring_get(const struct audio_ring *ring,
+                           int16_t samples[], unsigned int num);
+
+/* In-place radix-2 FFT on Q15 data. Every stage scales by 1/2 so nothing
+ * overflows, the result is the spectrum divided by 1 << log2n. */
+extern void audio_fft(int16_t re[], int16_t im[], unsigned int log2n);
+
+extern int audio_init(struct audio_state *st, unsigned int log2n,
+                      int16_t re[], int16_t im[]);
+extern void audio_analyse(struct audio_state *st,
+                          const struct audio_ring *ring,
+                          uint32_t delta, struct audio_frame *out);
+
+#endif
@@ -25,18 +25,90 @@
 #include <spi_api.h>
 #include <spi_ex_api.h>
 #include <flash_api.h>
+#include <analogin_api.h>
+#include <timer_api.h>
 #include <platform_opts.h>
 #include <platform_stdlib.h>
+#include <cycles.h>
 #include "device_lock.h"
 #include "ws2812.h"
+#include "noise.h"
+#include "fixmath.h"
+#include "vm.h"
+#include "cfglog.h"
+#include "crc32.h"
+#include "audio.h"
 #include "blinken.h"
 
-enum strip_state
+/* Each zone runs through a sequence of scenes, and a scene decides which of
+ * the zone's filters are dispatched. A zone leaves its scene when one of the
+ * running filters reports that it is done, once the scene's duration is up,
+ * or by chance. The odds are rolled once per period and are set per zone.
+ * The next scene is picked by weight among the ones the zone has the
+ * filters for, optionally crossfading from the last frame. */
+enum scene_id
 {
+    scene_rainbow,
+    scene_flicker,
+    scene_eye,
+    scene_last,
+};
+
+#define SCENE_MAX_NEXT  2
+
+struct scene_next
+{
+    enum scene_id id;
+    uint32_t weight;
+    uint32_t fade;      // crossfade in ms
+};
+
+struct scene
+{
+    uint32_t filters;   // filters dispatched during the scene
+    uint32_t requires;  // filters a zone needs to enter the scene
+    uint32_t duration;  // ms, 0 for no time limit
+    bool by_chance;
+    struct scene_next next[SCENE_MAX_NEXT];
+};
 
-    state_rainbow,
-    state_flicker,
-    state_eye,
+/* The classic show: the rainbow is interrupted by a flicker, after which the
+ * eye wakes up, looks around and goes back to sleep. */
+static const struct scene scenes[scene_last] = {
+    [scene_rainbow] = {
+        .filters = ~(FILTER_FLICKER | FILTER_EYE),
+        .requires = 0,
+        .duration = 0,
+        .by_chance = true,
+        .next = { { scene_flicker, 1, 0 } },
+    },
+    [scene_flicker] = {
+        .filters = ~FILTER_EYE,
+        .requires = FILTER_FLICKER,
+        .duration = 0,
+        .by_chance = false,
+        .next = { { scene_eye, 1, 0 } },
+    },
+    [scene_eye] = {
+        .filters = ~FILTER_FLICKER,
+        .requires = FILTER_EYE,
+        .duration = 0,
+        .by_chance = false,
+        .next = { { scene_rainbow, 1, 0 } },
+    },
+};
+
+struct scene_state
+{
+    enum scene_id id;
+    uint32_t mask;      // filters the zone has
+    uint32_t elapsed;   // ms in the current scene
+    uint32_t roll_time; // ms towards the next roll, kept between scenes
+    uint32_t period;
+    uint32_t odds;      // 1 in odds per roll, 0 for never
+    bool done;
+    bool entered;       // entered while the filters were running
+    uint32_t fade;      // crossfade requested by the last change
 };
 
 struct blinken_cfg strip_cfg;
@@ -44,36 +116,192 @@ volatile unsigned int cfg_updated = 0;
 ws2812_t *ws2812_cfg = NULL;
 
 hsvValue_t hsv_buffer[BLINKEN_MAX_LEDS];
+hsvValue_t layer_buffer[BLINKEN_MAX_LAYERS - 1][BLINKEN_MAX_LEDS];
+rgbValue_t rgb_buffer[BLINKEN_MAX_LEDS];
 
-struct strip_handler
+/* monotonic animation time, advanced once per rendered frame */
+struct anim_clock
+{
+    uint32_t now;
+    uint32_t delta;
+    TickType_t last_tick;
+};
+
+/* A layer is rendered by its own filter chain into its own HSV buffer. The
+ * overlays are blended on top of the base layer in RGB. */
+struct led_layer
 {
-    enum strip_state state;
     struct list_head filters;
+    uint32_t mask;
     hsvValue_t *hsv_vals;
+    enum blend_mode mode;
+    uint8_t opacity;
+};
+
+/* A zone renders its filter chain over a span of the base layer. Zone 0
+ * always spans the whole strip and is the background, the other zones are
+ * rendered after it and draw over their spans. */
+struct led_zone
+{
+    struct list_head filters;
+    struct scene_state scene;
+    unsigned int index;
+    unsigned int offset;
+    unsigned int len;
+    uint32_t mask;
+};
+
+/* Indexed mode replaces the zones on the base layer. The index buffer shares
+ * its storage with the base layer's HSV buffer and the palette is kept in
+ * RGB, so sending a frame needs no colour conversion at all. */
+struct led_palette
+{
+    bool enabled;
+    uint8_t *index;
+    rgbValue_t entries[BLINKEN_PALETTE_SIZE];
+    uint32_t offset;
+    uint32_t repeat;
+    int32_t rate;
+    int32_t rem;
+};
+
+/* All handlers share the LED buffers. Only the active one may touch them, the
+ * others just keep their filter chains ready to take over. */
+struct strip_handler
+{
+    bool active;
+    bool ready;
+    bool modified;
+    struct anim_clock clock;
+    struct led_palette palette;
+    bool audio;
+    uint32_t audio_threshold;
+    struct led_zone zones[BLINKEN_MAX_ZONES];
+    struct led_layer layers[BLINKEN_MAX_LAYERS];
     volatile size_t strip_len;
     volatile uint32_t brightness;
     volatile uint32_t delay;
 };
 
 struct led_filter;
-typedef void (*filter_fn)(struct led_filter *, enum strip_state *,
-              hsvValue_t[], unsigned int);
+typedef void (*filter_fn)(struct led_filter *, struct scene_state *,
+              const struct anim_clock *, hsvValue_t[], unsigned int);
 typedef int (*init_fn)(struct led_filter *, struct blinken_cfg *, bool);
 typedef void (*deinit_fn)(struct led_filter *);
 
+/* time spent in a filter, in CPU cycles */
+struct filter_prof
+{
+    uint32_t calls;
+    uint32_t max;
+    uint64_t total;
+};
+
 struct led_filter
 {
     char *name;
+    unsigned int zone;
     struct list_head filters;
     filter_fn filter;
     init_fn init;
     deinit_fn deinit;
     void *priv;
+    uint32_t mask;
+    struct filter_prof prof;
+};
+
+/* Handler 0 runs the config found at boot, the others are kept prepared for
+ * the preset slots, so switching to a preset is just a pointer swap. */
+struct strip_handler handlers[BLINKEN_MAX_PRESETS + 1];
+struct strip_handler *active_handler = NULL;
+
+#define preset_handler(slot)    (&handlers[(slot) + 1])
+
+/* Presets are stored together in their own flash sector. Each slot has a
+ * fixed place in it and the record keeps the size of the config it holds,
+ * so presets survive the config growing or shrinking. */
+#define PRESET_MAGIC        0x50525354 // "PRST"
+#define PRESET_SLOT_SIZE    (0x1000 / BLINKEN_MAX_PRESETS)
+#define preset_addr(slot)   (BLINKEN_PRESET_SECTOR + (slot) * PRESET_SLOT_SIZE)
+#define PRESET_HDR_SIZE     offsetof(struct preset_rec, cfg)
+
+struct preset_rec {
+    uint32_t magic;
+    uint32_t crc;       // over len, name and the stored config
+    uint32_t len;       // size of the config when it was stored
+    char name[BLINKEN_PRESET_NAME];
+    struct blinken_cfg cfg;
+} __attribute__((packed));
+
+static struct preset_rec presets[BLINKEN_MAX_PRESETS];
+static int active_preset = -1;
+
+/* A preset switch may fade over from a snapshot of the last frame. */
+struct crossfade
+{
+    uint32_t duration;
+    uint32_t elapsed;
 };
 
-struct strip_handler handler;
+static struct crossfade xfade;
+static rgbValue_t fade_buffer[BLINKEN_MAX_LEDS];
+
+/* The microphone is sampled from a timer interrupt into audio_ring. The
+ * render task analyses the latest window once per frame and the filters
+ * pick up the result from audio_now. */
+#define AUDIO_ADC       AD_1
+#define AUDIO_TIMER     TIMER3
+
+struct audio_ring audio_ring;
+static struct audio_state audio_state;
+static struct audio_frame audio_now;
+static int16_t fft_re[1 << AUDIO_FFT_LOG2];
+static int16_t fft_im[1 << AUDIO_FFT_LOG2];
+static analogin_t audio_adc;
+static gtimer_t audio_timer;
+static bool audio_running = false;
+
+/* the effect program shared by all vm filters */
+struct vm_program vm_prog;
+static volatile uint32_t vm_generation = 0;
+static struct blinken_vm_info vm_info;
+
+#define ARRAY_SIZE(x)   (sizeof(x) / sizeof(*x))
+
+/* Changes are handed to the render task, which applies them between two
+ * frames. Writers serialise on cfg_lock, which also protects strip_cfg, the
+ * last applied config. The render task never takes it while running. */
+#define PENDING_CFG     (1 << 0)
+#define PENDING_PROG    (1 << 1)
+#define PENDING_PRESET  (1 << 2)
+#define PENDING_PREP    (1 << 3)
+#define PENDING_PROF    (1 << 4)
+#define APPLY_TIMEOUT   (5 * configTICK_RATE_HZ)
+
+SemaphoreHandle_t cfg_lock = NULL;
+SemaphoreHandle_t cfg_done = NULL;
+static volatile uint32_t pending_mask = 0;
+static volatile int pending_result = 0;
+static struct blinken_cfg cfg_next;
+static struct vm_program vm_next;
+static unsigned int slot_next;
+static uint32_t fade_next;
+static struct blinken_prof_info *prof_next;
+static unsigned int prof_num;
+static bool prof_reset;
+
+/* Saving is left to a low priority task. It waits for changes to settle, so
+ * a burst of updates ends up in flash only once. cfg_generation counts the
+ * changes applied, saved_generation the last one written. The web server
+ * also tags the root page with cfg_generation. */
+#define PERSIST_SETTLE  (2 * configTICK_RATE_HZ)
+
+SemaphoreHandle_t persist_sema = NULL;
+static volatile uint32_t cfg_generation = 0;
+static volatile uint32_t saved_generation = 0;
+static struct blinken_persist_info persist_info;
+static struct blinken_cfg cfg_save;
 
-SemaphoreHandle_t cfg_sema = NULL;
 volatile uint8_t ledstrip_terminate = 0;
 
 static uint64_t state0 = 1;
@@ -94,6 +322,149 @@ unsigned int urand(void)
     return (unsigned int) (state0 + state1);
 }
 
+static void scene_reset(struct scene_state *scene)
+{
+    scene->id = scene_rainbow;
+    scene->elapsed = 0;
+    scene->roll_time = 0;
+    scene->done = false;
+    scene->entered = false;
+    scene->fade = 0;
+}
+
+/* The chance to interrupt the rainbow is rolled once per reference frame and
+ * LED of the zone, with the odds given by the eye's rate. Only zones running
+ * the eye roll at all. */
+static void scene_setup(struct scene_state *scene, uint32_t mask,
+                        unsigned int len, const struct cfg_eye *eye)
+{
+    scene->mask = mask;
+    scene->period = len * BLINKEN_FRAME_MS;
+    scene->odds = 0;
+
+    if((mask & FILTER_EYE) && len >= 3 && eye->rate != 0){
+        scene->odds = 100 / eye->rate;
+    }
+}
+
+/* Move on to one of the scene's successors the zone can run. Picking among
+ * several takes a random number, a single candidate does not. */
+static void scene_switch(struct scene_state *scene)
+{
+    const struct scene_next *next, *pick;
+    uint32_t total, roll;
+    unsigned int i;
+
+    next = scenes[scene->id].next;
+
+    total = 0;
+    pick = NULL;
+    for(i = 0; i < SCENE_MAX_NEXT; ++i){
+        if(next[i].weight > 0
+           && (scenes[next[i].id].requires & ~scene->mask) == 0){
+            total += next[i].weight;
+            pick = &next[i];
+        }
+    }
+
+    scene->done = false;
+    scene->elapsed = 0;
+    if(pick == NULL){
+        return;
+    }
+
+    if(pick->weight != total){
+        roll = urand() % total;
+        for(i = 0; i < SCENE_MAX_NEXT; ++i){
+            if(next[i].weight > 0
+               && (scenes[next[i].id].requires & ~scene->mask) == 0){
+                pick = &next[i];
+                if(roll < next[i].weight){
+                    break;
+                }
+                roll -= next[i].weight;
+            }
+        }
+    }
+
+    scene->id = pick->id;
+    scene->fade = pick->fade;
+}
+
+/* called by a filter that has finished its part of the scene */
+static inline void scene_done(struct scene_state *scene)
+{
+    if(scene != NULL){
+        scene->done = true;
+    }
+}
+
+/* Timed and random changes, checked after the zone's filters have run. A
+ * scene entered during this frame starts counting with the next one. */
+static void scene_step(struct scene_state *scene,
+                       const struct anim_clock *clk)
+{
+    const struct scene *curr;
+
+    if(scene->entered){
+        scene->entered = false;
+        return;
+    }
+
+    curr = &scenes[scene->id];
+    scene->elapsed += clk->delta;
+
+    if(curr->duration > 0 && scene->elapsed >= curr->duration){
+        scene_switch(scene);
+        return;
+    }
+
+    if(curr->by_chance && scene->odds > 0){
+        scene->roll_time += clk->delta;
+        if(scene->roll_time >= scene->period){
+            scene->roll_time = 0;
+            if(urand() % scene->odds == 0){
+                scene_switch(scene);
+            }
+        }
+    }
+}
+
+static void clock_init(struct anim_clock *clk)
+{
+    clk->now = 0;
+    clk->delta = 0;
+    clk->last_tick = xTaskGetTickCount();
+}
+
+static void clock_update(struct anim_clock *clk)
+{
+    TickType_t tick;
+    uint32_t delta;
+
+    tick = xTaskGetTickCount();
+    delta = (tick - clk->last_tick) * portTICK_PERIOD_MS;
+    clk->last_tick = tick;
+
+    /* do not let effects jump ahead after the task has been stalled */
+    clk->delta = min(delta, BLINKEN_MAX_DELTA);
+    clk->now += clk->delta;
+}
+
+/* Scale a rate given per second to the time elapsed since the last frame.
+ * The remainder is carried over, so slow rates are not truncated to zero.
+ * Boosted rates can get large enough to overflow the product in 32 bits. */
+static int32_t clock_step(const struct anim_clock *clk, int32_t rate,
+                          int32_t *rem)
+{
+    int64_t tmp;
+
+    tmp = (int64_t) rate * clk->delta + *rem;
+    *rem = (int32_t) (tmp % 1000);
+
+    return (int32_t) (tmp / 1000);
+}
+
 static void filter_deinit(struct led_filter *filter)
 {
     void *priv;
@@ -109,21 +480,302 @@ static void filter_deinit(struct led_filter *filter)
     filter->init = NULL;
 }
 
+static int chain_setup(struct list_head *filters, uint32_t mask,
+                       unsigned int zone, struct blinken_cfg *cfg);
+static void chain_teardown(struct list_head *filters);
+
+static int chain_update(struct list_head *filters, struct blinken_cfg *cfg)
+{
+    struct led_filter *filter;
+    int result;
+
+    result = 0;
+
+    list_for_each_entry(filter, filters, filters, struct led_filter)
+    {
+        result = filter->init(filter, cfg, true);
+        if(result != 0){
+            printf("[%s] updating filter %s failed.\n",
+                    __func__,
+                    filter->name != NULL ? filter->name : "unknown");
+            break;
+        }
+    }
+
+    return result;
+}
+
+static int init_zones(struct strip_handler *this,
+                      struct blinken_cfg *cfg,
+                      bool update)
+{
+    struct led_zone *zone;
+    struct cfg_zone *zcfg;
+    unsigned int i;
+    uint32_t mask;
+    int result;
+
+    result = 0;
+
+    if(cfg->filters == ~0x0){
+        cfg->filters = ZONE_FILTER_DEFAULT;
+        cfg_updated = 1;
+    }
+
+    if(cfg->filters & ~ZONE_FILTER_ALL){
+        cfg->filters &= ZONE_FILTER_ALL;
+        cfg_updated = 1;
+    }
+
+    for(i = 0; i < BLINKEN_MAX_ZONES - 1; ++i){
+        zcfg = &cfg->zones[i];
+
+        if(zcfg->len == ~0x0){
+            zcfg->offset = 0;
+            zcfg->len = 0;
+            zcfg->filters = FILTER_RAINBOW | FILTER_FADE;
+            cfg_updated = 1;
+        }
+
+        if(zcfg->offset > cfg->strip_len){
+            zcfg->offset = cfg->strip_len;
+            cfg_updated = 1;
+        }
+
+        if(zcfg->len > cfg->strip_len - zcfg->offset){
+            zcfg->len = cfg->strip_len - zcfg->offset;
+            cfg_updated = 1;
+        }
+
+        if(zcfg->filters & ~ZONE_FILTER_ALL){
+            zcfg->filters &= ZONE_FILTER_ALL;
+            cfg_updated = 1;
+        }
+    }
+
+    for(i = 0; i < BLINKEN_MAX_ZONES; ++i){
+        zone = &this->zones[i];
+
+        if(!update){
+            INIT_LIST_HEAD(&zone->filters);
+            zone->index = i;
+            zone->mask = 0;
+        }
+
+        if(i == 0){
+            zone->offset = 0;
+            zone->len = cfg->strip_len;
+            mask = cfg->filters;
+        } else {
+            zone->offset = cfg->zones[i - 1].offset;
+            zone->len = cfg->zones[i - 1].len;
+            mask = cfg->zones[i - 1].filters;
+        }
+
+        if(zone->len == 0){
+            mask = 0;
+        }
+
+        /* rebuild the filter chain if the zone's filter set changed,
+         * otherwise just pass on the new settings */
+        if(mask != zone->mask || !update){
+            chain_teardown(&zone->filters);
+            zone->mask = mask;
+            scene_reset(&zone->scene);
+
+            result = chain_setup(&zone->filters, mask, i, cfg);
+            if(result != 0){
+                printf("[%s] setting up zone %u failed.\n", __func__, i);
+                goto err_out;
+            }
+        } else {
+            result = chain_update(&zone->filters, cfg);
+            if(result != 0){
+                goto err_out;
+            }
+        }
+
+        scene_setup(&zone->scene, mask, zone->len, zone_cfg(cfg, i, eye));
+    }
+
+err_out:
+    return result;
+}
+
+/* The index buffer is shared with the base layer, so it is only written by
+ * the active handler. */
+static void palette_map(struct strip_handler *this)
+{
+    struct led_palette *pal;
+    uint32_t i;
+
+    pal = &this->palette;
+
+    for(i = 0; i < this->strip_len; ++i){
+        pal->index[i] = (uint8_t) ((i * pal->repeat * BLINKEN_PALETTE_SIZE)
+                                   / this->strip_len);
+    }
+}
+
+#define MAX_PALETTE_ROTATE  scale_up(1000)
+static int init_palette(struct strip_handler *this,
+                        struct blinken_cfg *cfg,
+                        bool update)
+{
+    struct led_palette *pal;
+    struct cfg_palette *pcfg;
+    hsvValue_t hsv;
+    uint32_t i, pos, range;
+    bool full;
+
+    pal = &this->palette;
+    pcfg = &cfg->palette;
+
+    if(pcfg->valid == ~0x0){
+        pcfg->valid = 0;
+        pcfg->enabled = 0;
+        pcfg->hue_min = 0u;
+        pcfg->hue_max = 255u;
+        pcfg->saturation = 255u;
+        pcfg->value = 255u;
+        pcfg->repeat = 1u;
+        pcfg->rotate = scale_up(64);
+        cfg_updated = 1;
+    }
+
+    if(pcfg->enabled > 1u){
+        pcfg->enabled = 1u;
+        cfg_updated = 1;
+    }
+
+    if(pcfg->hue_max > 255u || pcfg->saturation > 255u
+       || pcfg->value > 255u){
+        pcfg->hue_max = min(pcfg->hue_max, 255u);
+        pcfg->saturation = min(pcfg->saturation, 255u);
+        pcfg->value = min(pcfg->value, 255u);
+        cfg_updated = 1;
+    }
+
+    if(pcfg->hue_min > pcfg->hue_max){
+        pcfg->hue_min = pcfg->hue_max;
+        cfg_updated = 1;
+    }
+
+    if(pcfg->repeat == 0 || pcfg->repeat > BLINKEN_MAX_REPEAT){
+        pcfg->repeat = pcfg->repeat == 0 ? 1u : BLINKEN_MAX_REPEAT;
+        cfg_updated = 1;
+    }
+
+    if(pcfg->rotate > MAX_PALETTE_ROTATE
+       || pcfg->rotate < -MAX_PALETTE_ROTATE){
+        pcfg->rotate = pcfg->rotate > 0 ? MAX_PALETTE_ROTATE
+                                        : -MAX_PALETTE_ROTATE;
+        cfg_updated = 1;
+    }
+
+    if(!update){
+        pal->index = (uint8_t *) hsv_buffer;
+        pal->offset = 0;
+        pal->rem = 0;
+    }
+
+    /* leaving indexed mode, the zones must not see stale palette indices */
+    if(this->active && pal->enabled && !pcfg->enabled){
+        memset(hsv_buffer, 0x0, sizeof(hsv_buffer));
+    }
+
+    pal->enabled = pcfg->enabled;
+    pal->repeat = pcfg->repeat;
+    pal->rate = pcfg->rotate;
+
+    /* A partial hue range is run up and back down again, so rotating the
+     * palette does not jump from one end of the range to the other. */
+    range = pcfg->hue_max - pcfg->hue_min;
+    full = (pcfg->hue_min == 0 && pcfg->hue_max == 255u);
+
+    hsv.saturation = pcfg->saturation;
+    hsv.value = pcfg->value;
+    for(i = 0; i < BLINKEN_PALETTE_SIZE; ++i){
+        if(full){
+            pos = i;
+        } else {
+            pos = i < 128 ? i * 2 : (255u - i) * 2;
+        }
+
+        hsv.hue = pcfg->hue_min + (range * pos + 127u) / 255u;
+        ws2812_hsv2rgb(&hsv, &pal->entries[i]);
+    }
+
+    if(this->active && pal->enabled){
+        palette_map(this);
+    }
+
+    return 0;
+}
+
+static void palette_step(struct led_palette *pal,
+                         const struct anim_clock *clk)
+{
+    pal->offset += clock_step(clk, pal->rate, &pal->rem);
+    pal->offset &= scale_up(BLINKEN_PALETTE_SIZE) - 1;
+}
+
+static int init_audio(struct strip_handler *this, struct blinken_cfg *cfg)
+{
+    struct cfg_audio *acfg;
+
+    acfg = &cfg->audio;
+
+    if(acfg->valid == ~0x0){
+        acfg->valid = 0;
+        acfg->enabled = 0;
+        acfg->threshold = AUDIO_THRESHOLD_DEF;
+        acfg->fade_depth = 255u;
+        acfg->speed_depth = 128u;
+        cfg_updated = 1;
+    }
+
+    if(acfg->enabled > 1u){
+        acfg->enabled = 1u;
+        cfg_updated = 1;
+    }
+
+    if(acfg->threshold < AUDIO_THRESHOLD_MIN
+       || acfg->threshold > AUDIO_THRESHOLD_MAX){
+        acfg->threshold = min(acfg->threshold, AUDIO_THRESHOLD_MAX);
+        acfg->threshold = max(acfg->threshold, AUDIO_THRESHOLD_MIN);
+        cfg_updated = 1;
+    }
+
+    if(acfg->fade_depth > 255u || acfg->speed_depth > 255u){
+        acfg->fade_depth = min(acfg->fade_depth, 255u);
+        acfg->speed_depth = min(acfg->speed_depth, 255u);
+        cfg_updated = 1;
+    }
+
+    this->audio = acfg->enabled;
+    this->audio_threshold = acfg->threshold;
+
+    return 0;
+}
+
 #define DEF_STRIP_LEN       250
-#define MAX_STRIP_LEN       500
+#define MAX_STRIP_LEN       BLINKEN_MAX_LEDS
 #define MAX_STRIP_BRIGHT    255
 #define MAX_STRIP_DELAY     100
 static int init_handler(struct strip_handler *this,
                         struct blinken_cfg *cfg,
-                        struct ws2812_t *ws2812,
+                        ws2812_t *ws2812,
                         bool update)
 {
-    struct led_filter *filter;
+    struct led_layer *layer;
+    struct cfg_layer *layer_cfg;
+    unsigned int i;
     int result;
 
     result = 0;
     if(cfg->magic != BLINKEN_CFG_MAGIC){
-        memset(cfg, 0xff, sizeof(cfg));
+        memset(cfg, 0xff, sizeof(*cfg));
         cfg->magic = BLINKEN_CFG_MAGIC;
         cfg->version = BLINKEN_CFG_VER;
         cfg->strip_len = DEF_STRIP_LEN;
@@ -148,25 +800,100 @@ static int init_handler(struct strip_handler *this,
         cfg_updated = 1;
     }
     
+    for(i = 0; i < BLINKEN_MAX_LAYERS - 1; ++i){
+        layer_cfg = &cfg->layers[i];
+
+        if(layer_cfg->valid == ~0x0){
+            layer_cfg->valid = 0;
+            layer_cfg->mode = blend_add;
+            layer_cfg->opacity = 255u;
+            layer_cfg->filters = 0;
+            cfg_updated = 1;
+        }
+
+        if(layer_cfg->filters & ~LAYER_FILTER_ALL){
+            layer_cfg->filters &= LAYER_FILTER_ALL;
+            cfg_updated = 1;
+        }
+
+        if(layer_cfg->mode >= blend_last){
+            layer_cfg->mode = blend_add;
+            cfg_updated = 1;
+        }
+
+        if(layer_cfg->opacity > 255u){
+            layer_cfg->opacity = 255u;
+            cfg_updated = 1;
+        }
+    }
+
     if(!update){
-        INIT_LIST_HEAD(&this->filters);
-        this->state = state_rainbow;
+        for(i = 0; i < BLINKEN_MAX_LAYERS; ++i){
+            INIT_LIST_HEAD(&this->layers[i].filters);
+            this->layers[i].mask = 0;
+        }
+
+        this->layers[0].hsv_vals = hsv_buffer;
+        this->layers[0].mode = blend_alpha;
+        this->layers[0].opacity = 255u;
+
+        for(i = 1; i < BLINKEN_MAX_LAYERS; ++i){
+            this->layers[i].hsv_vals = layer_buffer[i - 1];
+            if(this->active){
+                memset(layer_buffer[i - 1], 0x0, sizeof(layer_buffer[i - 1]));
+            }
+        }
     }
             
     this->strip_len = cfg->strip_len;
     this->delay = cfg->delay;
     this->brightness = cfg->brightness;
-    this->hsv_vals = hsv_buffer;
 
-    ws2812_set_len(ws2812, this->strip_len);
+    for(i = 1; i < BLINKEN_MAX_LAYERS; ++i){
+        this->layers[i].mode = cfg->layers[i - 1].mode;
+        this->layers[i].opacity = cfg->layers[i - 1].opacity;
+    }
 
-    if(update){
-        list_for_each_entry(filter, &this->filters, filters, struct led_filter){
-            result = filter->init(filter, cfg, true);
+    if(this->active){
+        ws2812_set_len(ws2812, this->strip_len);
+    }
+
+    /* the filters read their audio settings while being set up */
+    result = init_audio(this, cfg);
+    if(result != 0){
+        goto err_out;
+    }
+
+    /* the base layer is rendered by the zones */
+    result = init_zones(this, cfg, update);
+    if(result != 0){
+        goto err_out;
+    }
+
+    result = init_palette(this, cfg, update);
+    if(result != 0){
+        goto err_out;
+    }
+
+    /* overlays use the top level settings, just like zone 0 */
+    for(i = 1; i < BLINKEN_MAX_LAYERS; ++i){
+        layer = &this->layers[i];
+
+        if(layer->mask != cfg->layers[i - 1].filters){
+            chain_teardown(&layer->filters);
+            if(this->active){
+                memset(layer->hsv_vals, 0x0, sizeof(layer_buffer[i - 1]));
+            }
+            layer->mask = cfg->layers[i - 1].filters;
+
+            result = chain_setup(&layer->filters, layer->mask, 0, cfg);
+            if(result != 0){
+                printf("[%s] setting up layer %u failed.\n", __func__, i);
+                goto err_out;
+            }
+        } else if(update){
+            result = chain_update(&layer->filters, cfg);
             if(result != 0){
-                printf("[%s] updating filter %s failed.\n",
-                        __func__,
-                        filter->name != NULL ? filter->name : "unknown");
                 goto err_out;
             }
         }
@@ -181,18 +908,22 @@ struct ctx_rainbow
     int32_t hue_min;
     int32_t hue_max;
     int32_t hue_step;
-    int32_t cycle_step;
+    int32_t cycle_rate;
+    int32_t cycle_rem;
     int32_t curr_hue;
+    uint32_t audio_depth;
 };
 
 void filter_rainbow(struct led_filter *this,
-                    enum strip_state *state,
+                    struct scene_state *scene,
+                    const struct anim_clock *clk,
                     hsvValue_t hsv_vals[],
                     unsigned int strip_len)
 {
     int i;
     hsvValue_t tmp_hsv;
-    uint32_t tmp_hue;
+    uint32_t tmp_hue, boost;
+    int32_t rate;
     struct ctx_rainbow *ctx;
 
     ctx = (struct ctx_rainbow *) this->priv;
@@ -219,16 +950,25 @@ void filter_rainbow(struct led_filter *this,
         }
     }
 
-    ctx->curr_hue += ctx->cycle_step;
+    /* the bass speeds up the colour cycle up to four times */
+    rate = ctx->cycle_rate;
+    if(ctx->audio_depth > 0){
+        boost = mul8(ctx->audio_depth, max(audio_now.band[0], audio_now.beat));
+        rate += (rate / 255) * (int32_t) (3u * boost);
+    }
+
+    ctx->curr_hue += clock_step(clk, rate, &ctx->cycle_rem);
     if(ctx->hue_min == 0 && ctx->hue_max == scale_up(255u)){
         ctx->curr_hue %= scale_up(256);
     } else {
         if(ctx->curr_hue > ctx->hue_max){
             ctx->curr_hue = ctx->hue_max;
-            ctx->cycle_step = -ctx->cycle_step;
+            ctx->cycle_rate = -ctx->cycle_rate;
+            ctx->cycle_rem = 0;
         }else if(ctx->curr_hue < ctx->hue_min){
             ctx->curr_hue = ctx->hue_min;
-            ctx->cycle_step = -ctx->cycle_step;
+            ctx->cycle_rate = -ctx->cycle_rate;
+            ctx->cycle_rem = 0;
         }
     }
 }
@@ -237,6 +977,7 @@ int init_rainbow(struct led_filter *this, struct blinken_cfg *cfg, bool update)
 {
     int result;
     struct ctx_rainbow *ctx;
+    struct cfg_rainbow *rainbow;
 
     result = 0;
 
@@ -260,41 +1001,44 @@ int init_rainbow(struct led_filter *this, struct blinken_cfg *cfg, bool update)
         this->priv = ctx;
     }
 
+    rainbow = zone_cfg(cfg, this->zone, rainbow);
 
-    if(cfg->rainbow.valid == ~0x0){
-        cfg->rainbow.valid = 0;
-        cfg->rainbow.hue_min = 0u;
-        cfg->rainbow.hue_max = 255u;
-        cfg->rainbow.hue_steps = 255u;
-        cfg->rainbow.cycle_steps = 255u;
+    if(rainbow->valid == ~0x0){
+        rainbow->valid = 0;
+        rainbow->hue_min = 0u;
+        rainbow->hue_max = 255u;
+        rainbow->hue_steps = 255u;
+        rainbow->cycle_steps = 255u;
 
         cfg_updated = 1;
     }
 
-    if(cfg->rainbow.hue_max <= cfg->rainbow.hue_min){
-        cfg->rainbow.hue_max = cfg->rainbow.hue_min;
+    if(rainbow->hue_max <= rainbow->hue_min){
+        rainbow->hue_max = rainbow->hue_min;
         ctx->hue_step = 0u;
-        ctx->cycle_step = 0u;
+        ctx->cycle_rate = 0u;
         cfg_updated = 1;
     }
 
-    ctx->hue_min = scale_up(cfg->rainbow.hue_min);
-    ctx->hue_max = scale_up(cfg->rainbow.hue_max);
+    ctx->hue_min = scale_up(rainbow->hue_min);
+    ctx->hue_max = scale_up(rainbow->hue_max);
 
     if(ctx->hue_min != ctx->hue_max){
-        if(cfg->rainbow.hue_steps > 0){
+        if(rainbow->hue_steps > 0){
             ctx->hue_step = (ctx->hue_max - ctx->hue_min)
-                                    / cfg->rainbow.hue_steps;
+                                    / rainbow->hue_steps;
         }
-        if(cfg->rainbow.cycle_steps > 0){
-            ctx->cycle_step = (ctx->hue_max - ctx->hue_min)
-                                    / cfg->rainbow.cycle_steps;
+        if(rainbow->cycle_steps > 0){
+            ctx->cycle_rate = (ctx->hue_max - ctx->hue_min) * BLINKEN_FPS
+                                    / (int32_t) rainbow->cycle_steps;
         }
     }
 
     ctx->curr_hue = min(ctx->curr_hue, ctx->hue_max);
     ctx->curr_hue = max(ctx->curr_hue, ctx->hue_min);
 
+    ctx->audio_depth = cfg->audio.enabled ? cfg->audio.speed_depth : 0;
+
 err_out:
     return result;
 }
@@ -304,35 +1048,48 @@ struct ctx_fade
     int32_t min;
     int32_t max;
     int32_t curr_val;
-    int32_t curr_step;
+    int32_t curr_rate;
+    int32_t curr_rem;
+    uint32_t audio_depth;
 };
 
 
 void filter_fade(struct led_filter *this,
-                 enum strip_state *state,
+                 struct scene_state *scene,
+                 const struct anim_clock *clk,
                  hsvValue_t hsv_vals[],
                  unsigned int strip_len)
 {
     int i;
+    uint8_t val, drive;
     struct ctx_fade *ctx;
 
     ctx = (struct ctx_fade *) this->priv;
 
+    /* the sound pulls the value down to its loudness, beats flash it up */
+    val = scale_down(ctx->curr_val);
+    if(ctx->audio_depth > 0){
+        drive = max(audio_now.level, audio_now.beat);
+        val = mul8(val, 255u - mul8(ctx->audio_depth, 255u - drive));
+    }
+
     for(i = 0; i < strip_len; ++i){
-        hsv_vals[i].value = scale_down(ctx->curr_val);
+        hsv_vals[i].value = val;
     }
 
-    if(ctx->curr_step == 0){
+    if(ctx->curr_rate == 0){
         return;
     }
 
-    ctx->curr_val += ctx->curr_step;
+    ctx->curr_val += clock_step(clk, ctx->curr_rate, &ctx->curr_rem);
 
     if(ctx->curr_val <= ctx->min){
-        ctx->curr_step = -ctx->curr_step;
+        ctx->curr_rate = -ctx->curr_rate;
+        ctx->curr_rem = 0;
         ctx->curr_val = ctx->min;
     } else if(ctx->curr_val >= ctx->max){
-        ctx->curr_step =  -ctx->curr_step;
+        ctx->curr_rate =  -ctx->curr_rate;
+        ctx->curr_rem = 0;
         ctx->curr_val = ctx->max;
     }
 }
@@ -341,6 +1098,7 @@ int init_fade(struct led_filter *this, struct blinken_cfg *cfg, bool update)
 {
     int result;
     struct ctx_fade *ctx;
+    struct cfg_fade *fade;
 
     result = 0;
 
@@ -348,7 +1106,6 @@ int init_fade(struct led_filter *this, struct blinken_cfg *cfg, bool update)
         ctx = (struct ctx_fade *) this->priv;
     } else {
         this->name = "fade";
-        this->priv = ctx;
         this->filter = filter_fade;
         this->init = init_fade;
         this->deinit = filter_deinit;
@@ -365,27 +1122,29 @@ int init_fade(struct led_filter *this, struct blinken_cfg *cfg, bool update)
         this->priv = ctx;
     }
 
-    if(cfg->fade.valid == ~0x0){
-        cfg->fade.valid = 0;
-        cfg->fade.min = 0u;
-        cfg->fade.max = 255u;
-        cfg->fade.steps = BLINKEN_MAX_STEPS;
+    fade = zone_cfg(cfg, this->zone, fade);
+    if(fade->valid == ~0x0){
+        fade->valid = 0;
+        fade->min = 0u;
+        fade->max = 255u;
+        fade->steps = BLINKEN_MAX_STEPS;
         cfg_updated = 1;
     }
 
-    ctx->min = scale_up(cfg->fade.min);
-    ctx->max = scale_up(cfg->fade.max);
+    ctx->min = scale_up(fade->min);
+    ctx->max = scale_up(fade->max);
 
-    if(cfg->fade.min >= cfg->fade.max){
-        cfg->fade.max = cfg->fade.min;
+    if(fade->min >= fade->max){
+        fade->max = fade->min;
         cfg_updated = 1;
     } else {
-        if(cfg->fade.steps > 0){
-            if(ctx->curr_step < 0){
-                ctx->curr_step = - (int32_t)((ctx->max - ctx->min)
-                                        / cfg->fade.steps);
+        if(fade->steps > 0){
+            if(ctx->curr_rate < 0){
+                ctx->curr_rate = - ((ctx->max - ctx->min) * BLINKEN_FPS
+                                        / (int32_t) fade->steps);
             }else{
-                ctx->curr_step =  (ctx->max - ctx->min) / cfg->fade.steps;
+                ctx->curr_rate = (ctx->max - ctx->min) * BLINKEN_FPS
+                                        / (int32_t) fade->steps;
             }
         }
     }
@@ -393,10 +1152,14 @@ int init_fade(struct led_filter *this, struct blinken_cfg *cfg, bool update)
     ctx->curr_val = max(ctx->curr_val, ctx->min);
     ctx->curr_val = min(ctx->curr_val, ctx->max);
 
+    ctx->audio_depth = cfg->audio.enabled ? cfg->audio.fade_depth : 0;
+
 err_out:
     return result;
 }
 
+/* off_delay and on_delay are given in reference frames, the countdowns
+ * next_off and next_on in milliseconds */
 struct ctx_flicker
 {
     uint32_t rate;
@@ -409,25 +1172,23 @@ struct ctx_flicker
 };
 
 void filter_flicker(struct led_filter *this,
-                    enum strip_state *state,
+                    struct scene_state *scene,
+                    const struct anim_clock *clk,
                     hsvValue_t hsv_vals[],
                     unsigned int strip_len)
 {
     int i;
     struct ctx_flicker *ctx;
 
-    if(*state != state_flicker){
-        return;
-    }
-
     ctx = (struct ctx_flicker *) this->priv;
 
     if(ctx->next_off > 0){
-        --(ctx->next_off);
+        ctx->next_off -= min(ctx->next_off, clk->delta);
         if(ctx->next_off == 0){
             do{
                 ctx->next_on = urand() % ctx->on_delay;
             }while(ctx->next_on == 0);
+            ctx->next_on *= BLINKEN_FRAME_MS;
         }
     }
 
@@ -438,20 +1199,21 @@ void filter_flicker(struct led_filter *this,
     }
 
     if(ctx->next_on > 0){
-        --(ctx->next_on);
+        ctx->next_on -= min(ctx->next_on, clk->delta);
         if(ctx->next_on == 0){
             ctx->off_delay /= 2;
             if(ctx->off_delay <= 1){
-                ctx->next_off = 200;
+                ctx->next_off = 200 * BLINKEN_FRAME_MS;
                 ctx->next_on = 0;
                 ctx->off_delay = 200;
                 ctx->on_delay = 40;
                 ctx->active = 0;
-                *state = state_eye;
+                scene_done(scene);
             }else{
                 do{
                     ctx->next_off = urand() % ctx->off_delay;
                 }while(ctx->next_off == 0);
+                ctx->next_off *= BLINKEN_FRAME_MS;
             }
         }
     }
@@ -461,6 +1223,7 @@ int init_flicker(struct led_filter *this, struct blinken_cfg *cfg, bool update)
 {
     int result;
     struct ctx_flicker *ctx;
+    struct cfg_flicker *flicker;
 
     result = 0;
 
@@ -484,13 +1247,14 @@ int init_flicker(struct led_filter *this, struct blinken_cfg *cfg, bool update)
         this->priv = ctx;
     }
 
-    if(cfg->flicker.valid == ~0x0){
-        cfg->flicker.valid = 0;
-        cfg->flicker.rate = 100;
+    flicker = zone_cfg(cfg, this->zone, flicker);
+    if(flicker->valid == ~0x0){
+        flicker->valid = 0;
+        flicker->rate = 100;
         cfg_updated = 1;
     }
 
-    ctx->next_off = 200;
+    ctx->next_off = 200 * BLINKEN_FRAME_MS;
     ctx->next_on = 0;
     ctx->off_delay = 200;
     ctx->on_delay = 40;
@@ -519,37 +1283,15 @@ struct ctx_eye
     unsigned int jump_len;
     unsigned int jumps;
     unsigned int wait;
-    unsigned int updates;
+    unsigned int elapsed;
 };
 
-void filter_eye(struct led_filter *this,
-                enum strip_state *state,
-                hsvValue_t hsv_vals[],
-                unsigned int strip_len)
+/* The eye's motion model is stepped in fixed ticks of BLINKEN_FRAME_MS, so
+ * the wait counters below count reference frames, not rendered frames.
+ * Returns true once the eye has gone back to sleep. */
+static bool eye_step(struct ctx_eye *ctx, unsigned int strip_len)
 {
-    int i, jump;
-    struct ctx_eye *ctx;
-
-    ctx = (struct ctx_eye *) this->priv;
-
-    if(ctx->rate == 0){
-        *state = state_rainbow;
-        return;
-    }
-
-    if(*state != state_eye){
-        if(*state != state_flicker){
-            ++ctx->updates;
-            if(ctx->updates >= strip_len){
-                ctx->updates = 0;
-                if(urand() % ctx->rate == 0){
-                    *state = state_flicker;
-                }
-            }
-        }
-
-        return;
-    }
+    int jump;
 
     switch (ctx->state) {
     case eye_init:
@@ -637,12 +1379,41 @@ void filter_eye(struct led_filter *this,
     case eye_sleeping:
         if(ctx->wait == 0){
             ctx->state = eye_init;
-            *state = state_rainbow;
+            return true;
         }else{
             --ctx->wait;
         }
     }
 
+    return false;
+}
+
+void filter_eye(struct led_filter *this,
+                struct scene_state *scene,
+                const struct anim_clock *clk,
+                hsvValue_t hsv_vals[],
+                unsigned int strip_len)
+{
+    int i;
+    struct ctx_eye *ctx;
+
+    ctx = (struct ctx_eye *) this->priv;
+
+    if(strip_len < 3 || ctx->rate == 0){
+        scene_done(scene);
+        return;
+    }
+
+    ctx->elapsed += clk->delta;
+    while(ctx->elapsed >= BLINKEN_FRAME_MS){
+        ctx->elapsed -= BLINKEN_FRAME_MS;
+        if(eye_step(ctx, strip_len)){
+            ctx->elapsed = 0;
+            scene_done(scene);
+            return;
+        }
+    }
+
     if(ctx->state != eye_sleeping){
         uint32_t pos;
 
@@ -669,6 +1440,8 @@ int init_eye(struct led_filter *this, struct blinken_cfg *cfg, bool update)
 {
     int result;
     struct ctx_eye *ctx;
+    struct cfg_eye *eye;
+    uint32_t len;
 
     result = 0;
 
@@ -693,18 +1466,20 @@ int init_eye(struct led_filter *this, struct blinken_cfg *cfg, bool update)
     
         ctx->state = eye_init;
         ctx->wait = 100;
-        ctx->updates = 0;
     }
 
-    if(cfg->eye.valid == ~0x0){
-        cfg->eye.valid = 0;
-        cfg->eye.rate = 10;
+    eye = zone_cfg(cfg, this->zone, eye);
+    len = this->zone == 0 ? cfg->strip_len : cfg->zones[this->zone - 1].len;
+
+    if(eye->valid == ~0x0){
+        eye->valid = 0;
+        eye->rate = 10;
         cfg_updated = 1;
     }
 
-    if(cfg->eye.rate != 0){
-        ctx->curr_pos = scale_up(cfg->strip_len / 2);
-        ctx->rate = 100 / cfg->eye.rate;
+    if(eye->rate != 0){
+        ctx->curr_pos = scale_up(len / 2);
+        ctx->rate = 100 / eye->rate;
     } else {
         ctx->rate = 0;
     }
@@ -713,201 +1488,2143 @@ err_out:
     return result;
 }
 
-static void load_config(void)
+/* Particles live in a fixed pool inside the filter context. Positions are
+ * kept in LEDs and velocities in LEDs per second, both scaled up by 8 bits.
+ * Each frame only touches the one or two pixels covered by a particle, plus
+ * the pixels it covered in the previous frame. The optional decay pass fades
+ * the whole layer instead of clearing, leaving trails behind the particles. */
+struct particle
 {
-    flash_t flash;
-    int result;
+    int32_t pos;
+    int32_t vel;
+    uint16_t life;
+    uint16_t ttl;
+    int16_t drawn;
+    hsvValue_t colour;
+};
 
-    printf("[%s] reading config from flash\n", __func__);
+struct ctx_particles
+{
+    enum particle_mode mode;
+    uint32_t rate;
+    int32_t speed;
+    uint32_t life;
+    uint8_t hue;
+    int32_t gravity;
+    uint32_t decay;
+    int32_t emit_rem;
+    int32_t decay_rem;
+    int32_t gravity_rem;
+    int32_t flip;
+    struct particle pool[BLINKEN_MAX_PARTICLES];
+};
 
-    device_mutex_lock(RT_DEV_LOCK_FLASH);
-    result = flash_stream_read(&flash,
-                               LED_SETTINGS_SECTOR,
-                               sizeof(strip_cfg),
-                               (uint8_t *) &strip_cfg);
-    device_mutex_unlock(RT_DEV_LOCK_FLASH);
+static void particle_emit(struct ctx_particles *ctx, unsigned int strip_len)
+{
+    struct particle *p;
+    unsigned int i;
+    int32_t spread;
+
+    p = NULL;
+    for(i = 0; i < BLINKEN_MAX_PARTICLES; ++i){
+        if(ctx->pool[i].life == 0){
+            p = &ctx->pool[i];
+            break;
+        }
+    }
+
+    if(p == NULL){
+        return;
+    }
+
+    p->ttl = ctx->life;
+    p->colour.hue = ctx->hue;
+    p->colour.saturation = 255u;
+    p->colour.value = 255u;
+
+    switch(ctx->mode){
+    case particle_sparkle:
+        p->pos = scale_up(urand() % strip_len);
+        p->vel = 0;
+        p->ttl = ctx->life / 2 + urand() % (ctx->life / 2 + 1);
+        p->colour.saturation = 64u;
+        break;
+    case particle_fire:
+        /* rise from the start of the strip with some jitter */
+        p->pos = scale_up(urand() % 3);
+        spread = ctx->speed / 2;
+        p->vel = ctx->speed - spread + (int32_t) (urand() % (2 * spread + 1));
+        break;
+    case particle_comet:
+    default:
+        /* alternate between both ends of the strip */
+        ctx->flip = !ctx->flip;
+        if(ctx->flip){
+            p->pos = 0;
+            p->vel = ctx->speed;
+        } else {
+            p->pos = scale_up(strip_len - 1);
+            p->vel = -ctx->speed;
+        }
+        break;
+    }
+
+    /* a sparkle's share of a short life may round down to nothing, the
+     * fade-out divides by ttl */
+    p->ttl = max(p->ttl, 1);
+    p->life = p->ttl;
 }
 
-static void save_config(void)
+static void particle_draw(struct particle *p, hsvValue_t hsv_vals[],
+                          unsigned int strip_len)
 {
-    flash_t flash;
-    int result;
-
-    printf("[%s] saving config to flash\n", __func__);
+    unsigned int pix, frac;
+    hsvValue_t colour;
 
-    cfg_updated = 0;
+    pix = scale_down(p->pos);
+    frac = p->pos & 0xff;
+    colour = p->colour;
 
-    device_mutex_lock(RT_DEV_LOCK_FLASH);
-    flash_erase_sector(&flash, LED_SETTINGS_SECTOR);
-    result = flash_stream_write(&flash, LED_SETTINGS_SECTOR,
-                                sizeof(strip_cfg), (uint8_t *)&strip_cfg);
+    /* split the particle between the two pixels it covers */
+    colour.value = scale_down(p->colour.value * (256u - frac));
+    if(colour.value >= hsv_vals[pix].value){
+        hsv_vals[pix] = colour;
+    }
 
-    if(result != 1){
-        printf("[%s] Saving config failed\n", __func__);
-        flash_erase_sector(&flash, LED_SETTINGS_SECTOR);
+    if(pix + 1 < strip_len && frac > 0){
+        colour.value = scale_down(p->colour.value * frac);
+        if(colour.value >= hsv_vals[pix + 1].value){
+            hsv_vals[pix + 1] = colour;
+        }
     }
-    device_mutex_unlock(RT_DEV_LOCK_FLASH);
+
+    p->drawn = pix;
 }
 
-struct blinken_cfg *blinken_get_config(void)
+void filter_particles(struct led_filter *this,
+                      struct scene_state *scene,
+                      const struct anim_clock *clk,
+                      hsvValue_t hsv_vals[],
+                      unsigned int strip_len)
 {
-    struct blinken_cfg *cfg = NULL;
+    struct ctx_particles *ctx;
+    struct particle *p;
+    unsigned int i;
+    int32_t fade, emit, accel;
+    uint32_t age;
 
-    if(strip_cfg.magic == BLINKEN_CFG_MAGIC){
-        cfg = malloc(sizeof(*cfg));
-        if(cfg != NULL){
-            memmove(cfg, &strip_cfg, sizeof(*cfg));
+    ctx = (struct ctx_particles *) this->priv;
+
+    if(strip_len == 0){
+        return;
+    }
+
+    if(ctx->decay > 0){
+        fade = clock_step(clk, ctx->decay, &ctx->decay_rem);
+        if(fade > 0){
+            for(i = 0; i < strip_len; ++i){
+                hsv_vals[i].value -= min(hsv_vals[i].value, fade);
+            }
         }
     }
 
-    return cfg;
+    accel = clock_step(clk, ctx->gravity, &ctx->gravity_rem);
+
+    for(i = 0; i < BLINKEN_MAX_PARTICLES; ++i){
+        p = &ctx->pool[i];
+
+        /* remove the particle from where it was drawn last frame */
+        if(ctx->decay == 0 && p->drawn >= 0){
+            if(p->drawn < strip_len){
+                hsv_vals[p->drawn].value = 0;
+            }
+            if(p->drawn + 1 < strip_len){
+                hsv_vals[p->drawn + 1].value = 0;
+            }
+        }
+        p->drawn = -1;
+
+        if(p->life == 0){
+            continue;
+        }
+
+        p->life -= min(p->life, clk->delta);
+        p->vel += accel;
+        p->pos += (p->vel * (int32_t) clk->delta) / 1000;
+
+        if(p->pos < 0 || scale_down(p->pos) >= strip_len){
+            p->life = 0;
+        }
+    }
+
+    emit = clock_step(clk, ctx->rate, &ctx->emit_rem);
+    while(emit-- > 0){
+        particle_emit(ctx, strip_len);
+    }
+
+    for(i = 0; i < BLINKEN_MAX_PARTICLES; ++i){
+        p = &ctx->pool[i];
+
+        if(p->life == 0){
+            continue;
+        }
+
+        age = p->ttl - p->life;
+        switch(ctx->mode){
+        case particle_sparkle:
+            p->colour.value = (255u * p->life) / p->ttl;
+            break;
+        case particle_fire:
+            /* cool down from the configured hue towards red */
+            p->colour.hue = (ctx->hue * p->life) / p->ttl;
+            p->colour.value = 255u - (192u * age) / p->ttl;
+            break;
+        default:
+            break;
+        }
+
+        particle_draw(p, hsv_vals, strip_len);
+    }
 }
 
-int blinken_set_config(struct blinken_cfg *cfg)
+int init_particles(struct led_filter *this, struct blinken_cfg *cfg,
+                   bool update)
 {
     int result;
-    BaseType_t status;
+    unsigned int i;
+    struct ctx_particles *ctx;
+    struct cfg_particles *particles;
 
     result = 0;
-    if(cfg == NULL || cfg->magic != BLINKEN_CFG_MAGIC){
-        result = -1;
-        goto err_out;
-    } 
 
-    status = xSemaphoreTake(cfg_sema, 15 * configTICK_RATE_HZ);
-    if(status != pdTRUE){
-        printf("[%s] Timeout waiting for config sema.\n", __func__);
-        result = -1;
-        goto err_out;
+    if(update){
+        ctx = (struct ctx_particles *) this->priv;
+    } else {
+        this->name = "particles";
+        this->filter = filter_particles;
+        this->init = init_particles;
+        this->deinit = filter_deinit;
+        INIT_LIST_HEAD(&(this->filters));
+
+        ctx = malloc(sizeof(*ctx));
+        if(ctx == NULL){
+            printf("[%s] malloc() failed\n", __func__);
+            result = -1;
+            goto err_out;
+        }
+
+        memset(ctx, 0x0, sizeof(*ctx));
+        for(i = 0; i < BLINKEN_MAX_PARTICLES; ++i){
+            ctx->pool[i].drawn = -1;
+        }
+        this->priv = ctx;
     }
 
-    result = init_handler(&handler, cfg, ws2812_cfg, true);
-    if(result == 0){
-        memmove(&strip_cfg, cfg, sizeof(strip_cfg));
-        save_config();
+    particles = &cfg->particles;
+    if(particles->valid == ~0x0){
+        particles->valid = 0;
+        particles->mode = particle_sparkle;
+        particles->rate = 20;
+        particles->speed = 40;
+        particles->life = 1000;
+        particles->hue = 40;
+        particles->gravity = -20;
+        particles->decay = 0;
+        cfg_updated = 1;
+    }
+
+    if(particles->mode >= particle_last){
+        particles->mode = particle_sparkle;
+        cfg_updated = 1;
+    }
+
+    if(particles->life == 0 || particles->life > UINT16_MAX){
+        particles->life = 1000;
+        cfg_updated = 1;
+    }
+
+    if(particles->hue > 255u){
+        particles->hue = 255u;
+        cfg_updated = 1;
+    }
+
+    if(particles->speed > BLINKEN_MAX_LEDS){
+        particles->speed = BLINKEN_MAX_LEDS;
+        cfg_updated = 1;
+    }
+
+    if(particles->rate > 1000){
+        particles->rate = 1000;
+        cfg_updated = 1;
+    }
+
+    if(particles->gravity > 1000 || particles->gravity < -1000){
+        particles->gravity = particles->gravity > 0 ? 1000 : -1000;
+        cfg_updated = 1;
     }
 
-    xSemaphoreGive(cfg_sema);
+    if(particles->decay > 2550){
+        particles->decay = 2550;
+        cfg_updated = 1;
+    }
+
+    ctx->mode = particles->mode;
+    ctx->rate = particles->rate;
+    ctx->speed = scale_up(particles->speed);
+    ctx->life = particles->life;
+    ctx->hue = particles->hue;
+    ctx->gravity = scale_up(particles->gravity);
+    ctx->decay = particles->decay;
 
 err_out:
     return result;
 }
 
-void run_strip(void *pvParameters __attribute__((unused)))
+/* Sprites live in a fixed table inside the filter context, with positions in
+ * LEDs and velocities in LEDs per second, both scaled up by 8 bits. Like the
+ * particles, a sprite only touches the pixels it covers and the ones it
+ * covered in the previous frame, so the cost grows with the number and size
+ * of the sprites, not with the strip length. */
+struct sprite
 {
-    struct led_filter rainbow;
-    struct led_filter fade;
-    struct led_filter flicker;
-    struct led_filter eye;
-    struct led_filter *filter;
-    enum strip_state state;
-    int result;
-    BaseType_t status;
+    enum sprite_mode mode;
+    int32_t pos;
+    int32_t vel;
+    uint8_t hue;
+    int32_t drawn;
+    unsigned int drawn_len;
+    struct ctx_eye eye;
+};
 
-    load_config();
+struct ctx_sprites
+{
+    unsigned int count;
+    enum sprite_mode mode;
+    enum sprite_shape shape;
+    unsigned int size;
+    int32_t speed;
+    uint8_t value;
+    unsigned int strip_len;
+    unsigned int elapsed;
+    struct sprite table[BLINKEN_MAX_SPRITES];
+};
 
-    ws2812_cfg = ws2812_init(BLINKEN_MAX_LEDS);
-    if(ws2812_cfg == NULL){
-        printf("[%s] ws2812_init() failed\n", __func__);
-        goto err_out;
-    }
+/* Place a sprite on its share of the strip. The first sprite has nobody to
+ * chase, so it scans instead. Eyes start asleep for a random while, so they
+ * do not all wake up together. */
+static void sprite_spawn(struct ctx_sprites *ctx, unsigned int idx,
+                         unsigned int strip_len)
+{
+    struct sprite *s;
 
-    result = init_handler(&handler, &strip_cfg, ws2812_cfg, false);
-    if(result != 0){
-        printf("[%s] init_handler() failed\n", __func__);
-        goto err_out;
+    s = &ctx->table[idx];
+
+    s->mode = ctx->mode == sprite_mixed ? idx % sprite_mixed : ctx->mode;
+    if(s->mode == sprite_chaser && idx == 0){
+        s->mode = sprite_scanner;
     }
 
-    result = init_rainbow(&rainbow, &strip_cfg, false);
-    if(result != 0){
-        printf("[%s] init_rainbow() failed\n", __func__);
-        goto err_out;
+    s->pos = scale_up((2 * idx + 1) * strip_len / (2 * ctx->count));
+    s->vel = 0;
+
+    switch(s->mode){
+    case sprite_eye:
+        memset(&s->eye, 0x0, sizeof(s->eye));
+        s->eye.state = eye_sleeping;
+        s->eye.wait = urand() % 200;
+        s->eye.curr_pos = s->pos;
+        break;
+    case sprite_scanner:
+        s->vel = (idx & 1) ? -ctx->speed : ctx->speed;
+        break;
+    default:
+        break;
     }
-    list_add_tail(&(rainbow.filters), &(handler.filters));
+}
 
-    result = init_fade(&fade, &strip_cfg, false);
-    if(result != 0){
-        printf("[%s] init_fade() failed\n", __func__);
-        goto err_out;
+static void sprite_move(struct ctx_sprites *ctx, unsigned int idx,
+                        const struct anim_clock *clk, unsigned int strip_len)
+{
+    struct sprite *s, *lead;
+    int32_t end, target, gap, limit;
+
+    s = &ctx->table[idx];
+    end = scale_up(strip_len - 1);
+
+    switch(s->mode){
+    case sprite_eye:
+        /* stepped in reference frames by filter_sprites() */
+        s->pos = s->eye.curr_pos;
+        break;
+    case sprite_scanner:
+        s->pos += (s->vel * (int32_t) clk->delta) / 1000;
+        if(s->pos <= 0){
+            s->pos = 0;
+            s->vel = ctx->speed;
+        } else if(s->pos >= end){
+            s->pos = end;
+            s->vel = -ctx->speed;
+        }
+        break;
+    case sprite_chaser:
+    default:
+        /* close up to the sprite ahead, keeping one sprite length apart. The
+         * chaser is half again as fast, so it catches up eventually. */
+        lead = &ctx->table[idx - 1];
+        gap = scale_up(ctx->size + 1);
+        target = lead->pos < s->pos ? lead->pos + gap : lead->pos - gap;
+        limit = ctx->speed + ctx->speed / 2;
+
+        s->vel = (target - s->pos) * 4;
+        s->vel = min(s->vel, limit);
+        s->vel = max(s->vel, -limit);
+        s->pos += (s->vel * (int32_t) clk->delta) / 1000;
+        s->pos = min(s->pos, end);
+        s->pos = max(s->pos, 0);
+        break;
     }
-    list_add_tail(&(fade.filters), &(handler.filters));
+}
 
-    result = init_flicker(&flicker, &strip_cfg, false);
-    if(result != 0){
-        printf("[%s] init_flicker() failed\n", __func__);
-        goto err_out;
+static void sprite_plot(hsvValue_t hsv_vals[], unsigned int strip_len,
+                        int32_t pix, hsvValue_t colour)
+{
+    if(pix < 0 || pix >= (int32_t) strip_len){
+        return;
     }
-    list_add_tail(&(flicker.filters), &(handler.filters));
 
-    result = init_eye(&eye, &strip_cfg, false);
-    if(result != 0){
-        printf("[%s] init_eye() failed\n", __func__);
-        goto err_out;
+    if(colour.value >= hsv_vals[pix].value){
+        hsv_vals[pix] = colour;
     }
-    list_add_tail(&(eye.filters), &(handler.filters));
+}
 
-    if(cfg_updated != 0){
-        save_config();
+static void sprite_draw(struct ctx_sprites *ctx, struct sprite *s,
+                        hsvValue_t hsv_vals[], unsigned int strip_len)
+{
+    hsvValue_t colour;
+    int32_t pix, dir;
+    unsigned int i, frac, val;
+
+    val = ctx->value;
+    if(s->mode == sprite_eye){
+        if(s->eye.state == eye_sleeping || s->eye.brightness == 0){
+            return;
+        }
+        val = val * min(s->eye.level, s->eye.brightness) / s->eye.brightness;
     }
 
-    while(1){
-        status = xSemaphoreTake(cfg_sema, 5 * configTICK_RATE_HZ);
-        if(status != pdTRUE){
-            printf("[%s] timeout waiting for config sema\n", __func__);
-            goto err_out;
+    pix = scale_down(s->pos);
+    frac = s->pos & 0xff;
+    colour.hue = s->hue;
+    colour.saturation = 255u;
+
+    switch(ctx->shape){
+    case shape_dot:
+        /* split between the two pixels it covers */
+        colour.value = scale_down(val * (256u - frac));
+        sprite_plot(hsv_vals, strip_len, pix, colour);
+        colour.value = scale_down(val * frac);
+        sprite_plot(hsv_vals, strip_len, pix + 1, colour);
+        s->drawn = pix;
+        s->drawn_len = 2;
+        break;
+    case shape_eye:
+        colour.value = val;
+        sprite_plot(hsv_vals, strip_len, pix, colour);
+        colour.value = val / 4;
+        sprite_plot(hsv_vals, strip_len, pix - 1, colour);
+        sprite_plot(hsv_vals, strip_len, pix + 1, colour);
+        s->drawn = pix - 1;
+        s->drawn_len = 3;
+        break;
+    case shape_bar:
+        colour.value = val;
+        s->drawn = pix - ctx->size / 2;
+        s->drawn_len = ctx->size;
+        for(i = 0; i < ctx->size; ++i){
+            sprite_plot(hsv_vals, strip_len, s->drawn + i, colour);
         }
+        break;
+    case shape_comet:
+    default:
+        /* the tail fades out behind the direction of travel */
+        dir = s->vel < 0 ? 1 : -1;
+        for(i = 0; i < ctx->size; ++i){
+            colour.value = val * (ctx->size - i) / ctx->size;
+            sprite_plot(hsv_vals, strip_len, pix + dir * (int32_t) i, colour);
+        }
+        s->drawn = dir < 0 ? pix - (ctx->size - 1) : pix;
+        s->drawn_len = ctx->size;
+        break;
+    }
+}
 
-        list_for_each_entry(filter,
-                            &(handler.filters),
-                            filters,
-                            struct led_filter)
-        {
-            filter->filter(filter, &state, handler.hsv_vals, handler.strip_len);
+void filter_sprites(struct led_filter *this,
+                    struct scene_state *scene,
+                    const struct anim_clock *clk,
+                    hsvValue_t hsv_vals[],
+                    unsigned int strip_len)
+{
+    struct ctx_sprites *ctx;
+    struct sprite *s;
+    unsigned int i, t, ticks;
+    int32_t pix, end;
+
+    ctx = (struct ctx_sprites *) this->priv;
+
+    /* clear all old positions first, so no sprite erases another one that
+     * has been drawn over it this frame */
+    for(i = 0; i < BLINKEN_MAX_SPRITES; ++i){
+        s = &ctx->table[i];
+
+        end = s->drawn + (int32_t) s->drawn_len;
+        for(pix = max(s->drawn, 0); pix < end; ++pix){
+            if(pix >= (int32_t) strip_len){
+                break;
+            }
+            hsv_vals[pix].value = 0;
         }
-        
-        ws2812_send(ws2812_cfg, handler.hsv_vals, handler.strip_len,
-                        handler.delay);
+        s->drawn_len = 0;
+    }
 
-        xSemaphoreGive(cfg_sema);
+    if(strip_len < 3){
+        return;
     }
 
-err_out:
-    while(1){
-        vTaskDelay(1000);
+    /* the eyes' motion model is stepped in reference frames */
+    ctx->elapsed += clk->delta;
+    ticks = ctx->elapsed / BLINKEN_FRAME_MS;
+    ctx->elapsed %= BLINKEN_FRAME_MS;
+
+    for(i = 0; i < ctx->count; ++i){
+        s = &ctx->table[i];
+
+        if(s->mode == sprite_eye){
+            for(t = 0; t < ticks; ++t){
+                /* an eye that went back to sleep wakes up elsewhere */
+                if(eye_step(&s->eye, strip_len) && strip_len > 4){
+                    s->eye.curr_pos = scale_up(2 + urand() % (strip_len - 4));
+                }
+            }
+        }
+
+        sprite_move(ctx, i, clk, strip_len);
+        sprite_draw(ctx, s, hsv_vals, strip_len);
     }
 }
 
-#define STACKSIZE               512
-TaskHandle_t ledstrip_task = NULL;
-
-static int ledstrip_start(void)
+int init_sprites(struct led_filter *this, struct blinken_cfg *cfg,
+                 bool update)
 {
     int result;
-    BaseType_t status;
+    unsigned int i, first;
+    struct ctx_sprites *ctx;
+    struct cfg_sprites *sprites;
+    struct sprite *s;
 
-    printf("[%s] Called\n", __func__);
-    
     result = 0;
-    ledstrip_terminate = 0;
 
-    memset(&handler, 0x0, sizeof(handler));
+    if(update){
+        ctx = (struct ctx_sprites *) this->priv;
+    } else {
+        this->name = "sprites";
+        this->filter = filter_sprites;
+        this->init = init_sprites;
+        this->deinit = filter_deinit;
+        INIT_LIST_HEAD(&(this->filters));
+
+        ctx = malloc(sizeof(*ctx));
+        if(ctx == NULL){
+            printf("[%s] malloc() failed\n", __func__);
+            result = -1;
+            goto err_out;
+        }
+
+        memset(ctx, 0x0, sizeof(*ctx));
+        this->priv = ctx;
+    }
 
-    if(cfg_sema == NULL){
-        cfg_sema = xSemaphoreCreateMutex();
+    sprites = &cfg->sprites;
+    if(sprites->valid == ~0x0){
+        sprites->valid = 0;
+        sprites->count = 4;
+        sprites->mode = sprite_eye;
+        sprites->shape = shape_eye;
+        sprites->size = 5;
+        sprites->speed = 30;
+        sprites->hue = 0;
+        sprites->hue_step = 64;
+        sprites->value = 255;
+        cfg_updated = 1;
     }
 
-    if(cfg_sema == NULL){
-        printf("[%s] Creating cfg_sema failed\n", __func__);
-        result = -1;
-        goto err_out;
+    if(sprites->count > BLINKEN_MAX_SPRITES){
+        sprites->count = BLINKEN_MAX_SPRITES;
+        cfg_updated = 1;
     }
 
-    if(ledstrip_task == NULL){
-        status = xTaskCreate(run_strip, (const char * )"led_strip", STACKSIZE,
-                                 NULL, tskIDLE_PRIORITY + 1, &ledstrip_task);
+    if(sprites->mode >= sprite_last){
+        sprites->mode = sprite_eye;
+        cfg_updated = 1;
+    }
 
-        if(status != pdPASS){
-            printf("[%s] Create ledstrip task failed!\n", __func__);
+    if(sprites->shape >= shape_last){
+        sprites->shape = shape_eye;
+        cfg_updated = 1;
+    }
+
+    if(sprites->size == 0 || sprites->size > BLINKEN_MAX_SPRITE_SIZE){
+        sprites->size = sprites->size == 0 ? 1 : BLINKEN_MAX_SPRITE_SIZE;
+        cfg_updated = 1;
+    }
+
+    if(sprites->speed > BLINKEN_MAX_LEDS){
+        sprites->speed = BLINKEN_MAX_LEDS;
+        cfg_updated = 1;
+    }
+
+    if(sprites->hue > 255u || sprites->hue_step > 255u
+            || sprites->value > 255u){
+        sprites->hue = min(sprites->hue, 255u);
+        sprites->hue_step = min(sprites->hue_step, 255u);
+        sprites->value = min(sprites->value, 255u);
+        cfg_updated = 1;
+    }
+
+    /* sprites that are still around keep moving from where they are, unless
+     * their behaviour or the room they move in has changed. Sprites beyond
+     * the new count are erased with the next frame. */
+    first = ctx->count;
+    if(!update || ctx->mode != sprites->mode || ctx->count > sprites->count
+            || ctx->strip_len != cfg->strip_len){
+        first = 0;
+    }
+
+    ctx->count = sprites->count;
+    ctx->mode = sprites->mode;
+    ctx->shape = sprites->shape;
+    ctx->size = sprites->size;
+    ctx->speed = scale_up(sprites->speed);
+    ctx->value = sprites->value;
+    ctx->strip_len = cfg->strip_len;
+
+    for(i = 0; i < ctx->count; ++i){
+        s = &ctx->table[i];
+
+        if(i >= first){
+            sprite_spawn(ctx, i, ctx->strip_len);
+        } else if(s->mode == sprite_scanner){
+            s->vel = s->vel < 0 ? -ctx->speed : ctx->speed;
+        }
+
+        s->hue = (uint8_t) (sprites->hue + i * sprites->hue_step);
+    }
+
+err_out:
+    return result;
+}
+
+/* Coherent noise sampled along the strip, with time as the second axis.
+ * Each zone starts at a different offset into the noise field. */
+struct ctx_noise
+{
+    uint32_t scale;
+    int32_t speed;
+    uint32_t base;
+    uint32_t time;
+    int32_t time_rem;
+    uint8_t hue_min;
+    uint8_t hue_range;
+    uint8_t val_min;
+};
+
+void filter_noise(struct led_filter *this,
+                  struct scene_state *scene,
+                  const struct anim_clock *clk,
+                  hsvValue_t hsv_vals[],
+                  unsigned int strip_len)
+{
+    struct ctx_noise *ctx;
+    unsigned int i;
+    uint32_t x;
+    uint8_t n;
+
+    ctx = (struct ctx_noise *) this->priv;
+
+    ctx->time += clock_step(clk, ctx->speed, &ctx->time_rem);
+
+    x = ctx->base;
+    for(i = 0; i < strip_len; ++i){
+        n = noise2(x, ctx->time);
+        x += ctx->scale;
+
+        hsv_vals[i].hue = ctx->hue_min + scale_down(ctx->hue_range * n);
+        hsv_vals[i].saturation = 255u;
+        hsv_vals[i].value = ctx->val_min
+                                + scale_down((255u - ctx->val_min) * n);
+    }
+}
+
+int init_noise(struct led_filter *this, struct blinken_cfg *cfg, bool update)
+{
+    int result;
+    struct ctx_noise *ctx;
+    struct cfg_noise *noise;
+
+    result = 0;
+
+    if(update){
+        ctx = (struct ctx_noise *) this->priv;
+    } else {
+        this->name = "noise";
+        this->filter = filter_noise;
+        this->init = init_noise;
+        this->deinit = filter_deinit;
+        INIT_LIST_HEAD(&(this->filters));
+
+        ctx = malloc(sizeof(*ctx));
+        if(ctx == NULL){
+            printf("[%s] malloc() failed\n", __func__);
+            result = -1;
+            goto err_out;
+        }
+
+        memset(ctx, 0x0, sizeof(*ctx));
+        this->priv = ctx;
+    }
+
+    noise = &cfg->noise;
+    if(noise->valid == ~0x0){
+        noise->valid = 0;
+        noise->scale = 16u;
+        noise->speed = 128u;
+        noise->hue_min = 0u;
+        noise->hue_max = 40u;
+        noise->val_min = 32u;
+        cfg_updated = 1;
+    }
+
+    if(noise->scale > scale_up(4u)){
+        noise->scale = scale_up(4u);
+        cfg_updated = 1;
+    }
+
+    if(noise->speed > scale_up(100u)){
+        noise->speed = scale_up(100u);
+        cfg_updated = 1;
+    }
+
+    if(noise->hue_max > 255u || noise->hue_min > 255u || noise->val_min > 255u){
+        noise->hue_min = min(noise->hue_min, 255u);
+        noise->hue_max = min(noise->hue_max, 255u);
+        noise->val_min = min(noise->val_min, 255u);
+        cfg_updated = 1;
+    }
+
+    if(noise->hue_max < noise->hue_min){
+        noise->hue_max = noise->hue_min;
+        cfg_updated = 1;
+    }
+
+    ctx->scale = noise->scale;
+    ctx->speed = noise->speed;
+    ctx->base = scale_up(this->zone * 64u);
+    ctx->hue_min = noise->hue_min;
+    ctx->hue_range = noise->hue_max - noise->hue_min;
+    ctx->val_min = noise->val_min;
+
+err_out:
+    return result;
+}
+
+/* Runs the uploaded effect program. A fault stops the program until a new
+ * one is uploaded, running out of budget only cuts the current frame short. */
+struct ctx_vm
+{
+    struct vm_state vm;
+    uint32_t generation;
+    uint32_t budget;
+    bool faulted;
+};
+
+void filter_vm(struct led_filter *this,
+               struct scene_state *scene,
+               const struct anim_clock *clk,
+               hsvValue_t hsv_vals[],
+               unsigned int strip_len)
+{
+    struct ctx_vm *ctx;
+    struct vm_env env;
+    int result;
+
+    ctx = (struct ctx_vm *) this->priv;
+
+    if(vm_prog.hdr.magic != VM_MAGIC){
+        return;
+    }
+
+    /* a new program starts with fresh registers */
+    if(ctx->generation != vm_generation){
+        vm_reset(&ctx->vm, ctx->budget, urand());
+        ctx->generation = vm_generation;
+        ctx->faulted = false;
+    }
+
+    if(ctx->faulted){
+        return;
+    }
+
+    env.time = (int32_t) (scale_up(clk->now / 1000)
+                          + scale_up(clk->now % 1000) / 1000);
+    env.delta = (int32_t) (scale_up(clk->delta) / 1000);
+
+    result = vm_run(&vm_prog, &ctx->vm, &env, (uint8_t *) hsv_vals,
+                    strip_len);
+    if(result < 0){
+        printf("[%s] program fault at %u: %s\n", __func__,
+               (unsigned int) ctx->vm.fault_pc, ctx->vm.fault);
+        ctx->faulted = true;
+        ++vm_info.faults;
+    } else if(result > 0){
+        ++vm_info.overruns;
+    }
+
+    vm_info.used = ctx->vm.used;
+}
+
+int init_vm(struct led_filter *this, struct blinken_cfg *cfg, bool update)
+{
+    int result;
+    struct ctx_vm *ctx;
+    struct cfg_vm *vm;
+
+    result = 0;
+
+    if(update){
+        ctx = (struct ctx_vm *) this->priv;
+    } else {
+        this->name = "vm";
+        this->filter = filter_vm;
+        this->init = init_vm;
+        this->deinit = filter_deinit;
+        INIT_LIST_HEAD(&(this->filters));
+
+        ctx = malloc(sizeof(*ctx));
+        if(ctx == NULL){
+            printf("[%s] malloc() failed\n", __func__);
+            result = -1;
+            goto err_out;
+        }
+
+        memset(ctx, 0x0, sizeof(*ctx));
+        ctx->generation = vm_generation - 1;
+        this->priv = ctx;
+    }
+
+    vm = &cfg->vm;
+    if(vm->valid == ~0x0){
+        vm->valid = 0;
+        vm->budget = VM_BUDGET_DEF;
+        cfg_updated = 1;
+    }
+
+    if(vm->budget == 0 || vm->budget > VM_BUDGET_MAX){
+        vm->budget = vm->budget == 0 ? VM_BUDGET_DEF : VM_BUDGET_MAX;
+        cfg_updated = 1;
+    }
+
+    ctx->budget = vm->budget;
+    ctx->vm.budget = vm->budget;
+
+err_out:
+    return result;
+}
+
+/* all known filters, in the order they are run within a chain */
+static const struct
+{
+    uint32_t mask;
+    init_fn init;
+} chain_filters[] = {
+    { FILTER_RAINBOW,       init_rainbow },
+    { FILTER_NOISE,         init_noise },
+    { FILTER_VM,            init_vm },
+    { FILTER_FADE,          init_fade },
+    { FILTER_FLICKER,       init_flicker },
+    { FILTER_EYE,           init_eye },
+    { FILTER_PARTICLES,     init_particles },
+    { FILTER_SPRITES,       init_sprites },
+};
+
+static int chain_setup(struct list_head *filters, uint32_t mask,
+                       unsigned int zone, struct blinken_cfg *cfg)
+{
+    struct led_filter *filter;
+    unsigned int i;
+    int result;
+
+    result = 0;
+
+    for(i = 0; i < ARRAY_SIZE(chain_filters); ++i){
+        if(!(mask & chain_filters[i].mask)){
+            continue;
+        }
+
+        filter = malloc(sizeof(*filter));
+        if(filter == NULL){
+            printf("[%s] malloc() failed\n", __func__);
+            result = -1;
+            goto err_out;
+        }
+
+        memset(filter, 0x0, sizeof(*filter));
+        filter->zone = zone;
+        filter->mask = chain_filters[i].mask;
+
+        result = chain_filters[i].init(filter, cfg, false);
+        if(result != 0){
+            free(filter);
+            goto err_out;
+        }
+
+        list_add_tail(&(filter->filters), filters);
+    }
+
+err_out:
+    return result;
+}
+
+static void chain_teardown(struct list_head *filters)
+{
+    struct led_filter *filter, *tmp;
+
+    list_for_each_entry_safe(filter, tmp, filters, filters,
+                             struct led_filter)
+    {
+        list_del(&(filter->filters));
+        if(filter->deinit != NULL){
+            filter->deinit(filter);
+        }
+        free(filter);
+    }
+}
+
+static inline uint8_t blend8(uint8_t dst, uint8_t src,
+                             enum blend_mode mode, uint8_t opacity)
+{
+    switch(mode){
+    case blend_add:
+        return qadd8(dst, mul8(src, opacity));
+    case blend_screen:
+        return dst + mul8(255u - dst, mul8(src, opacity));
+    case blend_multiply:
+        src = mul8(dst, src);
+        break;
+    default:
+        break;
+    }
+
+    return (uint8_t) ((dst * (255u - opacity) + src * opacity + 127u) / 255u);
+}
+
+/* Blend all overlays onto the base layer in a single pass. Every layer's HSV
+ * value is converted to RGB exactly once. In alpha mode the pixel's HSV value
+ * is used as alpha, so unlit overlay pixels stay transparent. */
+static void composite(struct strip_handler *this, rgbValue_t rgb[],
+                      struct led_layer *overlays[], unsigned int num)
+{
+    unsigned int i, j;
+    struct led_layer *layer;
+    hsvValue_t hsv;
+    rgbValue_t src, dst;
+    uint8_t alpha, shift;
+
+    shift = scale_down(this->palette.offset);
+
+    for(i = 0; i < this->strip_len; ++i){
+        if(this->palette.enabled){
+            dst = this->palette.entries[(uint8_t) (this->palette.index[i]
+                                                   + shift)];
+        } else {
+            ws2812_hsv2rgb(&this->layers[0].hsv_vals[i], &dst);
+        }
+
+        for(j = 0; j < num; ++j){
+            layer = overlays[j];
+            hsv = layer->hsv_vals[i];
+            alpha = layer->opacity;
+
+            if(layer->mode == blend_alpha){
+                alpha = mul8(alpha, hsv.value);
+                hsv.value = 255u;
+                if(alpha == 0){
+                    continue;
+                }
+            } else if(layer->mode != blend_multiply && hsv.value == 0){
+                continue;
+            }
+
+            ws2812_hsv2rgb(&hsv, &src);
+            dst.red = blend8(dst.red, src.red, layer->mode, alpha);
+            dst.green = blend8(dst.green, src.green, layer->mode, alpha);
+            dst.blue = blend8(dst.blue, src.blue, layer->mode, alpha);
+        }
+
+        rgb[i] = dst;
+    }
+}
+
+/* Dispatch the filters the current scene asks for. Overlays have no scenes
+ * and run all of their filters. A scene finished by one filter is left right
+ * away, the rest of the chain already runs in the next one. */
+static void run_filters(struct list_head *filters, struct scene_state *scene,
+                        const struct anim_clock *clk,
+                        hsvValue_t hsv_vals[], unsigned int len)
+{
+    struct led_filter *filter;
+    uint32_t start, cycles;
+
+    list_for_each_entry(filter, filters, filters, struct led_filter)
+    {
+        if(scene != NULL && !(filter->mask & scenes[scene->id].filters)){
+            continue;
+        }
+
+        start = cycles_now();
+        filter->filter(filter, scene, clk, hsv_vals, len);
+        cycles = cycles_now() - start;
+
+        ++filter->prof.calls;
+        filter->prof.total += cycles;
+        if(cycles > filter->prof.max){
+            filter->prof.max = cycles;
+        }
+
+        if(scene != NULL && scene->done){
+            scene_switch(scene);
+            scene->entered = true;
+        }
+    }
+}
+
+static void audio_sample(uint32_t id)
+{
+    int16_t sample;
+
+    sample = (int16_t) (analogin_read_u16(&audio_adc) - 0x8000u);
+    audio_ring_put(&audio_ring, &sample, 1);
+}
+
+/* Start or stop sampling to follow the running config. */
+static void audio_input(bool enable)
+{
+    if(enable == audio_running){
+        return;
+    }
+
+    if(enable){
+        analogin_init(&audio_adc, AUDIO_ADC);
+        gtimer_init(&audio_timer, AUDIO_TIMER);
+        gtimer_start_periodical(&audio_timer, 1000000 / AUDIO_RATE,
+                                (void *) audio_sample, 0);
+    } else {
+        gtimer_stop(&audio_timer);
+        gtimer_deinit(&audio_timer);
+        analogin_deinit(&audio_adc);
+
+        memset(&audio_now, 0x0, sizeof(audio_now));
+    }
+
+    audio_running = enable;
+}
+
+/* overlays that contribute to the frame, in blending order */
+static unsigned int visible_overlays(struct strip_handler *this,
+                                     struct led_layer *overlays[])
+{
+    struct led_layer *layer;
+    unsigned int i, num;
+
+    num = 0;
+    for(i = 1; i < BLINKEN_MAX_LAYERS; ++i){
+        layer = &this->layers[i];
+
+        if(list_empty(&layer->filters) || layer->opacity == 0){
+            continue;
+        }
+
+        overlays[num++] = layer;
+    }
+
+    return num;
+}
+
+/* Keep the last frame of the outgoing handler for the crossfade. LEDs beyond
+ * its strip length fade in from black. */
+static void crossfade_start(struct strip_handler *this, uint32_t duration)
+{
+    struct led_layer *overlays[BLINKEN_MAX_LAYERS - 1];
+    unsigned int num;
+
+    memset(fade_buffer, 0x0, sizeof(fade_buffer));
+
+    num = visible_overlays(this, overlays);
+    composite(this, fade_buffer, overlays, num);
+
+    xfade.duration = duration;
+    xfade.elapsed = 0;
+}
+
+static void crossfade_step(rgbValue_t rgb[], unsigned int len,
+                           const struct anim_clock *clk)
+{
+    unsigned int i;
+    uint8_t alpha;
+
+    xfade.elapsed += clk->delta;
+    if(xfade.elapsed >= xfade.duration){
+        xfade.duration = 0;
+        return;
+    }
+
+    alpha = (uint8_t) ((xfade.elapsed * 255u) / xfade.duration);
+
+    for(i = 0; i < len; ++i){
+        rgb[i].red = blend8(fade_buffer[i].red, rgb[i].red,
+                            blend_alpha, alpha);
+        rgb[i].green = blend8(fade_buffer[i].green, rgb[i].green,
+                              blend_alpha, alpha);
+        rgb[i].blue = blend8(fade_buffer[i].blue, rgb[i].blue,
+                             blend_alpha, alpha);
+    }
+}
+
+/* Run the filter chains of all zones and visible overlays for one frame.
+ * Returns the number of overlays that have to be composited. */
+static unsigned int render_layers(struct strip_handler *this,
+                                  struct led_layer *overlays[])
+{
+    struct led_zone *zone;
+    unsigned int i, num;
+
+    /* in indexed mode the zones' filters are idle, the palette is animated
+     * instead */
+    if(this->palette.enabled){
+        palette_step(&this->palette, &this->clock);
+    }
+
+    /* zone 0 first, so the other zones are drawn over the background */
+    for(i = 0; i < BLINKEN_MAX_ZONES && !this->palette.enabled; ++i){
+        zone = &this->zones[i];
+
+        if(zone->len == 0 || zone->offset + zone->len > this->strip_len){
+            continue;
+        }
+
+        run_filters(&zone->filters, &zone->scene, &this->clock,
+                    &(this->layers[0].hsv_vals[zone->offset]), zone->len);
+        scene_step(&zone->scene, &this->clock);
+    }
+
+    num = visible_overlays(this, overlays);
+    for(i = 0; i < num; ++i){
+        run_filters(&overlays[i]->filters, NULL, &this->clock,
+                    overlays[i]->hsv_vals, this->strip_len);
+    }
+
+    return num;
+}
+
+/* Start the crossfade a scene change has asked for. The LED buffers still
+ * hold the last frame, which serves as the snapshot. */
+static void scene_crossfade(struct strip_handler *this)
+{
+    uint32_t fade;
+    unsigned int i;
+
+    fade = 0;
+    for(i = 0; i < BLINKEN_MAX_ZONES; ++i){
+        fade = max(fade, this->zones[i].scene.fade);
+        this->zones[i].scene.fade = 0;
+    }
+
+    if(fade > 0){
+        crossfade_start(this, fade);
+    }
+}
+
+static int render_frame(struct strip_handler *this, ws2812_t *ws2812)
+{
+    struct led_layer *overlays[BLINKEN_MAX_LAYERS - 1];
+    unsigned int num;
+    int result;
+
+    clock_update(&this->clock);
+
+    audio_input(this->audio);
+    if(this->audio){
+        audio_state.threshold = this->audio_threshold;
+        audio_analyse(&audio_state, &audio_ring, this->clock.delta,
+                      &audio_now);
+    }
+
+    scene_crossfade(this);
+    num = render_layers(this, overlays);
+
+    /* a crossfade always takes the RGB path */
+    if(num > 0 || xfade.duration > 0){
+        composite(this, rgb_buffer, overlays, num);
+        if(xfade.duration > 0){
+            crossfade_step(rgb_buffer, this->strip_len, &this->clock);
+        }
+
+        result = ws2812_send_rgb(ws2812, rgb_buffer, this->strip_len,
+                                 this->delay);
+    } else if(this->palette.enabled){
+        result = ws2812_send_indexed(ws2812, this->palette.index,
+                                     this->palette.entries,
+                                     scale_down(this->palette.offset),
+                                     this->strip_len, this->delay);
+    } else {
+        result = ws2812_send(ws2812, this->layers[0].hsv_vals,
+                             this->strip_len, this->delay);
+    }
+
+    return result;
+}
+
+static void load_config(void)
+{
+    flash_t flash;
+    int result;
+
+    printf("[%s] reading config from flash\n", __func__);
+
+    cfglog_init();
+    result = cfglog_read(&strip_cfg, sizeof(strip_cfg));
+    if(result == 0){
+        return;
+    }
+
+    /* fall back to the sector written by older firmware and move its
+     * contents over to the log */
+    device_mutex_lock(RT_DEV_LOCK_FLASH);
+    result = flash_stream_read(&flash,
+                               LED_SETTINGS_SECTOR,
+                               sizeof(strip_cfg),
+                               (uint8_t *) &strip_cfg);
+    device_mutex_unlock(RT_DEV_LOCK_FLASH);
+
+    cfg_updated = 1;
+}
+
+static int save_config(const struct blinken_cfg *cfg)
+{
+    int result;
+
+    printf("[%s] saving config to flash\n", __func__);
+
+    result = cfglog_write(cfg, sizeof(*cfg));
+    if(result != 0){
+        printf("[%s] Saving config failed\n", __func__);
+    }
+
+    return result;
+}
+
+/* Must be called with cfg_lock held. */
+static void request_save(void)
+{
+    ++cfg_generation;
+    xSemaphoreGive(persist_sema);
+}
+
+void persist_task(void *pvParameters __attribute__((unused)))
+{
+    uint32_t generation;
+    int result;
+
+    while(1){
+        xSemaphoreTake(persist_sema, portMAX_DELAY);
+
+        /* every further change restarts the settle window */
+        while(xSemaphoreTake(persist_sema, PERSIST_SETTLE) == pdTRUE){
+            ;
+        }
+
+        /* work on a copy, so writers do not have to wait for the flash */
+        xSemaphoreTake(cfg_lock, portMAX_DELAY);
+        memmove(&cfg_save, &strip_cfg, sizeof(cfg_save));
+        generation = cfg_generation;
+        persist_info.saving = 1;
+        xSemaphoreGive(cfg_lock);
+
+        result = save_config(&cfg_save);
+
+        /* on failure the config stays dirty until the next change */
+        if(result == 0){
+            saved_generation = generation;
+            ++persist_info.saves;
+        } else {
+            ++persist_info.failures;
+        }
+        persist_info.saving = 0;
+    }
+}
+
+uint32_t blinken_get_config_generation(void)
+{
+    return cfg_generation;
+}
+
+void blinken_get_persist_info(struct blinken_persist_info *info)
+{
+    *info = persist_info;
+    info->dirty = (cfg_generation != saved_generation);
+}
+
+static uint32_t preset_crc(const struct preset_rec *rec)
+{
+    return crc32_update(0, &rec->len, sizeof(rec->len) + sizeof(rec->name)
+                                      + sizeof(rec->cfg));
+}
+
+/* Read a slot's record. A config stored shorter than the current one is
+ * filled up with 0xff, just like unwritten flash, so the missing settings
+ * get their defaults. Stored bytes beyond the current config only go into
+ * the CRC. */
+static int read_preset(unsigned int slot, struct preset_rec *rec)
+{
+    uint8_t buff[64];
+    uint32_t addr, crc, done, chunk;
+    flash_t flash;
+    int result;
+
+    addr = preset_addr(slot);
+    memset(rec, 0xff, sizeof(*rec));
+
+    device_mutex_lock(RT_DEV_LOCK_FLASH);
+    result = flash_stream_read(&flash, addr, PRESET_HDR_SIZE, (uint8_t *) rec);
+    if(result != 1 || rec->magic != PRESET_MAGIC
+       || rec->len > PRESET_SLOT_SIZE - PRESET_HDR_SIZE){
+        result = -1;
+        goto err_out;
+    }
+
+    addr += PRESET_HDR_SIZE;
+    chunk = min(rec->len, sizeof(rec->cfg));
+    result = flash_stream_read(&flash, addr, chunk, (uint8_t *) &rec->cfg);
+    if(result != 1){
+        result = -1;
+        goto err_out;
+    }
+
+    crc = crc32_update(0, &rec->len, sizeof(rec->len) + sizeof(rec->name));
+    crc = crc32_update(crc, &rec->cfg, chunk);
+
+    for(done = chunk; done < rec->len; done += chunk){
+        chunk = min(rec->len - done, sizeof(buff));
+        result = flash_stream_read(&flash, addr + done, chunk, buff);
+        if(result != 1){
+            result = -1;
+            goto err_out;
+        }
+
+        crc = crc32_update(crc, buff, chunk);
+    }
+
+    result = (crc == rec->crc) ? 0 : -1;
+
+err_out:
+    device_mutex_unlock(RT_DEV_LOCK_FLASH);
+
+    return result;
+}
+
+static void load_presets(void)
+{
+    unsigned int i;
+
+    for(i = 0; i < BLINKEN_MAX_PRESETS; ++i){
+        if(read_preset(i, &presets[i]) != 0){
+            memset(&presets[i], 0x0, sizeof(presets[i]));
+        }
+
+        presets[i].name[BLINKEN_PRESET_NAME - 1] = '\0';
+    }
+}
+
+/* Presets change rarely, so all slots are simply rewritten together. */
+static int save_presets(void)
+{
+    flash_t flash;
+    unsigned int i;
+    int result;
+
+    if(sizeof(presets[0]) > PRESET_SLOT_SIZE){
+        printf("[%s] Config too big for a preset slot\n", __func__);
+        return -1;
+    }
+
+    printf("[%s] saving presets to flash\n", __func__);
+
+    result = 1;
+    device_mutex_lock(RT_DEV_LOCK_FLASH);
+    flash_erase_sector(&flash, BLINKEN_PRESET_SECTOR);
+    for(i = 0; i < BLINKEN_MAX_PRESETS && result == 1; ++i){
+        if(presets[i].magic == PRESET_MAGIC){
+            result = flash_stream_write(&flash, preset_addr(i),
+                                        sizeof(presets[i]),
+                                        (uint8_t *) &presets[i]);
+        }
+    }
+    device_mutex_unlock(RT_DEV_LOCK_FLASH);
+
+    if(result != 1){
+        printf("[%s] Saving presets failed\n", __func__);
+        return -1;
+    }
+
+    return 0;
+}
+
+/* Make a prepared handler the one being rendered. The buffers still hold the
+ * previous handler's frame, so they are cleared before it takes over. */
+static void activate_handler(struct strip_handler *this, ws2812_t *ws2812)
+{
+    this->active = true;
+
+    memset(hsv_buffer, 0x0, sizeof(hsv_buffer));
+    memset(layer_buffer, 0x0, sizeof(layer_buffer));
+
+    ws2812_set_len(ws2812, this->strip_len);
+
+    if(this->palette.enabled){
+        palette_map(this);
+    }
+}
+
+static void release_handler(struct strip_handler *this)
+{
+    unsigned int i;
+
+    for(i = 0; i < BLINKEN_MAX_ZONES; ++i){
+        chain_teardown(&this->zones[i].filters);
+        this->zones[i].mask = 0;
+    }
+
+    for(i = 1; i < BLINKEN_MAX_LAYERS; ++i){
+        chain_teardown(&this->layers[i].filters);
+        this->layers[i].mask = 0;
+    }
+
+    this->ready = false;
+}
+
+/* Bring a preset's filter chains in line with its stored config. This only
+ * has to be done after the preset was saved or edited while running. */
+static int prepare_preset(unsigned int slot, ws2812_t *ws2812)
+{
+    struct strip_handler *this;
+    int result;
+
+    result = 0;
+    this = preset_handler(slot);
+
+    if(presets[slot].magic != PRESET_MAGIC){
+        result = -1;
+        goto err_out;
+    }
+
+    if(!this->ready || this->modified){
+        result = init_handler(this, &presets[slot].cfg, ws2812, this->ready);
+
+        /* the config is sanitised in place, the record must stay valid for
+         * the next save of all slots */
+        presets[slot].len = sizeof(presets[slot].cfg);
+        presets[slot].crc = preset_crc(&presets[slot]);
+
+        /* the lists are set up now, a failed chain is redone next time */
+        this->ready = true;
+        this->modified = (result != 0);
+    }
+
+err_out:
+    return result;
+}
+
+/* Called by the render task between two frames. */
+static int switch_preset(unsigned int slot, uint32_t fade, ws2812_t *ws2812)
+{
+    struct strip_handler *prev, *next;
+    int result;
+
+    prev = active_handler;
+    next = preset_handler(slot);
+
+    /* take the snapshot before the shared buffers are touched */
+    if(fade > 0){
+        crossfade_start(prev, fade);
+    }
+
+    result = prepare_preset(slot, ws2812);
+    if(result != 0){
+        xfade.duration = 0;
+        goto err_out;
+    }
+
+    if(next != prev){
+        next->clock = prev->clock;
+        prev->active = false;
+
+        /* the boot config is not kept, its chains would only take up heap */
+        if(prev == &handlers[0]){
+            release_handler(prev);
+        }
+
+        activate_handler(next, ws2812);
+        active_handler = next;
+    }
+
+err_out:
+    return result;
+}
+
+/* Hand the changes in cfg_next or vm_next over to the render task and wait
+ * until they have been applied. Must be called with cfg_lock held. */
+static int publish_pending(uint32_t what)
+{
+    BaseType_t status;
+    bool retracted;
+
+    /* drop a completion left over from a request that timed out */
+    xSemaphoreTake(cfg_done, 0);
+
+    pending_result = 0;
+    __sync_synchronize();
+    pending_mask = what;
+
+    status = xSemaphoreTake(cfg_done, APPLY_TIMEOUT);
+    if(status == pdTRUE){
+        return pending_result;
+    }
+
+    /* Take the change back unless the render task has already claimed it.
+     * In that case it is being applied right now and we have to wait for
+     * it, however long it takes. cfg_next must not be touched until then
+     * and the change will be in effect, so it is no failure either. */
+    taskENTER_CRITICAL();
+    retracted = (pending_mask != 0);
+    pending_mask = 0;
+    taskEXIT_CRITICAL();
+
+    if(!retracted){
+        xSemaphoreTake(cfg_done, portMAX_DELAY);
+        return pending_result;
+    }
+
+    printf("[%s] render task did not pick up the change\n", __func__);
+    return -1;
+}
+
+static void prof_chain(struct list_head *filters, unsigned int layer,
+                       unsigned int zone)
+{
+    struct blinken_prof_info *info;
+    struct led_filter *filter;
+
+    list_for_each_entry(filter, filters, filters, struct led_filter)
+    {
+        if(prof_next != NULL && prof_num < BLINKEN_MAX_PROF){
+            info = &prof_next[prof_num++];
+
+            strncpy(info->name, filter->name, sizeof(info->name) - 1);
+            info->name[sizeof(info->name) - 1] = '\0';
+            info->layer = layer;
+            info->zone = zone;
+            info->calls = filter->prof.calls;
+            info->max = filter->prof.max;
+            info->total = filter->prof.total;
+        }
+
+        if(prof_reset){
+            memset(&filter->prof, 0x0, sizeof(filter->prof));
+        }
+    }
+}
+
+/* Copy the running handler's filter profile to prof_next. */
+static void prof_collect(struct strip_handler *this)
+{
+    unsigned int i;
+
+    prof_num = 0;
+
+    for(i = 0; i < BLINKEN_MAX_ZONES; ++i){
+        prof_chain(&this->zones[i].filters, 0, i);
+    }
+
+    for(i = 1; i < BLINKEN_MAX_LAYERS; ++i){
+        prof_chain(&this->layers[i].filters, i, 0);
+    }
+}
+
+/* Called by the render task between two frames. */
+static void apply_pending(ws2812_t *ws2812)
+{
+    struct strip_handler *this;
+    uint32_t what;
+    int result;
+
+    taskENTER_CRITICAL();
+    what = pending_mask;
+    pending_mask = 0;
+    taskEXIT_CRITICAL();
+
+    if(what == 0){
+        return;
+    }
+
+    __sync_synchronize();
+    result = 0;
+
+    if(what & PENDING_CFG){
+        result = init_handler(active_handler, &cfg_next, ws2812, true);
+
+        /* a preset edited while running must be redone before its next use */
+        active_handler->modified = (active_handler != &handlers[0]);
+    }
+
+    if(what & PENDING_PRESET){
+        result = switch_preset(slot_next, fade_next, ws2812);
+    }
+
+    /* a preset has been saved, the running one already matches it */
+    if(what & PENDING_PREP){
+        this = preset_handler(slot_next);
+        if(this == active_handler){
+            this->modified = false;
+        } else {
+            this->modified = true;
+            result = prepare_preset(slot_next, ws2812);
+        }
+    }
+
+    if(what & PENDING_PROF){
+        prof_collect(active_handler);
+    }
+
+    if(what & PENDING_PROG){
+        memmove(&vm_prog, &vm_next, sizeof(vm_prog));
+        ++vm_generation;
+
+        memset(&vm_info, 0x0, sizeof(vm_info));
+        vm_info.code_len = vm_prog.hdr.code_len;
+        vm_info.mode = vm_prog.hdr.mode;
+    }
+
+    pending_result = result;
+    __sync_synchronize();
+    xSemaphoreGive(cfg_done);
+}
+
+static void load_program(void)
+{
+    flash_t flash;
+
+    device_mutex_lock(RT_DEV_LOCK_FLASH);
+    flash_stream_read(&flash, BLINKEN_VM_SECTOR, sizeof(vm_prog),
+                      (uint8_t *) &vm_prog);
+    device_mutex_unlock(RT_DEV_LOCK_FLASH);
+
+    if(vm_verify(&vm_prog, sizeof(vm_prog)) != 0){
+        printf("[%s] no valid effect program in flash\n", __func__);
+        memset(&vm_prog, 0x0, sizeof(vm_prog));
+    }
+
+    vm_info.code_len = vm_prog.hdr.code_len;
+    vm_info.mode = vm_prog.hdr.mode;
+}
+
+int blinken_set_program(const struct vm_program *prog, size_t len)
+{
+    flash_t flash;
+    BaseType_t status;
+    int result;
+
+    result = 0;
+    if(prog == NULL || vm_verify(prog, len) != 0){
+        printf("[%s] invalid program\n", __func__);
+        result = -1;
+        goto err_out;
+    }
+
+    len = sizeof(prog->hdr) + prog->hdr.code_len;
+
+    /* write the flash before taking the lock, the strip keeps running */
+    device_mutex_lock(RT_DEV_LOCK_FLASH);
+    flash_erase_sector(&flash, BLINKEN_VM_SECTOR);
+    result = flash_stream_write(&flash, BLINKEN_VM_SECTOR, len,
+                                (uint8_t *) prog);
+    device_mutex_unlock(RT_DEV_LOCK_FLASH);
+
+    if(result != 1){
+        printf("[%s] Saving program failed\n", __func__);
+        result = -1;
+        goto err_out;
+    }
+
+    status = xSemaphoreTake(cfg_lock, 15 * configTICK_RATE_HZ);
+    if(status != pdTRUE){
+        printf("[%s] Timeout waiting for config lock.\n", __func__);
+        result = -1;
+        goto err_out;
+    }
+
+    memset(&vm_next, 0x0, sizeof(vm_next));
+    memmove(&vm_next, prog, len);
+
+    result = publish_pending(PENDING_PROG);
+
+    xSemaphoreGive(cfg_lock);
+
+err_out:
+    return result;
+}
+
+void blinken_get_vm_info(struct blinken_vm_info *info)
+{
+    *info = vm_info;
+}
+
+struct blinken_cfg *blinken_get_config(void)
+{
+    struct blinken_cfg *cfg = NULL;
+    BaseType_t status;
+
+    status = xSemaphoreTake(cfg_lock, 15 * configTICK_RATE_HZ);
+    if(status != pdTRUE){
+        printf("[%s] Timeout waiting for config lock.\n", __func__);
+        goto err_out;
+    }
+
+    if(strip_cfg.magic == BLINKEN_CFG_MAGIC){
+        cfg = malloc(sizeof(*cfg));
+        if(cfg != NULL){
+            memmove(cfg, &strip_cfg, sizeof(*cfg));
+        }
+    }
+
+    xSemaphoreGive(cfg_lock);
+
+err_out:
+    return cfg;
+}
+
+int blinken_get_config_values(const uint16_t *offsets, unsigned int num,
+                              uint32_t *values, uint32_t *generation)
+{
+    BaseType_t status;
+    unsigned int i;
+    int result;
+
+    result = -1;
+
+    status = xSemaphoreTake(cfg_lock, 15 * configTICK_RATE_HZ);
+    if(status != pdTRUE){
+        printf("[%s] Timeout waiting for config lock.\n", __func__);
+        goto err_out;
+    }
+
+    if(strip_cfg.magic == BLINKEN_CFG_MAGIC){
+        for(i = 0; i < num; ++i){
+            if(offsets[i] > sizeof(strip_cfg) - sizeof(*values)){
+                break;
+            }
+
+            memcpy(&values[i], (uint8_t *) &strip_cfg + offsets[i],
+                   sizeof(*values));
+        }
+
+        result = i == num ? 0 : -1;
+    }
+
+    if(generation != NULL){
+        *generation = cfg_generation;
+    }
+
+    xSemaphoreGive(cfg_lock);
+
+err_out:
+    return result;
+}
+
+int blinken_set_config(struct blinken_cfg *cfg)
+{
+    int result;
+    BaseType_t status;
+
+    result = 0;
+    if(cfg == NULL || cfg->magic != BLINKEN_CFG_MAGIC){
+        result = -1;
+        goto err_out;
+    } 
+
+    status = xSemaphoreTake(cfg_lock, 15 * configTICK_RATE_HZ);
+    if(status != pdTRUE){
+        printf("[%s] Timeout waiting for config lock.\n", __func__);
+        result = -1;
+        goto err_out;
+    }
+
+    /* the render task sanitises cfg_next while applying it, so what ends
+     * up in strip_cfg and in flash is what is actually running */
+    memmove(&cfg_next, cfg, sizeof(cfg_next));
+
+    result = publish_pending(PENDING_CFG);
+    if(result == 0){
+        memmove(&strip_cfg, &cfg_next, sizeof(strip_cfg));
+        active_preset = -1;
+        request_save();
+    }
+
+    xSemaphoreGive(cfg_lock);
+
+err_out:
+    return result;
+}
+
+/* Like blinken_set_config() for single values. They are applied to the
+ * running config under cfg_lock, so changes to other values in the meantime
+ * are kept. Nothing happens if all values are already set. */
+int blinken_patch_config(const uint16_t *offsets, const uint32_t *values,
+                         unsigned int num)
+{
+    BaseType_t status;
+    unsigned int i;
+    bool changed;
+    int result;
+
+    result = 0;
+    for(i = 0; i < num; ++i){
+        if(offsets[i] > sizeof(strip_cfg) - sizeof(*values)){
+            result = -1;
+            goto err_out;
+        }
+    }
+
+    status = xSemaphoreTake(cfg_lock, 15 * configTICK_RATE_HZ);
+    if(status != pdTRUE){
+        printf("[%s] Timeout waiting for config lock.\n", __func__);
+        result = -1;
+        goto err_out;
+    }
+
+    memmove(&cfg_next, &strip_cfg, sizeof(cfg_next));
+
+    changed = false;
+    for(i = 0; i < num; ++i){
+        if(memcmp((uint8_t *) &cfg_next + offsets[i], &values[i],
+                  sizeof(*values))){
+            memcpy((uint8_t *) &cfg_next + offsets[i], &values[i],
+                   sizeof(*values));
+            changed = true;
+        }
+    }
+
+    if(changed){
+        result = publish_pending(PENDING_CFG);
+        if(result == 0){
+            memmove(&strip_cfg, &cfg_next, sizeof(strip_cfg));
+            active_preset = -1;
+            request_save();
+        }
+    }
+
+    xSemaphoreGive(cfg_lock);
+
+err_out:
+    return result;
+}
+
+/* Switch to a stored preset at the next frame. The running config becomes
+ * the preset's, so it is also what the strip comes up with after a reset. */
+int blinken_load_preset(unsigned int slot, uint32_t fade)
+{
+    int result;
+    BaseType_t status;
+
+    result = 0;
+    if(slot >= BLINKEN_MAX_PRESETS){
+        result = -1;
+        goto err_out;
+    }
+
+    status = xSemaphoreTake(cfg_lock, 15 * configTICK_RATE_HZ);
+    if(status != pdTRUE){
+        printf("[%s] Timeout waiting for config lock.\n", __func__);
+        result = -1;
+        goto err_out;
+    }
+
+    if(presets[slot].magic == PRESET_MAGIC){
+        slot_next = slot;
+        fade_next = min(fade, BLINKEN_MAX_FADE);
+
+        result = publish_pending(PENDING_PRESET);
+        if(result == 0){
+            memmove(&strip_cfg, &presets[slot].cfg, sizeof(strip_cfg));
+            active_preset = slot;
+            request_save();
+        }
+    } else {
+        printf("[%s] preset %u is empty\n", __func__, slot);
+        result = -1;
+    }
+
+    xSemaphoreGive(cfg_lock);
+
+err_out:
+    return result;
+}
+
+/* Store the running config in a preset slot. */
+int blinken_save_preset(unsigned int slot, const char *name)
+{
+    struct preset_rec *rec;
+    int result;
+    BaseType_t status;
+
+    result = 0;
+    if(slot >= BLINKEN_MAX_PRESETS || name == NULL){
+        result = -1;
+        goto err_out;
+    }
+
+    status = xSemaphoreTake(cfg_lock, 15 * configTICK_RATE_HZ);
+    if(status != pdTRUE){
+        printf("[%s] Timeout waiting for config lock.\n", __func__);
+        result = -1;
+        goto err_out;
+    }
+
+    /* the render task only reads the presets while we hold the lock */
+    rec = &presets[slot];
+    memset(rec, 0x0, sizeof(*rec));
+    strncpy(rec->name, name, sizeof(rec->name) - 1);
+    memmove(&rec->cfg, &strip_cfg, sizeof(rec->cfg));
+    rec->magic = PRESET_MAGIC;
+    rec->len = sizeof(rec->cfg);
+    rec->crc = preset_crc(rec);
+
+    result = save_presets();
+    if(result == 0){
+        slot_next = slot;
+        result = publish_pending(PENDING_PREP);
+    } else {
+        /* go back to whatever made it to flash */
+        load_presets();
+    }
+
+    if(result == 0){
+        active_preset = slot;
+    }
+
+    xSemaphoreGive(cfg_lock);
+
+err_out:
+    return result;
+}
+
+int blinken_get_presets(struct blinken_preset_info info[], int *active)
+{
+    unsigned int i;
+    BaseType_t status;
+
+    status = xSemaphoreTake(cfg_lock, 15 * configTICK_RATE_HZ);
+    if(status != pdTRUE){
+        printf("[%s] Timeout waiting for config lock.\n", __func__);
+        return -1;
+    }
+
+    for(i = 0; i < BLINKEN_MAX_PRESETS; ++i){
+        info[i].valid = (presets[i].magic == PRESET_MAGIC);
+        memmove(info[i].name, presets[i].name, sizeof(info[i].name));
+    }
+
+    *active = active_preset;
+
+    xSemaphoreGive(cfg_lock);
+
+    return 0;
+}
+
+static int request_profile(struct blinken_prof_info info[], unsigned int *num,
+                           bool reset)
+{
+    BaseType_t status;
+    int result;
+
+    status = xSemaphoreTake(cfg_lock, 15 * configTICK_RATE_HZ);
+    if(status != pdTRUE){
+        printf("[%s] Timeout waiting for config lock.\n", __func__);
+        return -1;
+    }
+
+    prof_next = info;
+    prof_reset = reset;
+
+    result = publish_pending(PENDING_PROF);
+    if(result == 0 && num != NULL){
+        *num = prof_num;
+    }
+
+    prof_next = NULL;
+    prof_reset = false;
+
+    xSemaphoreGive(cfg_lock);
+
+    return result;
+}
+
+/* info[] must have room for BLINKEN_MAX_PROF entries */
+int blinken_get_profile(struct blinken_prof_info info[], unsigned int *num,
+                        bool reset)
+{
+    if(info == NULL || num == NULL){
+        return -1;
+    }
+
+    return request_profile(info, num, reset);
+}
+
+int blinken_reset_profile(void)
+{
+    return request_profile(NULL, NULL, true);
+}
+
+void run_strip(void *pvParameters __attribute__((unused)))
+{
+    unsigned int i;
+    int result;
+    BaseType_t status;
+
+    /* writers may only see the config once it has been sanitised */
+    status = xSemaphoreTake(cfg_lock, portMAX_DELAY);
+    if(status != pdTRUE){
+        printf("[%s] taking config lock failed\n", __func__);
+        goto err_out;
+    }
+
+    load_config();
+    load_program();
+    audio_init(&audio_state, AUDIO_FFT_LOG2, fft_re, fft_im);
+    cycles_init();
+
+    ws2812_cfg = ws2812_init(BLINKEN_MAX_LEDS);
+    if(ws2812_cfg == NULL){
+        printf("[%s] ws2812_init() failed\n", __func__);
+        xSemaphoreGive(cfg_lock);
+        goto err_out;
+    }
+
+    active_handler = &handlers[0];
+    active_handler->active = true;
+
+    result = init_handler(active_handler, &strip_cfg, ws2812_cfg, false);
+    if(result != 0){
+        printf("[%s] init_handler() failed\n", __func__);
+        xSemaphoreGive(cfg_lock);
+        goto err_out;
+    }
+
+    /* the generation is handed out as ETag, start somewhere that depends
+     * on the config, so tags from before a reset do not match by chance */
+    cfg_generation = crc32_update(0, &strip_cfg, sizeof(strip_cfg));
+    saved_generation = cfg_generation;
+
+    if(cfg_updated != 0){
+        cfg_updated = 0;
+        request_save();
+    }
+
+    /* have the presets' filter chains ready before anyone can switch */
+    load_presets();
+    for(i = 0; i < BLINKEN_MAX_PRESETS; ++i){
+        if(presets[i].magic == PRESET_MAGIC
+           && prepare_preset(i, ws2812_cfg) != 0){
+            printf("[%s] preparing preset %u failed\n", __func__, i);
+        }
+    }
+
+    xSemaphoreGive(cfg_lock);
+
+    clock_init(&active_handler->clock);
+
+    while(1){
+        apply_pending(ws2812_cfg);
+        render_frame(active_handler, ws2812_cfg);
+    }
+
+err_out:
+    while(1){
+        vTaskDelay(1000);
+    }
+}
+
+#define STACKSIZE               512
+#define PERSIST_STACKSIZE       384
+TaskHandle_t ledstrip_task = NULL;
+TaskHandle_t persist_task_hdl = NULL;
+
+static int ledstrip_start(void)
+{
+    int result;
+    BaseType_t status;
+
+    printf("[%s] Called\n", __func__);
+    
+    result = 0;
+    ledstrip_terminate = 0;
+
+    memset(handlers, 0x0, sizeof(handlers));
+    active_handler = NULL;
+
+    if(cfg_lock == NULL){
+        cfg_lock = xSemaphoreCreateMutex();
+    }
+
+    if(cfg_done == NULL){
+        cfg_done = xSemaphoreCreateBinary();
+    }
+
+    if(persist_sema == NULL){
+        persist_sema = xSemaphoreCreateBinary();
+    }
+
+    if(cfg_lock == NULL || cfg_done == NULL || persist_sema == NULL){
+        printf("[%s] Creating config semaphores failed\n", __func__);
+        result = -1;
+        goto err_out;
+    }
+
+    if(ledstrip_task == NULL){
+        status = xTaskCreate(run_strip, (const char * )"led_strip", STACKSIZE,
+                                 NULL, tskIDLE_PRIORITY + 1, &ledstrip_task);
+
+        if(status != pdPASS){
+            printf("[%s] Create ledstrip task failed!\n", __func__);
+            result = -1;
+            goto err_out;
+        }
+    }
+
+    if(persist_task_hdl == NULL){
+        status = xTaskCreate(persist_task, (const char * )"persist",
+                             PERSIST_STACKSIZE, NULL, tskIDLE_PRIORITY,
+                             &persist_task_hdl);
+
+        if(status != pdPASS){
+            printf("[%s] Create persist task failed!\n", __func__);
             result = -1;
             goto err_out;
         }
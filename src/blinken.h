@@ -19,10 +19,10 @@
 #ifndef __BLINKEN_H__
 #define __BLINKEN_H__
 
-#include <math.h>
 #include <stdint.h>
 #include <stdbool.h>
 #include "ws2812.h"
+#include "vm.h"
 
 #define min(a,b)            ((a) < (b) ? (a) : (b))
 #define max(a,b)            ((a) > (b) ? (a) : (b))
@@ -34,6 +34,45 @@
 #define BLINKEN_MAX_LEDS    WS2812_MAX_LEDS
 #define BLINKEN_MAX_STEPS   500
 
+/* Effect speeds are given in steps of a reference frame. They are converted
+ * to rates per second, so the frame rate does not change the animation. */
+#define BLINKEN_FRAME_MS    10
+#define BLINKEN_FPS         (1000 / BLINKEN_FRAME_MS)
+#define BLINKEN_MAX_DELTA   100
+
+/* Layer 0 is the base layer, all others are composited on top of it. Each
+ * overlay costs 3 bytes per LED for its HSV buffer. */
+#define BLINKEN_MAX_LAYERS  3
+
+/* Zone 0 always covers the whole strip and uses the top level effect
+ * settings. The other zones are rendered on top of it over their own span. */
+#define BLINKEN_MAX_ZONES   4
+
+#define FILTER_RAINBOW      (1 << 0)
+#define FILTER_FADE         (1 << 1)
+#define FILTER_FLICKER      (1 << 2)
+#define FILTER_EYE          (1 << 3)
+#define FILTER_NOISE        (1 << 4)
+#define FILTER_VM           (1 << 5)
+#define FILTER_PARTICLES    (1 << 8)
+#define FILTER_SPRITES      (1 << 9)
+
+/* filters allowed in zones and on overlay layers */
+#define ZONE_FILTER_DEFAULT (FILTER_RAINBOW | FILTER_FADE \
+                                | FILTER_FLICKER | FILTER_EYE)
+#define ZONE_FILTER_ALL     (ZONE_FILTER_DEFAULT | FILTER_NOISE | FILTER_VM)
+#define LAYER_FILTER_ALL    (FILTER_PARTICLES | FILTER_SPRITES \
+                                | FILTER_NOISE | FILTER_VM)
+
+#define BLINKEN_MAX_PARTICLES   32
+#define BLINKEN_MAX_SPRITES     16
+#define BLINKEN_MAX_SPRITE_SIZE 32
+
+/* In indexed mode the base layer holds one palette index per LED instead of
+ * a HSV value. Colour cycling then only moves the palette offset. */
+#define BLINKEN_PALETTE_SIZE    256
+#define BLINKEN_MAX_REPEAT      64
+
 struct cfg_rainbow {
     uint32_t valid;
     uint32_t hue_min;
@@ -59,6 +98,117 @@ struct cfg_eye {
     uint32_t rate;
 } __attribute__((packed));
 
+enum blend_mode {
+    blend_add,
+    blend_screen,
+    blend_multiply,
+    blend_alpha,
+    blend_last,
+};
+
+struct cfg_layer {
+    uint32_t valid;
+    uint32_t mode;
+    uint32_t opacity;
+    uint32_t filters;
+} __attribute__((packed));
+
+enum particle_mode {
+    particle_sparkle,
+    particle_fire,
+    particle_comet,
+    particle_last,
+};
+
+struct cfg_particles {
+    uint32_t valid;
+    uint32_t mode;
+    uint32_t rate;      // particles emitted per second
+    uint32_t speed;     // LEDs per second
+    uint32_t life;      // ms
+    uint32_t hue;
+    int32_t  gravity;   // LEDs per second^2
+    uint32_t decay;     // value lost per second, 0 disables the decay pass
+} __attribute__((packed));
+
+/* Eyes run the eye filter's motion model each, scanners bounce between the
+ * strip ends and chasers follow the sprite before them. Mixed assigns the
+ * three behaviours in turn. */
+enum sprite_mode {
+    sprite_eye,
+    sprite_scanner,
+    sprite_chaser,
+    sprite_mixed,
+    sprite_last,
+};
+
+enum sprite_shape {
+    shape_dot,
+    shape_eye,
+    shape_bar,
+    shape_comet,
+    shape_last,
+};
+
+struct cfg_sprites {
+    uint32_t valid;
+    uint32_t count;
+    uint32_t mode;
+    uint32_t shape;
+    uint32_t size;      // LEDs covered by bars and comets
+    uint32_t speed;     // LEDs per second for scanners and chasers
+    uint32_t hue;
+    uint32_t hue_step;  // hue added per sprite
+    uint32_t value;
+} __attribute__((packed));
+
+struct cfg_noise {
+    uint32_t valid;
+    uint32_t scale;     // lattice cells per LED, 8 fractional bits
+    uint32_t speed;     // lattice cells per second, 8 fractional bits
+    uint32_t hue_min;
+    uint32_t hue_max;
+    uint32_t val_min;
+} __attribute__((packed));
+
+struct cfg_palette {
+    uint32_t valid;
+    uint32_t enabled;   // render the base layer through the palette
+    uint32_t hue_min;
+    uint32_t hue_max;
+    uint32_t saturation;
+    uint32_t value;
+    uint32_t repeat;    // palette repetitions along the strip
+    int32_t  rotate;    // palette entries per second, 8 fractional bits
+} __attribute__((packed));
+
+struct cfg_vm {
+    uint32_t valid;
+    uint32_t budget;    // instructions per frame and filter
+} __attribute__((packed));
+
+/* Sound modulates the fade filter's value and the rainbow's cycle speed.
+ * A depth of 0 leaves the effect alone, 255 lets the sound drive it fully. */
+struct cfg_audio {
+    uint32_t valid;
+    uint32_t enabled;
+    uint32_t threshold; // beat threshold over average bass, 8 fractional bits
+    uint32_t fade_depth;
+    uint32_t speed_depth;
+} __attribute__((packed));
+
+struct cfg_zone {
+    uint32_t reserved;  // unused, erased zones are told by their len
+    uint32_t offset;
+    uint32_t len;
+    uint32_t filters;
+
+    struct cfg_rainbow rainbow;
+    struct cfg_fade    fade;
+    struct cfg_flicker flicker;
+    struct cfg_eye     eye;
+} __attribute__((packed));
+
 struct blinken_cfg {
     uint32_t magic;
     uint32_t version;
@@ -70,9 +220,93 @@ struct blinken_cfg {
     struct cfg_fade    fade;
     struct cfg_flicker flicker;
     struct cfg_eye     eye;
+    struct cfg_layer   layers[BLINKEN_MAX_LAYERS - 1];
+    struct cfg_zone    zones[BLINKEN_MAX_ZONES - 1];
+    struct cfg_particles particles;
+    struct cfg_noise   noise;
+    uint32_t filters;   // filters run in zone 0
+    struct cfg_palette palette;
+    struct cfg_vm      vm;
+    struct cfg_audio   audio;
+    struct cfg_sprites sprites;
 } __attribute__((packed));
 
+/* effect settings of a zone, zone 0 uses the top level settings */
+#define zone_cfg(cfg, zone, sect) \
+    ((zone) == 0 ? &((cfg)->sect) : &((cfg)->zones[(zone) - 1].sect))
+
 extern struct blinken_cfg *blinken_get_config(void);
 extern int blinken_set_config(struct blinken_cfg *cfg);
 
+/* Read single uint32_t values of the running config, each given by its
+ * offset in struct blinken_cfg. Cheaper than a copy of all of it. The
+ * generation the values belong to is stored in generation, if given. */
+extern int blinken_get_config_values(const uint16_t *offsets,
+                                     unsigned int num, uint32_t *values,
+                                     uint32_t *generation);
+
+/* Set single uint32_t values of the running config, given by their offsets
+ * like above. Other values stay as they are, even if changed concurrently. */
+extern int blinken_patch_config(const uint16_t *offsets,
+                                const uint32_t *values, unsigned int num);
+
+/* changes with every change to the running config */
+extern uint32_t blinken_get_config_generation(void);
+
+/* dirty is set while the running config has not been written to flash */
+struct blinken_persist_info {
+    uint32_t dirty;
+    uint32_t saving;
+    uint32_t saves;
+    uint32_t failures;
+};
+
+extern void blinken_get_persist_info(struct blinken_persist_info *info);
+
+struct blinken_vm_info {
+    uint32_t code_len;
+    uint32_t mode;
+    uint32_t used;
+    uint32_t overruns;
+    uint32_t faults;
+};
+
+extern int blinken_set_program(const struct vm_program *prog, size_t len);
+extern void blinken_get_vm_info(struct blinken_vm_info *info);
+
+/* Presets are complete configs stored in flash. Their filter chains are kept
+ * ready, so loading one takes effect at the next frame. The switch can fade
+ * over from the last frame for up to BLINKEN_MAX_FADE ms. */
+#define BLINKEN_MAX_PRESETS 4
+#define BLINKEN_PRESET_NAME 16
+#define BLINKEN_MAX_FADE    10000
+
+struct blinken_preset_info {
+    uint32_t valid;
+    char name[BLINKEN_PRESET_NAME];
+};
+
+extern int blinken_load_preset(unsigned int slot, uint32_t fade);
+extern int blinken_save_preset(unsigned int slot, const char *name);
+extern int blinken_get_presets(struct blinken_preset_info info[], int *active);
+
+/* Every filter call is timed in CPU cycles. The profile lists the filters of
+ * the running config, base layer zones first, then the overlays. A filter's
+ * numbers start over when its chain is rebuilt by a config change. */
+#define BLINKEN_MAX_PROF    32
+#define BLINKEN_PROF_NAME   12
+
+struct blinken_prof_info {
+    char name[BLINKEN_PROF_NAME];
+    uint32_t layer;
+    uint32_t zone;
+    uint32_t calls;
+    uint32_t max;
+    uint64_t total;
+};
+
+extern int blinken_get_profile(struct blinken_prof_info info[],
+                               unsigned int *num, bool reset);
+extern int blinken_reset_profile(void);
+
 #endif
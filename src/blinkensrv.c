@@ -17,9 +17,12 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
  */
 #include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
 #include "main.h"
 #include "FreeRTOS.h"
 #include "task.h"
+#include "queue.h"
 #include "semphr.h"
 #include "lwip/api.h"
 #include "lwip/tcpip.h"
@@ -31,6 +34,10 @@
 
 #include "blinkensrv.h"
 #include "blinken.h"
+#include "assets.h"
+#include "audio.h"
+#include "crc32.h"
+#include "json.h"
 
 #include "flash_api.h"
 #include "device_lock.h"
@@ -44,102 +51,59 @@
 #define MAX_CHANNEL_NUM         13
 
 #define HTTP_PORT   80
-#define HTTP_OK     "HTTP/1.0 200 OK\r\nContent-type: text/html\r\n\r\n"
-#define HTTP_404    "HTTP/1.0 404 Not Found\r\nContent-type: text/html\r\n\r\n"
-#define HTTP_500    "HTTP/1.0 500 Internal Server Error\r\n" \
-                        "Content-type: text/html\r\n\r\n"
+#define HTTP_200    "200 OK"
+#define HTTP_304    "304 Not Modified"
+#define HTTP_400    "400 Bad Request"
+#define HTTP_404    "404 Not Found"
+#define HTTP_413    "413 Request Entity Too Large"
+#define HTTP_500    "500 Internal Server Error"
+#define HTTP_503    "HTTP/1.1 503 Service Unavailable\r\n" \
+                        "Content-Type: text/plain\r\n" \
+                        "Content-Length: 5\r\n" \
+                        "Connection: close\r\n\r\nbusy\n"
+#define HTTP_CONTINUE "HTTP/1.1 100 Continue\r\n\r\n"
+#define MIME_HTML   "text/html"
+#define MIME_TEXT   "text/plain"
+#define MIME_JSON   "application/json"
+#define CRLF        "\r\n"
 #define SHORT_DELAY 10
 
+/* Connections are accepted by the server task and handed to a small pool of
+ * workers, so a slow client only ties up one of them. A worker may need a
+ * page buffer and a config copy from the heap while serving, so only
+ * HTTP_BACKLOG connections may wait for a worker. Beyond that, or with the
+ * heap running low, new connections are turned away with a 503. A client
+ * that sends nothing for HTTP_RECV_TIMEOUT ms is dropped. */
+#define HTTP_WORKERS        2
+#define HTTP_BACKLOG        4
+#define HTTP_MIN_HEAP       (8 * 1024)
+#define HTTP_RECV_TIMEOUT   5000
+#define HTTP_SEND_TIMEOUT   5000
+
+/* Connections stay open for further requests, so the web UI and scripts do
+ * not pay for a new handshake every time. An idle connection holds a worker,
+ * so it is closed after HTTP_IDLE_TIMEOUT ms without a new request and after
+ * HTTP_MAX_REQUESTS requests. */
+#define HTTP_IDLE_TIMEOUT   2000
+#define HTTP_MAX_REQUESTS   32
+
+/* Responses are collected into segments of HTTP_SEG_SIZE before they are
+ * handed to lwIP. Constant text from HTTP_NOCOPY_MIN bytes on is sent from
+ * where it is instead. */
+#define HTTP_SEG_SIZE       TCP_MSS
+#define HTTP_NOCOPY_MIN     128
+
+#define ARRAY_SIZE(x)   (sizeof(x) / sizeof(*x))
+
 /* HTML code mostly stolen from common/utilities/webserver.c */
 #define HTML_HEAD_START \
 "<html>\
 <head>\
 "
 
+/* style.css and wifi.js are in web/ and served from src/assets.c */
 #define HTML_CSS \
-"<style> \
-body {\
-text-align:center;\
-font-family: 'Segoe UI';\
-}\
-.wrapper {\
-text-align:left;\
-margin:0 auto;\
-margin-top:200px;\
-border:#000;\
-width:500px;\
-}\
-.header {\
-background-color:#CF9;\
-font-size:18px;\
-line-height:50px;\
-text-align:center;\
-}\
-.oneline {\
-width:100%;\
-border-left:#FC3 10px;\
-font-size:15px;\
-height:30px;\
-margin-top:3px;\
-}\
-.left {\
-background-color:#FF0;\
-line-height:30px;\
-height:100%;\
-width:30%;\
-float:left;\
-padding-left:20px;\
-}\
-.right {\
-margin-left:20px;\
-}\
-\
-.box {\
-width:40%;\
-height:28px;\
-margin-left:20px;\
-\
-}\
-\
-.btn {\
-background-color:#CF9;\
-height:40px;\
-text-align:center;\
-}\
-\
-.btn input {\
-font-size:16px;\
-height:30px;\
-width:150px;\
-border:0px;\
-line-height:30px;\
-margin-top:5px;\
-border-radius:20px;\
-background-color:#FFF;\
-}\
-.btn input:hover{\
-cursor:pointer;\
-background-color:#FB4044;\
-}\
-\
-.foot {\
-text-align:center;\
-font-size:15px;\
-line-height:20px;\
-border:#CCC;\
-}\
-#pwd {\
-display:none;\
-}\
-output {\
-background-color:#FF0;\
-line-height:30px;\
-height:100%;\
-width:10%;\
-float:right;\
-padding-left:20px;\
-}\
-</style>"
+"<link rel=\"stylesheet\" href=\"/style.css\">"
 
 #define wifiHTML_TITLE \
 "<title>Realtek SoftAP Config UI</title>"
@@ -166,8 +130,7 @@ Copyright &copy;realtek.com\
 </html>\
 "
 #define wifiHTML_WAIT \
-"HTTP/1.0 200 OK\r\nContent-type: text/html\r\n\r\n\
-<head>\
+"<head>\
 </head>\
 <body>\
 <p>\
@@ -177,47 +140,8 @@ Copyright &copy;realtek.com\
 "</body>\r\n" \
 "</html>"
 
-#define onChangeSecType \
-"<script>\
-function onChangeSecType()\
-{\
-x=document.getElementById(\"sec\");\
-y=document.getElementById(\"pwd\");\
-if(x.value == \"open\"){\
-y.style.display=\"none\";\
-}else{\
-y.style.display=\"block\";\
-}\
-}\
-</script>"
-
-#define onSubmitForm \
-"<script>\
-function onSubmitForm()\
-{\
-x=document.getElementById(\"Ssid\");\
-y=document.getElementById(\"pwd\");\
-z=document.getElementById(\"pwd_val\");\
-if(x.value.length>32)\
-{\
-alert(\"SoftAP SSID is too long!(1-32)\");\
-return false;\
-}\
-/*if(!(/^[A-Za-z0-9]+$/.test(x.value)))\
-{\
-alert(\"SoftAP SSID can only be [A-Za-z0-9]\");\
-return false;\
-}*/\
-if(y.style.display == \"block\")\
-{\
-if((z.value.length < 8)||(z.value.length>32))\
-{\
-alert(\"Password length is between 8 to 32\");\
-return false;\
-}\
-}\
-}\
-</script>"
+#define wifiHTML_SCRIPT \
+"<script src=\"/wifi.js\"></script>"
 
 #define ledHTML_TITLE \
 "<title>Blinkenlights Config UI</title>"
@@ -286,6 +210,11 @@ static void load_wifi_cfg()
 
     device_mutex_unlock(RT_DEV_LOCK_FLASH);
 
+    if(result != 1){
+        printf("[%s] Flash read failed\n", __func__);
+        return;
+    }
+
 #if 0
     printf("[%s] local_config.boot_mode=0x%x\n", __func__,
             local_config.boot_mode);
@@ -402,9 +331,317 @@ static void restart_soft_ap()
             strlen((char* )wifi_setting.password), wifi_setting.channel);
 }
 
-static int add_ssid_item(char *pbuf, size_t buf_len, u8_t *ssid, u8_t ssid_len)
+/* One client connection. Requests are collected in buf, anything the client
+ * pipelined behind the current request stays there for the next round. Data
+ * that does not fit yet is kept in rx until there is room. Responses are
+ * collected in seg and handed to lwIP a segment at a time. */
+struct http_conn
+{
+    struct netconn *conn;
+    struct netbuf *rx;
+    uint16_t rx_off;
+    char *buf;
+    size_t len;
+    size_t used;
+    char *body;
+    size_t body_len;
+    unsigned int requests;
+    char *seg;
+    size_t seg_len;
+    bool keep_alive;
+    bool counting;
+    size_t resp_len;
+};
+
+/* Writes page content for http_respond(). It is called twice, first to add
+ * up the Content-Length and then to send, and must produce the same output
+ * both times. */
+typedef int (*http_body_fn)(struct http_conn *hc, void *arg);
+
+static err_t http_send(struct http_conn *hc, const void *data, size_t len,
+                       u8_t flags)
+{
+    err_t status;
+
+    status = netconn_write(hc->conn, data, len, flags);
+    if(status != ERR_OK){
+        printf("[%s] %s\n", __func__, lwip_strerr(status));
+        hc->keep_alive = false;
+    }
+
+    return status;
+}
+
+/* Hand the collected data to lwIP. With more set, the response goes on. */
+static err_t http_flush(struct http_conn *hc, bool more)
+{
+    err_t status;
+
+    status = ERR_OK;
+    if(hc->seg_len > 0){
+        status = http_send(hc, hc->seg, hc->seg_len,
+                           NETCONN_COPY | (more ? NETCONN_MORE : 0));
+        hc->seg_len = 0;
+    }
+
+    return status;
+}
+
+static err_t http_write(struct http_conn *hc, const void *data, size_t len)
+{
+    const char *pos;
+    size_t chunk;
+    err_t status;
+
+    if(hc->counting){
+        hc->resp_len += len;
+        return ERR_OK;
+    }
+
+    pos = (const char *) data;
+    while(len > 0){
+        chunk = min(len, HTTP_SEG_SIZE - hc->seg_len);
+        memcpy(hc->seg + hc->seg_len, pos, chunk);
+        hc->seg_len += chunk;
+        pos += chunk;
+        len -= chunk;
+
+        if(hc->seg_len == HTTP_SEG_SIZE){
+            status = http_flush(hc, true);
+            if(status != ERR_OK){
+                return status;
+            }
+        }
+    }
+
+    return ERR_OK;
+}
+
+/* For constant data only. Longer pieces are not copied, lwIP sends straight
+ * from data until the client acknowledged it. */
+static err_t http_write_static(struct http_conn *hc, const void *data,
+                               size_t len)
+{
+    err_t status;
+
+    if(hc->counting || len < HTTP_NOCOPY_MIN){
+        return http_write(hc, data, len);
+    }
+
+    status = http_flush(hc, true);
+    if(status != ERR_OK){
+        return status;
+    }
+
+    return http_send(hc, data, len, NETCONN_NOCOPY | NETCONN_MORE);
+}
+
+/* Format straight into the segment buffer, sending what is already there if
+ * the result does not fit behind it. A single result must fit a segment. */
+static err_t http_printf(struct http_conn *hc, const char *fmt, ...)
 {
+    va_list ap;
+    size_t left;
     int written;
+    err_t status;
+
+    /* while counting, the buffer is not in use */
+    left = hc->counting ? HTTP_SEG_SIZE : HTTP_SEG_SIZE - hc->seg_len;
+
+    va_start(ap, fmt);
+    written = vsnprintf(hc->seg + HTTP_SEG_SIZE - left, left, fmt, ap);
+    va_end(ap);
+
+    if(written >= 0 && written >= left && left < HTTP_SEG_SIZE){
+        status = http_flush(hc, true);
+        if(status != ERR_OK){
+            return status;
+        }
+
+        left = HTTP_SEG_SIZE;
+        va_start(ap, fmt);
+        written = vsnprintf(hc->seg, left, fmt, ap);
+        va_end(ap);
+    }
+
+    if(written < 0 || written >= left){
+        printf("[%s] output does not fit\n", __func__);
+        hc->keep_alive = false;
+        return ERR_VAL;
+    }
+
+    if(hc->counting){
+        hc->resp_len += written;
+    }else{
+        hc->seg_len += written;
+    }
+
+    return ERR_OK;
+}
+
+/* extra holds additional header lines, each ending in CRLF */
+static err_t http_head(struct http_conn *hc, const char *status,
+                       const char *type, const char *extra, size_t len)
+{
+    return http_printf(hc, "HTTP/1.1 %s\r\nContent-Type: %s\r\n%s"
+                           "Content-Length: %u\r\nConnection: %s\r\n\r\n",
+                       status, type, extra, (unsigned int) len,
+                       hc->keep_alive ? "keep-alive" : "close");
+}
+
+static int http_reply(struct http_conn *hc, const char *status,
+                      const char *type, const void *data, size_t len)
+{
+    if(http_head(hc, status, type, "", len) != ERR_OK){
+        return -1;
+    }
+
+    if(len > 0 && http_write(hc, data, len) != ERR_OK){
+        return -1;
+    }
+
+    if(http_flush(hc, false) != ERR_OK){
+        return -1;
+    }
+
+    return 0;
+}
+
+static int http_respond(struct http_conn *hc, const char *status,
+                        const char *type, const char *extra,
+                        http_body_fn body, void *arg)
+{
+    int result;
+
+    hc->counting = true;
+    hc->resp_len = 0;
+    result = body(hc, arg);
+    hc->counting = false;
+
+    if(result != 0){
+        return http_reply(hc, HTTP_500, MIME_TEXT, "error\n",
+                          strlen("error\n"));
+    }
+
+    if(http_head(hc, status, type, extra, hc->resp_len) != ERR_OK){
+        return -1;
+    }
+
+    result = body(hc, arg);
+    if(result != 0){
+        /* the announced length is off now */
+        hc->keep_alive = false;
+    }
+
+    if(http_flush(hc, false) != ERR_OK){
+        result = -1;
+    }
+
+    return result;
+}
+
+/* Look up a header of the current request, hdr_end points behind the empty
+ * line. Returns the start of the value, which is not NUL-terminated. */
+static char *http_header(struct http_conn *hc, char *hdr_end,
+                         const char *name)
+{
+    char *line;
+    size_t len;
+
+    len = strlen(name);
+    line = strstr(hc->buf, CRLF);
+    while(line != NULL && line + 2 < hdr_end){
+        line += 2;
+        if(!strncasecmp(line, name, len) && line[len] == ':'){
+            line += len + 1;
+            while(*line == ' ' || *line == '\t'){
+                ++line;
+            }
+
+            return line;
+        }
+
+        line = strstr(line, CRLF);
+    }
+
+    return NULL;
+}
+
+/* Pages and assets carry an ETag, so browsers and polling scripts can ask
+ * whether anything changed instead of fetching them again. They are asked
+ * to always do that. */
+#define ETAG_SIZE       24
+#define ETAG_HEADERS    "ETag: %s\r\nCache-Control: no-cache\r\n"
+
+/* If-None-Match is either "*" or a list of entity-tags. They are compared
+ * weakly as for GET, W/ prefixes are skipped over. */
+static bool http_etag_match(struct http_conn *hc, const char *etag)
+{
+    char *value, *end, *tag;
+    size_t len;
+
+    value = http_header(hc, hc->body, "If-None-Match");
+    if(value == NULL){
+        return false;
+    }
+
+    end = strstr(value, CRLF);
+    if(end == NULL){
+        return false;
+    }
+
+    while(end > value && (end[-1] == ' ' || end[-1] == '\t')){
+        --end;
+    }
+
+    if(end - value == 1 && *value == '*'){
+        return true;
+    }
+
+    len = strlen(etag);
+    while(value < end){
+        if(*value == ' ' || *value == '\t' || *value == ','){
+            ++value;
+            continue;
+        }
+
+        if(end - value > 2 && !strncmp(value, "W/", 2)){
+            value += 2;
+        }
+
+        /* give up on anything that is not a quoted tag */
+        if(*value != '"'){
+            return false;
+        }
+
+        tag = value;
+        value = memchr(value + 1, '"', end - value - 1);
+        if(value == NULL){
+            return false;
+        }
+
+        ++value;
+        if((size_t) (value - tag) == len && !strncmp(tag, etag, len)){
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static int http_not_modified(struct http_conn *hc, const char *etag)
+{
+    if(http_printf(hc, "HTTP/1.1 " HTTP_304 "\r\n" ETAG_HEADERS
+                       "Connection: %s\r\n\r\n",
+                   etag, hc->keep_alive ? "keep-alive" : "close") != ERR_OK){
+        return -1;
+    }
+
+    return http_flush(hc, false) == ERR_OK ? 0 : -1;
+}
+
+static err_t add_ssid_item(struct http_conn *hc, u8_t *ssid, u8_t ssid_len)
+{
     char local_ssid[MAX_SOFTAP_SSID_LEN + 1];
 
     if(ssid_len > MAX_SOFTAP_SSID_LEN){
@@ -414,20 +651,16 @@ static int add_ssid_item(char *pbuf, size_t buf_len, u8_t *ssid, u8_t ssid_len)
     memcpy(local_ssid, ssid, ssid_len);
     local_ssid[ssid_len] = '\0';
 
-    written =
-        snprintf(pbuf, buf_len,
+    return http_printf(hc,
                  "<div class=\"oneline\"><div class=\"left\">SoftAP SSID:</div>"
                  "<div class=\"right\">"
                  "<input class=\"box\" type=\"text\" name=\"Ssid\" id=\"Ssid\""
                  " value=\"%s\"></div></div>",
                  local_ssid);
-
-    return written;
 }
 
-static int add_sec_type_item(char *pbuf, size_t buf_len, u32_t sectype)
+static err_t add_sec_type_item(struct http_conn *hc, u32_t sectype)
 {
-    int written;
     u8_t flag[2] = { 0, 0 };
 
     if(sectype == RTW_SECURITY_OPEN){
@@ -435,11 +668,10 @@ static int add_sec_type_item(char *pbuf, size_t buf_len, u32_t sectype)
     }else if(sectype == RTW_SECURITY_WPA2_AES_PSK){
         flag[1] = 1;
     }else{
-        return -1;
+        return ERR_VAL;
     }
 
-    written =
-        snprintf(pbuf, buf_len,
+    return http_printf(hc,
                 "<div class=\"oneline\"><div class=\"left\">"
                 "Security Type: </div><div class=\"right\">"
                 "<select  class=\"box\" name=\"Security Type\"  id=\"sec\" "
@@ -449,14 +681,11 @@ static int add_sec_type_item(char *pbuf, size_t buf_len, u32_t sectype)
                 "</select></div></div>",
                 flag[0] ? "selected" : "",
                 flag[1] ? "selected" : "");
-
-    return written;
 }
 
-static int add_passwd_item(char *pbuf, size_t buf_len, u8_t *password,
+static err_t add_passwd_item(struct http_conn *hc, u8_t *password,
         u8_t passwd_len)
 {
-    int written;
     char local_passwd[MAX_PASSWORD_LEN + 1];
 
     if(passwd_len > MAX_PASSWORD_LEN){
@@ -468,21 +697,17 @@ static int add_passwd_item(char *pbuf, size_t buf_len, u8_t *password,
         local_passwd[passwd_len] = '\0';
     }
 
-    written =
-        snprintf(pbuf, buf_len,
+    return http_printf(hc,
                  "<div class=\"oneline\" id=\"pwd\"><div class=\"left\">"
                  "Password: </div>"
                  "<div class=\"right\" >"
                  "<input  class=\"box\" id=\"pwd_val\" type=\"text\" "
                  "name=\"Password\" value=\"%s\" ></div></div>",
                  passwd_len ? local_passwd : "");
-
-    return written;
 }
 
-static int add_channel_item(char *pbuf, size_t buf_len, u8_t channel)
+static err_t add_channel_item(struct http_conn *hc, u8_t channel)
 {
-    int written;
     u8_t flag[MAX_CHANNEL_NUM + 1] = { 0 };
 
     if(channel > MAX_CHANNEL_NUM){
@@ -492,8 +717,7 @@ static int add_channel_item(char *pbuf, size_t buf_len, u8_t channel)
 
     flag[channel] = 1;
 
-    written =
-        snprintf(pbuf, buf_len,
+    return http_printf(hc,
                 "<div class=\"oneline\"><div class=\"left\">Channel: </div>"
                 "<div class=\"right\"><select  class=\"box\" name=\"Channel\">"
                 "<option value=\"1\" %s>1</option>"
@@ -514,342 +738,808 @@ static int add_channel_item(char *pbuf, size_t buf_len, u8_t channel)
                 flag[7] ? "selected" : "", flag[8] ? "selected" : "",
                 flag[9] ? "selected" : "", flag[10] ? "selected" : "",
                 flag[11] ? "selected" : "");
-
-    return written;
 }
 
-static int add_range_item(char *pbuf, size_t buf_left, char *name,
-                          char *desc, int min, int max, int step, int val)
+#define RANGE_ITEM \
+    "<div class=\"oneline\">" \
+    "<div class=\"left\">%s:</div>" \
+    "<div class=\"right\">" \
+    "<input class=\"box\" " \
+    "oninput=\"%s_out.value=parseInt(%s_in.value)\" " \
+    "type=\"range\" name=\"%s_in\" id=\"%s_in\" min=\"%u\" " \
+    "max=\"%u\" value=\"%u\">" \
+    "<output class=\"out\" name=\"%s_out\" " \
+    "for=\"%s_in\">%u</output>" \
+    "</div></div>"
+
+enum page_item_type
 {
-    int written;
+    item_text, item_range
+};
+
+/* A page is a list of constant text and sliders for config values. The
+ * value of a slider is found at offset in struct blinken_cfg, all of them
+ * are uint32_t. */
+struct page_item
+{
+    enum page_item_type type;
+    const char *name;
+    const char *desc;
+    uint32_t min;
+    uint32_t max;
+    uint16_t offset;
+};
 
-    written =
-        snprintf(pbuf, buf_left,
-                "<div class=\"oneline\">"
-                "<div class=\"left\">%s:</div>"
-                "<div class=\"right\">"
-                "<input class=\"box\" "
-                "oninput=\"%s_out.value=parseInt(%s_in.value)\" "
-                "type=\"range\" name=\"%s_in\" id=\"%s_in\" min=\"%d\" "
-                "max=\"%d\" value=\"%d\">"
-                "<output class=\"out\" name=\"%s_out\" "
-                "for=\"%s_in\">%d</output>"
-                "</div></div>",
-                desc, name, name, name, name, min, max, val, name, name, val);
+#define PAGE_TEXT(text) \
+    { .type = item_text, .name = (text) }
+
+#define PAGE_RANGE(_name, _desc, _min, _max, field) \
+    { .type = item_range, .name = (_name), .desc = (_desc), \
+      .min = (_min), .max = (_max), \
+      .offset = offsetof(struct blinken_cfg, field) }
+
+static const struct page_item led_page[] = {
+    PAGE_TEXT(HTML_HEAD_START HTML_CSS ledHTML_TITLE ledHTML_BODY_START
+              "<p>Strip Config</p>"),
+    PAGE_RANGE("strip_len", "Strip length", 0, BLINKEN_MAX_LEDS, strip_len),
+    PAGE_RANGE("delay", "Update delay", 0, 100, delay),
+    PAGE_TEXT("<p>Rainbow Config</p>"),
+    PAGE_RANGE("hue_min", "Min. Hue", 0, 255, rainbow.hue_min),
+    PAGE_RANGE("hue_max", "Max. Hue", 0, 255, rainbow.hue_max),
+    PAGE_RANGE("hue_steps", "Hue Steps", 0, BLINKEN_MAX_STEPS,
+               rainbow.hue_steps),
+    PAGE_RANGE("cycle_steps", "Cycle Steps", 0, BLINKEN_MAX_STEPS,
+               rainbow.cycle_steps),
+    PAGE_TEXT("<p>Fade Config</p>"),
+    PAGE_RANGE("fade_min", "Min.", 0, 255, fade.min),
+    PAGE_RANGE("fade_max", "Max.", 0, 255, fade.max),
+    PAGE_RANGE("fade_steps", "Step", 0, BLINKEN_MAX_STEPS, fade.steps),
+    PAGE_TEXT("<p>Eye Config</p>"),
+    PAGE_RANGE("eye_rate", "Rate", 0, 20, eye.rate),
+    PAGE_TEXT(ledHTML_END),
+};
 
-    return written;
-}
+/* The page's tag combines the config generation with a checksum over the
+ * template, which changes with the firmware. */
+static uint32_t page_tag = 0;
 
-static int add_maincfg_item(char *pbuf, size_t buf_left,
-        struct blinken_cfg *led_cfg)
+static uint32_t page_crc(const struct page_item *items, unsigned int num)
 {
-    int written, total;
-
-    total = 0;
+    uint32_t crc;
+    unsigned int i;
 
-    written = snprintf(pbuf, buf_left, "<p>Strip Config</p>");
-    if(written < 0 || written >= buf_left){
-        total = -1;
-        goto err_out;
+    crc = crc32_update(0, RANGE_ITEM, strlen(RANGE_ITEM));
+    for(i = 0; i < num; ++i){
+        crc = crc32_update(crc, items[i].name, strlen(items[i].name));
+        if(items[i].type == item_range){
+            crc = crc32_update(crc, items[i].desc, strlen(items[i].desc));
+            crc = crc32_update(crc, &items[i].min, sizeof(items[i].min));
+            crc = crc32_update(crc, &items[i].max, sizeof(items[i].max));
+        }
     }
-    pbuf += written;
-    buf_left -= written;
-    total += written;
 
-    written = add_range_item(pbuf, buf_left, "strip_len", "Strip length",
-                             0, BLINKEN_MAX_LEDS, 1, led_cfg->strip_len);
+    return crc;
+}
 
-    if(written < 0 || written >= buf_left){
-        total = -1;
-        goto err_out;
-    }
-    pbuf += written;
-    buf_left -= written;
-    total += written;
+struct page_args
+{
+    const struct page_item *items;
+    unsigned int num;
+    const uint32_t *values;
+};
 
-    written = add_range_item(pbuf, buf_left, "delay", "Update delay",
-                             0, 100, 1, led_cfg->delay);
+static int render_page(struct http_conn *hc, void *arg)
+{
+    const struct page_args *page;
+    const struct page_item *item;
+    unsigned int i;
+    err_t status;
 
-    if(written < 0 || written >= buf_left){
-        total = -1;
-        goto err_out;
+    page = (const struct page_args *) arg;
+
+    for(i = 0; i < page->num; ++i){
+        item = &page->items[i];
+
+        switch(item->type){
+        case item_text:
+            status = http_write_static(hc, item->name, strlen(item->name));
+            break;
+        case item_range:
+            status = http_printf(hc, RANGE_ITEM, item->desc, item->name,
+                                 item->name, item->name, item->name,
+                                 (unsigned int) item->min,
+                                 (unsigned int) item->max,
+                                 (unsigned int) page->values[i],
+                                 item->name, item->name,
+                                 (unsigned int) page->values[i]);
+            break;
+        default:
+            status = ERR_VAL;
+            break;
+        }
+
+        if(status != ERR_OK){
+            return -1;
+        }
     }
-    pbuf += written;
-    buf_left -= written;
-    total += written;
 
-err_out:
-    return total;
+    return 0;
 }
 
-static int add_rainbow_item(char *pbuf, size_t buf_left,
-        struct blinken_cfg *led_cfg)
+/* A GET is answered with a 304 if the client has the current page, before
+ * anything is read from the config. */
+static int send_blinken_html(struct http_conn *hc, bool conditional)
 {
-    int written, total;
+    uint16_t offsets[ARRAY_SIZE(led_page)];
+    uint32_t values[ARRAY_SIZE(led_page)];
+    struct page_args page;
+    char etag[ETAG_SIZE];
+    char extra[ETAG_SIZE + sizeof(ETAG_HEADERS)];
+    uint32_t generation;
+    unsigned int i;
+    int result;
 
-    total = 0;
+    if(conditional){
+        snprintf(etag, sizeof(etag), "\"%08x.%08x\"",
+                 (unsigned int) page_tag,
+                 (unsigned int) blinken_get_config_generation());
 
-    written = snprintf(pbuf, buf_left, "<p>Rainbow Config</p>");
-    if(written < 0 || written >= buf_left){
-        total = -1;
-        goto err_out;
+        if(http_etag_match(hc, etag)){
+            return http_not_modified(hc, etag);
+        }
     }
-    pbuf += written;
-    buf_left -= written;
-    total += written;
-
-    written = add_range_item(pbuf, buf_left, "hue_min", "Min. Hue",
-                             0, 255, 1, led_cfg->rainbow.hue_min);
 
-    if(written < 0 || written >= buf_left){
-        total = -1;
-        goto err_out;
+    /* both passes of the page need to see the same values */
+    for(i = 0; i < ARRAY_SIZE(led_page); ++i){
+        offsets[i] = led_page[i].offset;
     }
-    pbuf += written;
-    buf_left -= written;
-    total += written;
-
-    written = add_range_item(pbuf, buf_left, "hue_max", "Max. Hue",
-                             0, 255, 1, led_cfg->rainbow.hue_max);
 
-    if(written < 0 || written >= buf_left){
-        total = -1;
+    result = blinken_get_config_values(offsets, ARRAY_SIZE(led_page), values,
+                                       &generation);
+    if(result != 0){
+        printf("[%s] LED config read failed\n", __func__);
+        http_reply(hc, HTTP_500, MIME_TEXT, "error\n", strlen("error\n"));
         goto err_out;
     }
-    pbuf += written;
-    buf_left -= written;
-    total += written;
 
-    written = add_range_item(pbuf, buf_left, "hue_steps", "Hue Steps",
-                             0, BLINKEN_MAX_STEPS, 1,
-                             led_cfg->rainbow.hue_steps);
+    snprintf(etag, sizeof(etag), "\"%08x.%08x\"",
+             (unsigned int) page_tag, (unsigned int) generation);
+    snprintf(extra, sizeof(extra), ETAG_HEADERS, etag);
 
-    if(written < 0 || written >= buf_left){
-        total = -1;
-        goto err_out;
-    }
-    pbuf += written;
-    buf_left -= written;
-    total += written;
+    page.items = led_page;
+    page.num = ARRAY_SIZE(led_page);
+    page.values = values;
 
-    written = add_range_item(pbuf, buf_left, "cycle_steps", "Cycle Steps", 0,
-            BLINKEN_MAX_STEPS, 1, led_cfg->rainbow.cycle_steps);
-    if(written < 0 || written >= buf_left){
-        total = -1;
-        goto err_out;
-    }
-    pbuf += written;
-    buf_left -= written;
-    total += written;
+    result = http_respond(hc, HTTP_200, MIME_HTML, extra, render_page, &page);
 
 err_out:
-    return total;
+    return result;
 }
 
-static int add_fade_item(char *pbuf, size_t buf_left,
-        struct blinken_cfg *led_cfg)
+/* Config values for the JSON API at /api/config. A name is the value's path
+ * in the JSON object, the values of one object have to follow each other.
+ * Limits are checked per value, anything involving more than one value is
+ * left to the render task's sanity checks. */
+enum api_kind
 {
-    int written, total;
+    api_unsigned, api_signed, api_mask
+};
 
-    total = 0;
+/* a mask's allowed bits are kept in max */
+struct api_field
+{
+    const char *name;
+    int32_t min;
+    int32_t max;
+    uint16_t offset;
+    enum api_kind kind;
+};
 
-    written = snprintf(pbuf, buf_left, "<p>Fade Config</p>");
-    if(written < 0 || written >= buf_left){
-        total = -1;
-        goto err_out;
-    }
-    pbuf += written;
-    buf_left -= written;
-    total += written;
+#define API_FIELD(_name, field, _min, _max) \
+    { .name = (_name), .min = (_min), .max = (_max), \
+      .offset = offsetof(struct blinken_cfg, field), .kind = api_unsigned }
+
+#define API_SIGNED(_name, field, _min, _max) \
+    { .name = (_name), .min = (_min), .max = (_max), \
+      .offset = offsetof(struct blinken_cfg, field), .kind = api_signed }
+
+#define API_MASK(_name, field, allowed) \
+    { .name = (_name), .min = 0, .max = (allowed), \
+      .offset = offsetof(struct blinken_cfg, field), .kind = api_mask }
+
+/* effects of zone 0, with sect empty, or of another zone */
+#define API_EFFECTS(prefix, sect) \
+    API_FIELD(prefix "rainbow.hue_min", sect rainbow.hue_min, 0, 255), \
+    API_FIELD(prefix "rainbow.hue_max", sect rainbow.hue_max, 0, 255), \
+    API_FIELD(prefix "rainbow.hue_steps", sect rainbow.hue_steps, \
+              0, BLINKEN_MAX_STEPS), \
+    API_FIELD(prefix "rainbow.cycle_steps", sect rainbow.cycle_steps, \
+              0, BLINKEN_MAX_STEPS), \
+    API_FIELD(prefix "fade.min", sect fade.min, 0, 255), \
+    API_FIELD(prefix "fade.max", sect fade.max, 0, 255), \
+    API_FIELD(prefix "fade.steps", sect fade.steps, 0, BLINKEN_MAX_STEPS), \
+    API_FIELD(prefix "flicker.rate", sect flicker.rate, 0, 100), \
+    API_FIELD(prefix "eye.rate", sect eye.rate, 0, 20)
+
+#define API_LAYER(n) \
+    API_FIELD("layer" #n ".mode", layers[n - 1].mode, 0, blend_last - 1), \
+    API_FIELD("layer" #n ".opacity", layers[n - 1].opacity, 0, 255), \
+    API_MASK("layer" #n ".filters", layers[n - 1].filters, LAYER_FILTER_ALL)
+
+#define API_ZONE(n) \
+    API_FIELD("zone" #n ".offset", zones[n - 1].offset, \
+              0, BLINKEN_MAX_LEDS), \
+    API_FIELD("zone" #n ".len", zones[n - 1].len, 0, BLINKEN_MAX_LEDS), \
+    API_MASK("zone" #n ".filters", zones[n - 1].filters, ZONE_FILTER_ALL), \
+    API_EFFECTS("zone" #n ".", zones[n - 1].)
+
+static const struct api_field api_fields[] = {
+    API_FIELD("strip_len", strip_len, 1, BLINKEN_MAX_LEDS),
+    API_FIELD("delay", delay, 0, 100),
+    API_FIELD("brightness", brightness, 0, 255),
+    API_MASK("filters", filters, ZONE_FILTER_ALL),
+    API_EFFECTS("", ),
+    API_LAYER(1),
+    API_LAYER(2),
+    API_ZONE(1),
+    API_ZONE(2),
+    API_ZONE(3),
+    API_FIELD("particles.mode", particles.mode, 0, particle_last - 1),
+    API_FIELD("particles.rate", particles.rate, 0, 1000),
+    API_FIELD("particles.speed", particles.speed, 0, BLINKEN_MAX_LEDS),
+    API_FIELD("particles.life", particles.life, 1, UINT16_MAX),
+    API_FIELD("particles.hue", particles.hue, 0, 255),
+    API_SIGNED("particles.gravity", particles.gravity, -1000, 1000),
+    API_FIELD("particles.decay", particles.decay, 0, 2550),
+    API_FIELD("noise.scale", noise.scale, 0, scale_up(4)),
+    API_FIELD("noise.speed", noise.speed, 0, scale_up(100)),
+    API_FIELD("noise.hue_min", noise.hue_min, 0, 255),
+    API_FIELD("noise.hue_max", noise.hue_max, 0, 255),
+    API_FIELD("noise.val_min", noise.val_min, 0, 255),
+    API_FIELD("palette.enabled", palette.enabled, 0, 1),
+    API_FIELD("palette.hue_min", palette.hue_min, 0, 255),
+    API_FIELD("palette.hue_max", palette.hue_max, 0, 255),
+    API_FIELD("palette.saturation", palette.saturation, 0, 255),
+    API_FIELD("palette.value", palette.value, 0, 255),
+    API_FIELD("palette.repeat", palette.repeat, 1, BLINKEN_MAX_REPEAT),
+    API_SIGNED("palette.rotate", palette.rotate,
+               -scale_up(1000), scale_up(1000)),
+    API_FIELD("vm.budget", vm.budget, 1, VM_BUDGET_MAX),
+    API_FIELD("audio.enabled", audio.enabled, 0, 1),
+    API_FIELD("audio.threshold", audio.threshold,
+              AUDIO_THRESHOLD_MIN, AUDIO_THRESHOLD_MAX),
+    API_FIELD("audio.fade_depth", audio.fade_depth, 0, 255),
+    API_FIELD("audio.speed_depth", audio.speed_depth, 0, 255),
+    API_FIELD("sprites.count", sprites.count, 0, BLINKEN_MAX_SPRITES),
+    API_FIELD("sprites.mode", sprites.mode, 0, sprite_last - 1),
+    API_FIELD("sprites.shape", sprites.shape, 0, shape_last - 1),
+    API_FIELD("sprites.size", sprites.size, 1, BLINKEN_MAX_SPRITE_SIZE),
+    API_FIELD("sprites.speed", sprites.speed, 0, BLINKEN_MAX_LEDS),
+    API_FIELD("sprites.hue", sprites.hue, 0, 255),
+    API_FIELD("sprites.hue_step", sprites.hue_step, 0, 255),
+    API_FIELD("sprites.value", sprites.value, 0, 255),
+};
 
-    written = add_range_item(pbuf, buf_left, "fade_min", "Min.",
-                             0, 255, 1, led_cfg->fade.min);
+#define API_NUM_FIELDS  ARRAY_SIZE(api_fields)
+#define API_NAME_SIZE   32
+#define API_MAX_DEPTH   4
+#define API_MAX_ERRORS  8
 
-    if(written < 0 || written >= buf_left){
-        total = -1;
-        goto err_out;
-    }
-    pbuf += written;
-    buf_left -= written;
-    total += written;
+/* like page_tag, for the field table */
+static uint32_t api_tag = 0;
 
-    written = add_range_item(pbuf, buf_left, "fade_max", "Max.",
-                             0, 255, 1, led_cfg->fade.max);
+static uint32_t api_crc(void)
+{
+    uint32_t crc;
+    unsigned int i;
 
-    if(written < 0 || written >= buf_left){
-        total = -1;
-        goto err_out;
+    crc = 0;
+    for(i = 0; i < API_NUM_FIELDS; ++i){
+        crc = crc32_update(crc, api_fields[i].name,
+                           strlen(api_fields[i].name));
+        crc = crc32_update(crc, &api_fields[i].min, sizeof(api_fields[i].min));
+        crc = crc32_update(crc, &api_fields[i].max, sizeof(api_fields[i].max));
+        crc = crc32_update(crc, &api_fields[i].kind,
+                           sizeof(api_fields[i].kind));
     }
-    pbuf += written;
-    buf_left -= written;
-    total += written;
 
-    written = add_range_item(pbuf, buf_left, "fade_steps", "Step",
-                             0, BLINKEN_MAX_STEPS, 1, led_cfg->fade.steps);
+    return crc;
+}
+
+/* number of objects a name is nested in */
+static unsigned int api_depth(const char *name)
+{
+    unsigned int depth;
 
-    if(written < 0 || written >= buf_left){
-        total = -1;
-        goto err_out;
+    depth = 0;
+    while(*name != '\0'){
+        if(*name++ == '.'){
+            ++depth;
+        }
     }
-    pbuf += written;
-    buf_left -= written;
-    total += written;
 
-err_out:
-    return total;
+    return depth;
 }
 
-static int add_eye_item(char *pbuf, size_t buf_left,
-        struct blinken_cfg *led_cfg)
+/* number of objects two names share */
+static unsigned int api_common(const char *a, const char *b)
 {
-    int written, total;
+    unsigned int depth;
 
-    total = 0;
+    depth = 0;
+    while(*a != '\0' && *a == *b){
+        if(*a == '.'){
+            ++depth;
+        }
 
-    written = snprintf(pbuf, buf_left, "<p>Eye Config</p>");
-    if(written < 0 || written >= buf_left){
-        total = -1;
-        goto err_out;
+        ++a;
+        ++b;
     }
-    pbuf += written;
-    buf_left -= written;
-    total += written;
 
-    written = add_range_item(pbuf, buf_left, "eye_rate", "Rate",
-                             0, 20, 1, led_cfg->eye.rate);
-    if(written < 0 || written >= buf_left){
-        total = -1;
-        goto err_out;
+    return depth;
+}
+
+/* the object name at depth, up to the next dot */
+static const char *api_section(const char *name, unsigned int depth,
+                               size_t *len)
+{
+    while(depth > 0){
+        if(*name++ == '.'){
+            --depth;
+        }
     }
-    pbuf += written;
-    buf_left -= written;
-    total += written;
 
-err_out:
-    return total;
-}
-
-#define handle_html_buff    \
-    do{ \
-        if(written < 0 || written >= MAX_PAGE_SIZE){    \
-            result = -1;    \
-            goto err_out;   \
-        }   \
-        status = netconn_write(conn, html_buff, (u16_t) strlen(html_buff), \
-                                   NETCONN_COPY);   \
-        if(status != ERR_OK){   \
-            printf("[%s] %s\n", __func__, lwip_strerr(status)); \
-            result = -1;    \
-            goto err_out;   \
-        }   \
-    }while(0)
-
-static int send_blinken_html(struct netconn *conn)
-{
-    char *html_buff;
-    int written;
-    struct blinken_cfg *led_cfg;
-    err_t status;
-    int result;
+    *len = strchr(name, '.') - name;
 
-    result = 0;
-    html_buff = NULL;
-    led_cfg = NULL;
+    return name;
+}
 
-    html_buff = malloc(MAX_PAGE_SIZE);
-    if(html_buff == NULL){
-        printf("[%s] malloc failed\n", __func__);
+struct api_values
+{
+    uint16_t offsets[API_NUM_FIELDS];
+    uint32_t values[API_NUM_FIELDS];
+    uint32_t generation;
+};
+
+/* The table is flat, objects are opened and closed where the path of one
+ * value differs from the one before. */
+static int render_api(struct http_conn *hc, void *arg)
+{
+    const struct api_values *cfg;
+    const struct api_field *field;
+    const char *prev, *sect, *leaf;
+    unsigned int i, depth, common;
+    size_t len;
+    bool comma;
+    err_t status;
 
-        netconn_write(conn, HTTP_500, (u16_t) strlen(HTTP_500), NETCONN_COPY);
+    cfg = (const struct api_values *) arg;
+    prev = "";
+    comma = false;
 
-        result = -1;
-        goto err_out;
+    if(http_write(hc, "{", 1) != ERR_OK){
+        return -1;
     }
 
-    memset(html_buff, 0x0, MAX_PAGE_SIZE);
+    for(i = 0; i < API_NUM_FIELDS; ++i){
+        field = &api_fields[i];
+        common = api_common(prev, field->name);
 
-    led_cfg = blinken_get_config();
-    if(led_cfg == NULL){
-        printf("[%s] LED config read failed\n", __func__);
+        for(depth = api_depth(prev); depth > common; --depth){
+            if(http_write(hc, "}", 1) != ERR_OK){
+                return -1;
+            }
+        }
 
-        netconn_write(conn, HTTP_500, (u16_t) strlen(HTTP_500), NETCONN_COPY);
+        for(depth = common; depth < api_depth(field->name); ++depth){
+            sect = api_section(field->name, depth, &len);
+            if((comma && http_write(hc, ",", 1) != ERR_OK)
+                    || http_write(hc, "\"", 1) != ERR_OK
+                    || http_write(hc, sect, len) != ERR_OK
+                    || http_write(hc, "\":{", 3) != ERR_OK){
+                return -1;
+            }
 
-        result = -1;
-        goto err_out;
-    }
+            comma = false;
+        }
 
-    status = netconn_write(conn, HTTP_OK, (u16_t) strlen(HTTP_OK),
-                           NETCONN_COPY);
-    if(status != ERR_OK){
-        printf("[%s] %s\n", __func__, lwip_strerr(status));
-        result = -1;
-        goto err_out;
-    }
+        leaf = strrchr(field->name, '.');
+        leaf = leaf != NULL ? leaf + 1 : field->name;
 
-    status = netconn_write(conn, HTML_HEAD_START,
-                          (u16_t) strlen(HTML_HEAD_START), NETCONN_COPY);
-    if(status != ERR_OK){
-        printf("[%s] %s\n", __func__, lwip_strerr(status));
-        result = -1;
-        goto err_out;
+        if(field->kind == api_signed){
+            status = http_printf(hc, "%s\"%s\":%d", comma ? "," : "", leaf,
+                                 (int) (int32_t) cfg->values[i]);
+        }else{
+            status = http_printf(hc, "%s\"%s\":%u", comma ? "," : "", leaf,
+                                 (unsigned int) cfg->values[i]);
+        }
+
+        if(status != ERR_OK){
+            return -1;
+        }
+
+        comma = true;
+        prev = field->name;
+    }
+
+    for(depth = api_depth(prev); depth > 0; --depth){
+        if(http_write(hc, "}", 1) != ERR_OK){
+            return -1;
+        }
     }
 
-    /* add css */
-    status = netconn_write(conn, HTML_CSS,
-                           (u16_t) strlen(HTML_CSS), NETCONN_COPY);
+    return http_write(hc, "}\n", 2) == ERR_OK ? 0 : -1;
+}
 
-    if(status != ERR_OK){
-        printf("[%s] %s\n", __func__, lwip_strerr(status));
+static int send_api_config(struct http_conn *hc, bool conditional)
+{
+    struct api_values *cfg;
+    char etag[ETAG_SIZE];
+    char extra[ETAG_SIZE + sizeof(ETAG_HEADERS)];
+    unsigned int i;
+    int result;
+
+    cfg = NULL;
+
+    if(conditional){
+        snprintf(etag, sizeof(etag), "\"%08x.%08x\"",
+                 (unsigned int) api_tag,
+                 (unsigned int) blinken_get_config_generation());
+
+        if(http_etag_match(hc, etag)){
+            return http_not_modified(hc, etag);
+        }
+    }
+
+    /* too large for the worker's stack */
+    cfg = malloc(sizeof(*cfg));
+    if(cfg == NULL){
+        printf("[%s] malloc failed\n", __func__);
         result = -1;
+        http_reply(hc, HTTP_500, MIME_TEXT, "error\n", strlen("error\n"));
         goto err_out;
     }
 
-    status = netconn_write(conn, ledHTML_TITLE,
-                          (u16_t) strlen(ledHTML_TITLE), NETCONN_COPY);
+    for(i = 0; i < API_NUM_FIELDS; ++i){
+        cfg->offsets[i] = api_fields[i].offset;
+    }
 
-    if(status != ERR_OK){
-        printf("[%s] %s\n", __func__, lwip_strerr(status));
-        result = -1;
+    result = blinken_get_config_values(cfg->offsets, API_NUM_FIELDS,
+                                       cfg->values, &cfg->generation);
+    if(result != 0){
+        printf("[%s] config read failed\n", __func__);
+        http_reply(hc, HTTP_500, MIME_TEXT, "error\n", strlen("error\n"));
         goto err_out;
     }
 
-    status = netconn_write(conn, ledHTML_BODY_START,
-                           (u16_t) strlen(ledHTML_BODY_START), NETCONN_COPY);
+    snprintf(etag, sizeof(etag), "\"%08x.%08x\"",
+             (unsigned int) api_tag, (unsigned int) cfg->generation);
+    snprintf(extra, sizeof(extra), ETAG_HEADERS, etag);
 
-    if(status != ERR_OK){
-        printf("[%s] %s\n", __func__, lwip_strerr(status));
-        result = -1;
+    result = http_respond(hc, HTTP_200, MIME_JSON, extra, render_api, cfg);
+
+err_out:
+    if(cfg != NULL){
+        free(cfg);
+    }
+
+    return result;
+}
+
+struct api_error
+{
+    char field[API_NAME_SIZE];
+    const char *msg;
+    const struct api_field *limits;     // for range and mask errors
+    int offset;                         // for syntax errors, else -1
+};
+
+/* State of one PUT or PATCH. path holds the name of the current value,
+ * sect_len the length of its object's part for each depth. */
+struct api_update
+{
+    struct json_parser json;
+    char path[API_NAME_SIZE];
+    size_t sect_len[API_MAX_DEPTH + 1];
+    uint32_t seen[(API_NUM_FIELDS + 31) / 32];
+    uint32_t values[API_NUM_FIELDS];
+    uint16_t offsets[API_NUM_FIELDS];
+    unsigned int num_values;
+    unsigned int num_errors;
+    struct api_error errors[API_MAX_ERRORS];
+};
+
+static void api_report(struct api_update *upd, const char *msg,
+                      const struct api_field *limits, int offset)
+{
+    struct api_error *err;
+
+    if(upd->num_errors >= API_MAX_ERRORS){
+        return;
+    }
+
+    err = &upd->errors[upd->num_errors++];
+    strncpy(err->field, upd->path, sizeof(err->field) - 1);
+    err->field[sizeof(err->field) - 1] = '\0';
+    err->msg = msg;
+    err->limits = limits;
+    err->offset = offset;
+}
+
+/* exact match for values, any field below it for objects */
+static const struct api_field *api_lookup(const char *path, bool object,
+                                          unsigned int *idx)
+{
+    unsigned int i;
+    size_t len;
+
+    len = strlen(path);
+    for(i = 0; i < API_NUM_FIELDS; ++i){
+        if(object ? !strncmp(api_fields[i].name, path, len)
+                  : !strcmp(api_fields[i].name, path)){
+            *idx = i;
+            return &api_fields[i];
+        }
+    }
+
+    return NULL;
+}
+
+static void api_set(struct api_update *upd, const struct json_token *tok)
+{
+    const struct api_field *field;
+    unsigned int idx;
+    int32_t val;
+
+    field = api_lookup(upd->path, false, &idx);
+    if(field == NULL){
+        api_report(upd, "unknown field", NULL, -1);
+        return;
+    }
+
+    if(json_int(tok, &val) != 0){
+        api_report(upd, "not an integer", NULL, -1);
+        return;
+    }
+
+    if(field->kind == api_mask){
+        if(val < 0 || (val & ~field->max)){
+            api_report(upd, "filter not allowed here", field, -1);
+            return;
+        }
+    }else if(val < field->min || val > field->max){
+        api_report(upd, "out of range", field, -1);
+        return;
+    }
+
+    upd->values[idx] = (uint32_t) val;
+    upd->seen[idx / 32] |= 1u << (idx % 32);
+}
+
+/* One pass over the body, each value is kept by its field. The parse goes
+ * on after invalid values to report all of them at once. */
+static void api_parse(struct api_update *upd, const char *body,
+                      size_t body_len)
+{
+    struct json_token tok;
+    enum json_type type;
+    unsigned int depth, idx;
+    size_t len;
+
+    json_init(&upd->json, body, body_len);
+    upd->path[0] = '\0';
+
+    if(json_next(&upd->json, &tok) != json_obj_start){
+        api_report(upd, "expected an object", NULL, tok.start - body);
+        return;
+    }
+
+    while((type = json_next(&upd->json, &tok)) != json_end){
+        if(type == json_error){
+            api_report(upd, "syntax error", NULL, tok.start - body);
+            return;
+        }
+
+        if(type != json_key){
+            continue;
+        }
+
+        /* The key replaces the last name at this depth. Objects are only
+         * entered if there are fields in them, so the depth is in range.
+         * Longer names are cut, they do not match anything anyway. */
+        depth = upd->json.depth - 1;
+        len = min(tok.len, API_NAME_SIZE - 2 - upd->sect_len[depth]);
+        memcpy(upd->path + upd->sect_len[depth], tok.start, len);
+        upd->path[upd->sect_len[depth] + len] = '\0';
+
+        type = json_next(&upd->json, &tok);
+        switch(type){
+        case json_number:
+            api_set(upd, &tok);
+            break;
+        case json_obj_start:
+            strcat(upd->path, ".");
+            if(depth < API_MAX_DEPTH
+                    && api_lookup(upd->path, true, &idx) != NULL){
+                upd->sect_len[depth + 1] = strlen(upd->path);
+                break;
+            }
+
+            upd->path[strlen(upd->path) - 1] = '\0';
+            api_report(upd, "unknown field", NULL, -1);
+            if(json_skip(&upd->json, &tok) != 0){
+                api_report(upd, "syntax error", NULL,
+                       upd->json.pos - body);
+                return;
+            }
+            break;
+        case json_error:
+            api_report(upd, "syntax error", NULL, tok.start - body);
+            return;
+        default:
+            api_report(upd, "not an integer", NULL, -1);
+            if(json_skip(&upd->json, &tok) != 0){
+                api_report(upd, "syntax error", NULL,
+                       upd->json.pos - body);
+                return;
+            }
+            break;
+        }
+    }
+}
+
+/* a PUT replaces the whole config and has to give all values */
+static void api_check_missing(struct api_update *upd)
+{
+    unsigned int i;
+
+    for(i = 0; i < API_NUM_FIELDS; ++i){
+        if(!(upd->seen[i / 32] & (1u << (i % 32)))){
+            strcpy(upd->path, api_fields[i].name);
+            api_report(upd, "missing", NULL, -1);
+        }
+    }
+}
+
+static int render_api_errors(struct http_conn *hc, void *arg)
+{
+    const struct api_update *upd;
+    const struct api_error *err;
+    unsigned int i;
+    err_t status;
+
+    upd = (const struct api_update *) arg;
+
+    if(http_write(hc, "{\"errors\":[", strlen("{\"errors\":[")) != ERR_OK){
+        return -1;
+    }
+
+    for(i = 0; i < upd->num_errors; ++i){
+        err = &upd->errors[i];
+
+        if(http_printf(hc, "%s{\"field\":\"%s\",\"error\":\"%s\"",
+                       i > 0 ? "," : "", err->field, err->msg) != ERR_OK){
+            return -1;
+        }
+
+        if(err->limits != NULL && err->limits->kind == api_mask){
+            status = http_printf(hc, ",\"allowed\":%d",
+                                 (int) err->limits->max);
+        }else if(err->limits != NULL){
+            status = http_printf(hc, ",\"min\":%d,\"max\":%d",
+                                 (int) err->limits->min,
+                                 (int) err->limits->max);
+        }else{
+            status = ERR_OK;
+        }
+
+        if(status != ERR_OK){
+            return -1;
+        }
+
+        if(err->offset >= 0
+                && http_printf(hc, ",\"offset\":%d", err->offset) != ERR_OK){
+            return -1;
+        }
+
+        if(http_write(hc, "}", 1) != ERR_OK){
+            return -1;
+        }
+    }
+
+    return http_write(hc, "]}\n", 3) == ERR_OK ? 0 : -1;
+}
+
+/* Pack the values given into offsets and values, in table order. */
+static void api_collect(struct api_update *upd)
+{
+    unsigned int i;
+
+    upd->num_values = 0;
+    for(i = 0; i < API_NUM_FIELDS; ++i){
+        if(upd->seen[i / 32] & (1u << (i % 32))){
+            upd->offsets[upd->num_values] = api_fields[i].offset;
+            upd->values[upd->num_values] = upd->values[i];
+            ++upd->num_values;
+        }
+    }
+}
+
+/* A PUT replaces the config with one built from a copy of the running one,
+ * a PATCH only changes the values it gives, under the config lock, so that
+ * concurrent PATCHes of different values do not undo each other. Nothing
+ * is changed if any value is invalid. */
+static int api_update_config(struct http_conn *hc, bool replace)
+{
+    struct api_update *upd;
+    struct blinken_cfg *cfg;
+    unsigned int i;
+    bool changed;
+    int result;
+
+    result = -1;
+    upd = NULL;
+    cfg = NULL;
+
+    upd = calloc(1, sizeof(*upd));
+    if(upd == NULL){
+        printf("[%s] malloc failed\n", __func__);
+        http_reply(hc, HTTP_500, MIME_TEXT, "error\n", strlen("error\n"));
         goto err_out;
     }
 
-    written = add_maincfg_item(html_buff, MAX_PAGE_SIZE, led_cfg);
-    handle_html_buff;
+    api_parse(upd, hc->body, hc->body_len);
+    if(replace && upd->num_errors == 0){
+        api_check_missing(upd);
+    }
 
-    written = add_rainbow_item(html_buff, MAX_PAGE_SIZE, led_cfg);
-    handle_html_buff;
+    if(upd->num_errors > 0){
+        http_respond(hc, HTTP_400, MIME_JSON, "", render_api_errors, upd);
+        goto err_out;
+    }
 
-    written = add_fade_item(html_buff, MAX_PAGE_SIZE, led_cfg);
-    handle_html_buff;
+    api_collect(upd);
 
-    written = add_eye_item(html_buff, MAX_PAGE_SIZE, led_cfg);
-    handle_html_buff;
+    if(replace){
+        cfg = blinken_get_config();
+        if(cfg == NULL){
+            printf("[%s] config read failed\n", __func__);
+            http_reply(hc, HTTP_500, MIME_TEXT, "error\n", strlen("error\n"));
+            goto err_out;
+        }
 
-    status = netconn_write(conn, ledHTML_END, (u16_t) strlen(ledHTML_END),
-                           NETCONN_COPY);
+        changed = false;
+        for(i = 0; i < upd->num_values; ++i){
+            if(memcmp((uint8_t *) cfg + upd->offsets[i], &upd->values[i],
+                      sizeof(upd->values[i]))){
+                memcpy((uint8_t *) cfg + upd->offsets[i], &upd->values[i],
+                       sizeof(upd->values[i]));
+                changed = true;
+            }
+        }
 
-    if(status != ERR_OK){
-        printf("[%s] %s\n", __func__, lwip_strerr(status));
-        result = -1;
+        /* unchanged values do not cost a flash write */
+        result = changed ? blinken_set_config(cfg) : 0;
+    }else{
+        result = blinken_patch_config(upd->offsets, upd->values,
+                                      upd->num_values);
+    }
+
+    if(result != 0){
+        printf("[%s] setting config failed\n", __func__);
+        http_reply(hc, HTTP_500, MIME_TEXT, "error\n", strlen("error\n"));
         goto err_out;
     }
 
+    result = send_api_config(hc, false);
+
 err_out:
-    if(html_buff != NULL){
-        free(html_buff);
+    if(cfg != NULL){
+        free(cfg);
     }
 
-    if(led_cfg != NULL){
-        free(led_cfg);
+    if(upd != NULL){
+        free(upd);
     }
 
     return result;
@@ -887,8 +1577,6 @@ static void http_translate_url_encode(char *url)
     }
 }
 
-#define CRLF "\r\n"
-
 /* get value from post parameter, replace parameter delimiter by \0 */
 static char *get_post_param(char *param)
 {
@@ -901,7 +1589,7 @@ static char *get_post_param(char *param)
     ++param;
 
     end = strstr(param, "&");
-    if(*end != NULL){
+    if(end != NULL){
         *end = '\0';
     }
 
@@ -910,14 +1598,15 @@ static char *get_post_param(char *param)
 
 enum http_method
 {
-    http_get, http_post
+    http_get, http_post, http_put, http_patch
 };
 
 struct http_handler;
 
+/* The request body is hc->body, NUL-terminated. Handlers answer with
+ * http_reply() or http_respond() and leave the connection open. */
 typedef int (*http_handler_fn)(struct http_handler *this,
-                               struct netconn *conn,
-                               struct netbuf *buff);
+                               struct http_conn *hc);
 
 struct http_handler
 {
@@ -929,45 +1618,30 @@ struct http_handler
 };
 
 static struct netconn *listen_conn = NULL;
+static QueueHandle_t conn_queue = NULL;
 
-int handle_root_get(struct http_handler *this,
-                    struct netconn *conn,
-                    struct netbuf *rcv_buff)
-{
-    char *html_buff;
-    int written;
-    struct blinken_cfg *led_cfg;
-    err_t status;
-    int result;
-
-    result = send_blinken_html(conn);
-
-    netbuf_delete(rcv_buff);
-    netconn_close(conn);
-    netconn_delete(conn);
+/* wifi_setting is shared by all workers */
+static SemaphoreHandle_t wifi_lock = NULL;
 
-    return result;
+int handle_root_get(struct http_handler *this, struct http_conn *hc)
+{
+    return send_blinken_html(hc, true);
 }
 
-int handle_root_post(struct http_handler *this, struct netconn *conn,
-        struct netbuf *rcv_buff)
+int handle_root_post(struct http_handler *this, struct http_conn *hc)
 {
-    char *req_str, *body, *end;
+    char *body;
     char *strip_len, *delay;
     char *hue_min, *hue_max, *hue_steps, *cycle_steps;
     char *fade_min, *fade_max, *fade_steps;
     char *eye_rate;
-    char *data;
-    uint16_t data_len;
-    err_t status;
-    size_t req_len;
     unsigned int val;
     int result;
-    size_t len;
     struct blinken_cfg *led_cfg;
 
     result = 0;
     led_cfg = NULL;
+    body = hc->body;
 
     led_cfg = blinken_get_config();
     if(led_cfg == NULL){
@@ -975,41 +1649,6 @@ int handle_root_post(struct http_handler *this, struct netconn *conn,
         goto err_out;
     }
 
-    req_str = malloc(MAX_PAGE_SIZE);
-    if(req_str == NULL){
-        printf("[%s] malloc failed\n", __func__);
-        goto err_out;
-    }
-
-    req_len = 0;
-    memset(req_str, 0x0, MAX_PAGE_SIZE);
-
-    do{
-        status = netbuf_data(rcv_buff, (void *) &data, &data_len);
-        if(status != ERR_OK){
-            break;
-        }
-
-        if(req_len + data_len < MAX_PAGE_SIZE){
-            memcpy(req_str + req_len, data, data_len);
-            req_len += data_len;
-
-            if(netbuf_next(rcv_buff) < 0){
-                break;
-            }
-        }else{
-            status = ERR_MEM;
-        }
-
-    }while(status == ERR_OK);
-
-    body = strstr(req_str, CRLF CRLF);
-    if(body == NULL){
-        printf("[%s] no request body found.\n", __func__);
-        result = -1;
-        goto err_out;
-    }
-
     strip_len = strcasestr(body, "strip_len_in=");
     delay = strcasestr(body, "delay_in=");
     hue_min = strcasestr(body, "hue_min_in=");
@@ -1021,6 +1660,15 @@ int handle_root_post(struct http_handler *this, struct netconn *conn,
     fade_steps = strcasestr(body, "fade_steps_in=");
     eye_rate = strcasestr(body, "eye_rate_in=");
 
+    if(strip_len == NULL || delay == NULL || hue_min == NULL
+            || hue_max == NULL || hue_steps == NULL || cycle_steps == NULL
+            || fade_min == NULL || fade_max == NULL || fade_steps == NULL
+            || eye_rate == NULL){
+        printf("[%s] parameter missing\n", __func__);
+        result = -1;
+        goto err_out;
+    }
+
     strip_len = get_post_param(strip_len);
     delay = get_post_param(delay);
     hue_min = get_post_param(hue_min);
@@ -1032,15 +1680,6 @@ int handle_root_post(struct http_handler *this, struct netconn *conn,
     fade_steps = get_post_param(fade_steps);
     eye_rate = get_post_param(eye_rate);
 
-    if(strip_len == NULL || delay == NULL || hue_min == NULL
-            || hue_max == NULL || hue_steps == NULL || cycle_steps == NULL
-            || fade_min == NULL || fade_max == NULL || fade_steps == NULL
-            || eye_rate == NULL){
-        printf("[%s] parameter missing\n", __func__);
-        result = -1;
-        goto err_out;
-    }
-
 #if 0
     printf("[%s] strip_len passed = %s\n", __func__, strip_len);
     printf("[%s] delay passed = %s\n", __func__, delay);
@@ -1106,226 +1745,99 @@ int handle_root_post(struct http_handler *this, struct netconn *conn,
     result = blinken_set_config(led_cfg);
 
 err_out:
-    free(req_str);
-
     if(led_cfg != NULL){
         free(led_cfg);
     }
-    result = send_blinken_html(conn);
 
-    netbuf_delete(rcv_buff);
-    netconn_close(conn);
-    netconn_delete(conn);
+    if(result != 0){
+        printf("[%s] config not updated\n", __func__);
+    }
 
-    return result;
+    return send_blinken_html(hc, false);
 }
 
-static int send_wifi_html(struct netconn *conn)
+/* caller holds wifi_lock */
+static int wifi_page(struct http_conn *hc, void *arg)
 {
-    char *html_buff;
+    static const char head[] = HTML_HEAD_START wifiHTML_SCRIPT HTML_CSS
+                               wifiHTML_TITLE wifiHTML_BODY_START;
     err_t status;
-    int written, result;
-    uint16_t req_len;
-
-    result = 0;
-    html_buff = malloc(MAX_PAGE_SIZE);
-    if(html_buff == NULL){
-        printf("[%s] malloc failed\n", __func__);
-        netconn_write(conn, HTTP_500, (u16_t) strlen(HTTP_500), NETCONN_COPY);
-        result = -1;
-        goto err_out;
-    }
-
-    memset(html_buff, 0x0, MAX_PAGE_SIZE);
 
-    /* Write out the HTTP OK header. */
-    status = netconn_write(conn, HTTP_OK, (u16_t) strlen(HTTP_OK),
-                           NETCONN_COPY);
+    status = http_write_static(hc, head, sizeof(head) - 1);
 
-    if(status != ERR_OK){
-        printf("[%s] %s\n", __func__, lwip_strerr(status));
-        result = -1;
-        goto err_out;
+    if(status == ERR_OK){
+        status = add_ssid_item(hc, wifi_setting.ssid,
+                               strlen((char* )wifi_setting.ssid));
     }
-    status = netconn_write(conn, HTML_HEAD_START,
-                           (u16_t) strlen(HTML_HEAD_START), NETCONN_COPY);
 
-    if(status != ERR_OK){
-        printf("[%s] %s\n", __func__, lwip_strerr(status));
-        result = -1;
-        goto err_out;
+    if(status == ERR_OK){
+        status = add_sec_type_item(hc, wifi_setting.security_type);
     }
 
-    /* Add script */
-    status = netconn_write(conn, onChangeSecType,
-                           (u16_t) strlen(onChangeSecType), NETCONN_COPY);
-
-    if(status != ERR_OK){
-        printf("[%s] %s\n", __func__, lwip_strerr(status));
-        result = -1;
-        goto err_out;
+    if(status == ERR_OK){
+        status = add_passwd_item(hc, wifi_setting.password,
+                                 strlen((char* )wifi_setting.password));
     }
 
-    status = netconn_write(conn, onSubmitForm, (u16_t) strlen(onSubmitForm),
-                           NETCONN_COPY);
-
-    if(status != ERR_OK){
-        printf("[%s] %s\n", __func__, lwip_strerr(status));
-        result = -1;
-        goto err_out;
+    if(status == ERR_OK){
+        status = add_channel_item(hc, wifi_setting.channel);
     }
 
-    /* add css */
-    status = netconn_write(conn, HTML_CSS, (u16_t) strlen(HTML_CSS),
-                           NETCONN_COPY);
-
-    if(status != ERR_OK){
-        printf("[%s] %s\n", __func__, lwip_strerr(status));
-        result = -1;
-        goto err_out;
+    if(status == ERR_OK){
+        status = http_write_static(hc, wifiHTML_END, strlen(wifiHTML_END));
     }
 
-    status = netconn_write(conn, wifiHTML_TITLE, (u16_t) strlen(wifiHTML_TITLE),
-                           NETCONN_COPY);
+    return status == ERR_OK ? 0 : -1;
+}
 
-    if(status != ERR_OK){
-        printf("[%s] %s\n", __func__, lwip_strerr(status));
-        result = -1;
-        goto err_out;
-    }
+/* caller holds wifi_lock */
+static int send_wifi_html(struct http_conn *hc)
+{
+    return http_respond(hc, HTTP_200, MIME_HTML, "", wifi_page, NULL);
+}
 
-    /* Add Body start */
-    status = netconn_write(conn, wifiHTML_BODY_START,
-                           (u16_t) strlen(wifiHTML_BODY_START), NETCONN_COPY);
+int handle_wifi_get(struct http_handler *this, struct http_conn *hc)
+{
+    int result;
 
-    if(status != ERR_OK){
-        printf("[%s] %s\n", __func__, lwip_strerr(status));
-        result = -1;
-        goto err_out;
-    }
-
-    /* Add SSID */
-    written = add_ssid_item(html_buff, MAX_PAGE_SIZE, wifi_setting.ssid,
-                            strlen((char* )wifi_setting.ssid));
-    handle_html_buff;
-
-    /* Add SECURITY TYPE  */
-    written = add_sec_type_item(html_buff, MAX_PAGE_SIZE,
-                                wifi_setting.security_type);
-    handle_html_buff;
-
-    /* Add PASSWORD */
-    written = add_passwd_item(html_buff, MAX_PAGE_SIZE, wifi_setting.password,
-                              strlen((char* )wifi_setting.password));
-    handle_html_buff;
-
-    /* Add CHANNEL  */
-    written = add_channel_item(html_buff, MAX_PAGE_SIZE, wifi_setting.channel);
-    handle_html_buff;
-
-    /* Add page footer. */
-    status = netconn_write(conn, wifiHTML_END, (u16_t) strlen(wifiHTML_END),
-                           NETCONN_COPY);
-
-    if(status != ERR_OK){
-        printf("[%s] %s\n", __func__, lwip_strerr(status));
-        result = -1;
-        goto err_out;
-    }
-
-err_out:
-    if(html_buff != NULL){
-        free(html_buff);
-    }
+    xSemaphoreTake(wifi_lock, portMAX_DELAY);
+    result = send_wifi_html(hc);
+    xSemaphoreGive(wifi_lock);
 
     return result;
 }
 
-int handle_wifi_get(struct http_handler *this, struct netconn *conn,
-        struct netbuf *rcv_buff)
-{
-    char *request, *html_buff;
-    err_t status;
-    int written, result;
-
-    uint16_t req_len;
-
-    result = send_wifi_html(conn);
-
-    netbuf_delete(rcv_buff);
-    netconn_close(conn);
-    netconn_delete(conn);
-
-    return 0;
-}
-
-int handle_wifi_post(struct http_handler *this, struct netconn *conn,
-        struct netbuf *rcv_buff)
+int handle_wifi_post(struct http_handler *this, struct http_conn *hc)
 {
     rtw_security_t secType;
-    char *req_str, *body, *ssid, *sec_type, *passwd, *chan, *end;
-    char *data;
-    uint16_t data_len;
-    err_t status;
-    size_t req_len;
+    char *body, *ssid, *sec_type, *passwd, *chan;
     unsigned int updated;
     unsigned int channel;
     size_t len;
-    struct netconn *tmp_conn;
     int result;
 
     updated = 0;
     result = 0;
+    body = hc->body;
 
-    req_str = malloc(MAX_PAGE_SIZE);
-    if(req_str == NULL){
-        printf("[%s] malloc failed\n", __func__);
-        goto err_out;
-    }
-
-    req_len = 0;
-    memset(req_str, 0x0, MAX_PAGE_SIZE);
-
-    do{
-        status = netbuf_data(rcv_buff, (void *) &data, &data_len);
-        if(status != ERR_OK){
-            break;
-        }
-
-        if(req_len + data_len < MAX_PAGE_SIZE){
-            memcpy(req_str + req_len, data, data_len);
-            req_len += data_len;
-
-            if(netbuf_next(rcv_buff) < 0){
-                break;
-            }
-        }else{
-            status = ERR_MEM;
-        }
-
-    }while(status == ERR_OK);
-
-    body = strstr(req_str, CRLF CRLF);
-    if(body == NULL){
-        printf("[%s] no request body found.\n", __func__);
-        goto err_out;
-    }
+    xSemaphoreTake(wifi_lock, portMAX_DELAY);
 
     ssid = strcasestr(body, "Ssid=");
     sec_type = strcasestr(body, "Security+Type=");
     passwd = strcasestr(body, "Password=");
     chan = strcasestr(body, "Channel=");
 
-    ssid = get_post_param(ssid);
-    sec_type = get_post_param(sec_type);
-    passwd = get_post_param(passwd);
-    chan = get_post_param(chan);
-
     if(ssid == NULL || sec_type == NULL || passwd == NULL || chan == NULL){
         printf("[%s] parameter missing\n", __func__);
+        result = send_wifi_html(hc);
         goto err_out;
     }
 
+    ssid = get_post_param(ssid);
+    sec_type = get_post_param(sec_type);
+    passwd = get_post_param(passwd);
+    chan = get_post_param(chan);
+
     http_translate_url_encode(ssid);
     http_translate_url_encode(passwd);
 
@@ -1382,137 +1894,587 @@ int handle_wifi_post(struct http_handler *this, struct netconn *conn,
         updated = 1;
     }
 
-    memset(req_str, 0x0, MAX_PAGE_SIZE);
-
     if(updated){
         store_ap_info();
-        /* Write out the HTTP OK header. */
-        netconn_write(conn, wifiHTML_WAIT, (u16_t) strlen(wifiHTML_WAIT),
-                      NETCONN_COPY);
+
+        /* the AP restart takes this connection down anyway */
+        hc->keep_alive = false;
+        result = http_reply(hc, HTTP_200, MIME_HTML, wifiHTML_WAIT,
+                            strlen(wifiHTML_WAIT));
 
         vTaskDelay(200 / portTICK_RATE_MS);
 
     }else{
-        result = send_wifi_html(conn);
+        result = send_wifi_html(hc);
     }
 
 err_out:
-    if(req_str != NULL){
-        free(req_str);
+    /* connections left over from before the restart run into their
+     * receive timeout in the workers */
+    if(updated){
+        restart_soft_ap();
     }
 
-    netbuf_delete(rcv_buff);
-    netconn_close(conn);
-    netconn_delete(conn);
+    xSemaphoreGive(wifi_lock);
 
-    if(updated){
-        restart_soft_ap();
+    return result;
+}
 
-        listen_conn->recv_timeout = 1;
-        port_netconn_accept(listen_conn, tmp_conn, result);
-        if(tmp_conn != NULL && result == ERR_OK){
-            netconn_close(tmp_conn);
-            while(netconn_delete(tmp_conn) != ERR_OK){
-                vTaskDelay(SHORT_DELAY);
-            }
-        }
-        listen_conn->recv_timeout = 0;
+int handle_vm_get(struct http_handler *this, struct http_conn *hc)
+{
+    struct blinken_vm_info info;
+    char buff[128];
+    int len;
+
+    blinken_get_vm_info(&info);
+
+    len = snprintf(buff, sizeof(buff),
+                   "code_len=%u\nmode=%s\nused=%u\noverruns=%u\nfaults=%u\n",
+                   (unsigned int) info.code_len,
+                   info.mode == vm_frame ? "frame" : "pixel",
+                   (unsigned int) info.used,
+                   (unsigned int) info.overruns,
+                   (unsigned int) info.faults);
+
+    return http_reply(hc, HTTP_200, MIME_TEXT, buff,
+                      len > 0 ? min(len, sizeof(buff) - 1) : 0);
+}
+
+int handle_persist_get(struct http_handler *this, struct http_conn *hc)
+{
+    struct blinken_persist_info info;
+    char buff[96];
+    int len;
+
+    blinken_get_persist_info(&info);
+
+    len = snprintf(buff, sizeof(buff),
+                   "dirty=%u\nsaving=%u\nsaves=%u\nfailures=%u\n",
+                   (unsigned int) info.dirty,
+                   (unsigned int) info.saving,
+                   (unsigned int) info.saves,
+                   (unsigned int) info.failures);
+
+    return http_reply(hc, HTTP_200, MIME_TEXT, buff,
+                      len > 0 ? min(len, sizeof(buff) - 1) : 0);
+}
+
+/* Upload a program as produced by the host assembler, e.g.
+ * curl --data-binary @plasma.bin http://<ip>/vm */
+int handle_vm_post(struct http_handler *this, struct http_conn *hc)
+{
+    int result;
+
+    result = blinken_set_program((const struct vm_program *) hc->body,
+                                 hc->body_len);
+
+    if(result == 0){
+        http_reply(hc, HTTP_200, MIME_TEXT, "ok\n", strlen("ok\n"));
+    } else {
+        http_reply(hc, HTTP_400, MIME_TEXT, "invalid program\n",
+                   strlen("invalid program\n"));
     }
 
     return result;
 }
 
-int handle_404(struct http_handler *this, struct netconn *conn,
-        struct netbuf *rcv_buff)
+int handle_preset_get(struct http_handler *this, struct http_conn *hc)
 {
-    netconn_write(conn, HTTP_404, (u16_t) strlen(HTTP_404), NETCONN_COPY);
-    netbuf_delete(rcv_buff);
-    netconn_close(conn);
-    netconn_delete(conn);
+    struct blinken_preset_info info[BLINKEN_MAX_PRESETS];
+    char buff[32 + BLINKEN_MAX_PRESETS * (BLINKEN_PRESET_NAME + 8)];
+    unsigned int i;
+    int active, len, result;
+
+    result = blinken_get_presets(info, &active);
+    if(result != 0){
+        http_reply(hc, HTTP_500, MIME_TEXT, "error\n", strlen("error\n"));
+        goto err_out;
+    }
+
+    len = snprintf(buff, sizeof(buff), "active=%d\n", active);
+    for(i = 0; i < BLINKEN_MAX_PRESETS && len < sizeof(buff); ++i){
+        len += snprintf(buff + len, sizeof(buff) - len, "%u=%s\n", i,
+                        info[i].valid ? info[i].name : "");
+    }
+
+    result = http_reply(hc, HTTP_200, MIME_TEXT, buff,
+                        min(len, sizeof(buff) - 1));
+
+err_out:
+    return result;
+}
+
+/* Switch presets with a single short request, e.g.
+ * curl -d 'load=1&fade=500' http://<ip>/preset
+ * curl -d 'save=1&name=evening' http://<ip>/preset */
+int handle_preset_post(struct http_handler *this, struct http_conn *hc)
+{
+    char *body;
+    char *load, *save, *fade, *name;
+    unsigned int slot;
+    int result;
+
+    body = hc->body;
+
+    /* find all parameters first, extracting one cuts off the rest */
+    load = strcasestr(body, "load=");
+    save = strcasestr(body, "save=");
+    fade = strcasestr(body, "fade=");
+    name = strcasestr(body, "name=");
+
+    if(load != NULL){
+        load = get_post_param(load);
+    }
+
+    if(save != NULL){
+        save = get_post_param(save);
+    }
+
+    if(fade != NULL){
+        fade = get_post_param(fade);
+    }
+
+    if(name != NULL){
+        name = get_post_param(name);
+        http_translate_url_encode(name);
+    }
+
+    result = -1;
+    if(load != NULL){
+        slot = strtoul(load, NULL, 10);
+        result = blinken_load_preset(slot,
+                                     fade != NULL ? strtoul(fade, NULL, 10)
+                                                  : 0);
+    } else if(save != NULL){
+        slot = strtoul(save, NULL, 10);
+        result = blinken_save_preset(slot, name != NULL ? name : "");
+    }
+
+    if(result == 0){
+        http_reply(hc, HTTP_200, MIME_TEXT, "ok\n", strlen("ok\n"));
+    } else {
+        http_reply(hc, HTTP_400, MIME_TEXT, "invalid preset\n",
+                   strlen("invalid preset\n"));
+    }
+
+    return result;
+}
+
+/* One line per filter of the running config, times in CPU cycles. The total
+ * is given in thousands, it would overflow 32 bits within seconds. */
+int handle_profile_get(struct http_handler *this, struct http_conn *hc)
+{
+    struct blinken_prof_info *info;
+    struct blinken_prof_info *prof;
+    char *buff;
+    size_t size;
+    unsigned int i, num;
+    int len, result;
+
+    size = 64 + BLINKEN_MAX_PROF * (BLINKEN_PROF_NAME + 56);
+    buff = NULL;
+    info = malloc(BLINKEN_MAX_PROF * sizeof(*info));
+    if(info != NULL){
+        buff = malloc(size);
+    }
+
+    if(info == NULL || buff == NULL){
+        printf("[%s] malloc failed\n", __func__);
+        http_reply(hc, HTTP_500, MIME_TEXT, "error\n", strlen("error\n"));
+        result = -1;
+        goto err_out;
+    }
+
+    result = blinken_get_profile(info, &num, false);
+    if(result != 0){
+        http_reply(hc, HTTP_500, MIME_TEXT, "error\n", strlen("error\n"));
+        goto err_out;
+    }
+
+    len = snprintf(buff, size, "layer zone filter calls total_k max avg\n");
+    for(i = 0; i < num && len < size; ++i){
+        prof = &info[i];
+        len += snprintf(buff + len, size - len, "%u %u %s %u %u %u %u\n",
+                        (unsigned int) prof->layer,
+                        (unsigned int) prof->zone,
+                        prof->name,
+                        (unsigned int) prof->calls,
+                        (unsigned int) (prof->total / 1000),
+                        (unsigned int) prof->max,
+                        prof->calls > 0
+                            ? (unsigned int) (prof->total / prof->calls)
+                            : 0);
+    }
+
+    result = http_reply(hc, HTTP_200, MIME_TEXT, buff, min(len, size - 1));
+
+err_out:
+    if(buff != NULL){
+        free(buff);
+    }
+
+    if(info != NULL){
+        free(info);
+    }
+
+    return result;
+}
+
+/* any POST to /profile starts the numbers over */
+int handle_profile_post(struct http_handler *this, struct http_conn *hc)
+{
+    int result;
+
+    result = blinken_reset_profile();
+    if(result == 0){
+        http_reply(hc, HTTP_200, MIME_TEXT, "ok\n", strlen("ok\n"));
+    } else {
+        http_reply(hc, HTTP_500, MIME_TEXT, "error\n", strlen("error\n"));
+    }
+
+    return result;
+}
+
+/* The running config as JSON, changed with e.g.
+ * curl -X PATCH -d '{"fade":{"min":20}}' http://<ip>/api/config
+ * PATCH only needs the values to change, PUT all of them. */
+int handle_api_get(struct http_handler *this, struct http_conn *hc)
+{
+    return send_api_config(hc, true);
+}
+
+int handle_api_put(struct http_handler *this, struct http_conn *hc)
+{
+    return api_update_config(hc, true);
+}
+
+int handle_api_patch(struct http_handler *this, struct http_conn *hc)
+{
+    return api_update_config(hc, false);
+}
+
+/* Assets only exist gzip compressed. Every browser asks for that, curl
+ * needs --compressed. Accept-Encoding is deliberately not looked at: there
+ * is nothing else to send, and a client without the header takes any
+ * encoding anyway. */
+int handle_asset(struct http_handler *this, struct http_conn *hc)
+{
+    const struct blinken_asset *asset;
+    char etag[ETAG_SIZE];
+    char extra[ETAG_SIZE + sizeof(ETAG_HEADERS) + 32];
+
+    asset = (const struct blinken_asset *) this->priv;
+
+    snprintf(etag, sizeof(etag), "\"%08x\"", (unsigned int) asset->crc);
+    if(http_etag_match(hc, etag)){
+        return http_not_modified(hc, etag);
+    }
+
+    snprintf(extra, sizeof(extra), "Content-Encoding: gzip\r\n" ETAG_HEADERS,
+             etag);
+
+    if(http_head(hc, HTTP_200, asset->type, extra, asset->len) != ERR_OK){
+        return -1;
+    }
+
+    if(http_write_static(hc, asset->data, asset->len) != ERR_OK){
+        return -1;
+    }
+
+    if(http_flush(hc, false) != ERR_OK){
+        return -1;
+    }
 
     return 0;
 }
 
+int handle_404(struct http_handler *this, struct http_conn *hc)
+{
+    return http_reply(hc, HTTP_404, MIME_TEXT, "not found\n",
+                      strlen("not found\n"));
+}
+
 LIST_HEAD(req_handlers);
 struct http_handler local_handlers[] = {
   {.method = http_get, .path = "/",    .func = handle_root_get, .priv = NULL},
   {.method = http_post,.path = "/",    .func = handle_root_post,.priv = NULL},
   {.method = http_get, .path = "/wifi",.func = handle_wifi_get, .priv = NULL},
   {.method = http_post,.path = "/wifi",.func = handle_wifi_post,.priv = NULL},
+  {.method = http_get, .path = "/vm",  .func = handle_vm_get,   .priv = NULL},
+  {.method = http_post,.path = "/vm",  .func = handle_vm_post,  .priv = NULL},
+  {.method = http_get, .path = "/persist", .func = handle_persist_get,
+   .priv = NULL},
+  {.method = http_get, .path = "/preset", .func = handle_preset_get,
+   .priv = NULL},
+  {.method = http_post,.path = "/preset", .func = handle_preset_post,
+   .priv = NULL},
+  {.method = http_get, .path = "/profile", .func = handle_profile_get,
+   .priv = NULL},
+  {.method = http_post,.path = "/profile", .func = handle_profile_post,
+   .priv = NULL},
+  {.method = http_get, .path = "/api/config", .func = handle_api_get,
+   .priv = NULL},
+  {.method = http_put, .path = "/api/config", .func = handle_api_put,
+   .priv = NULL},
+  {.method = http_patch,.path = "/api/config", .func = handle_api_patch,
+   .priv = NULL},
   {.path = NULL, .func = NULL }, };
 
 struct http_handler handler_404 = {
         .method = http_get, .path = "", .func = handle_404, .priv = NULL };
 
-#define ARRAY_SIZE(x)   (sizeof(x) / sizeof(*x))
+/* one GET handler per asset, set up with the others */
+static struct http_handler *asset_handlers = NULL;
 
-static int handle_conn(struct netconn *conn)
+/* Move more of the received data into the request buffer, waiting for the
+ * client if nothing is left over. A client gets less time to come up with
+ * the next request than to finish the current one. */
+static err_t http_fill(struct http_conn *hc)
+{
+    char *data;
+    uint16_t data_len;
+    size_t len;
+    err_t status;
+
+    if(hc->rx == NULL){
+        hc->conn->recv_timeout = (hc->len == 0 && hc->requests > 0)
+                                    ? HTTP_IDLE_TIMEOUT
+                                    : HTTP_RECV_TIMEOUT;
+
+        port_netconn_recv(hc->conn, hc->rx, status);
+        if(hc->rx == NULL || status != ERR_OK){
+            if(hc->rx != NULL){
+                netbuf_delete(hc->rx);
+                hc->rx = NULL;
+            }
+
+            return status != ERR_OK ? status : ERR_CLSD;
+        }
+
+        hc->rx_off = 0;
+    }
+
+    while(hc->len < MAX_PAGE_SIZE - 1){
+        netbuf_data(hc->rx, (void *) &data, &data_len);
+
+        len = min(data_len - hc->rx_off, MAX_PAGE_SIZE - 1 - hc->len);
+        memcpy(hc->buf + hc->len, data + hc->rx_off, len);
+        hc->len += len;
+        hc->rx_off += len;
+
+        /* request buffer is full, keep the rest */
+        if(hc->rx_off < data_len){
+            break;
+        }
+
+        hc->rx_off = 0;
+        if(netbuf_next(hc->rx) < 0){
+            netbuf_delete(hc->rx);
+            hc->rx = NULL;
+            break;
+        }
+    }
+
+    hc->buf[hc->len] = '\0';
+
+    return ERR_OK;
+}
+
+/* Wait for a complete request, pipelined ones may already be in the buffer.
+ * Returns -1 if the connection has to be closed without an answer. */
+static int http_read_request(struct http_conn *hc, char *method, char *path,
+                             unsigned int *minor, char **hdr_end)
 {
-    static portCHAR cDynamicPage[MAX_PAGE_SIZE];
-    struct netbuf *rcv_buff;
-    portCHAR *req_str;
-    unsigned portSHORT req_len;
-    u8_t bChanged = 0;
+    char *clen;
+    size_t hdr_len, content_len;
     int result;
-    int ret_accept = ERR_OK;
-    char *ptr = NULL;
-    char method[5];
-    char path[33];
-    unsigned int i;
-    enum http_method req_method;
-    struct http_handler *handler, *tmp_handler;
 
-    rcv_buff = NULL;
-    port_netconn_recv(conn, rcv_buff, result);
+    result = -1;
 
-    if(rcv_buff == NULL || result != ERR_OK){
-        goto err_out;
+    while((*hdr_end = strstr(hc->buf, CRLF CRLF)) == NULL){
+        if(hc->len >= MAX_PAGE_SIZE - 1){
+            printf("[%s] request header too large\n", __func__);
+            hc->keep_alive = false;
+            http_reply(hc, HTTP_413, MIME_TEXT, "too large\n",
+                       strlen("too large\n"));
+            goto err_out;
+        }
+
+        if(http_fill(hc) != ERR_OK){
+            goto err_out;
+        }
     }
 
-    netbuf_data(rcv_buff, (void *) &req_str, &req_len);
+    *hdr_end += strlen(CRLF CRLF);
+    hdr_len = *hdr_end - hc->buf;
 
-    result = sscanf(req_str, "%4s %32s HTTP/", method, path);
-    if(result != 2){
+    if(sscanf(hc->buf, "%7s %32s HTTP/1.%u", method, path, minor) != 3){
         printf("[%s] Parsing request failed\n", __func__);
+        hc->keep_alive = false;
+        http_reply(hc, HTTP_400, MIME_TEXT, "bad request\n",
+                   strlen("bad request\n"));
         goto err_out;
     }
 
-    if(!strncmp(method, "GET", strlen("GET"))){
-        req_method = http_get;
-    }else if(!strncmp(method, "POST", strlen("POST"))){
-        req_method = http_post;
-    }else{
-        printf("[%s] invalid HTTP method: %s\n", __func__, method);
+    /* only bodies with a length are understood, anything else would be
+     * taken for the next request */
+    if(http_header(hc, *hdr_end, "Transfer-Encoding") != NULL){
+        printf("[%s] chunked requests not supported\n", __func__);
+        hc->keep_alive = false;
+        http_reply(hc, HTTP_400, MIME_TEXT, "bad request\n",
+                   strlen("bad request\n"));
         goto err_out;
     }
 
-    handler = NULL;
-    list_for_each_entry(tmp_handler, &req_handlers, list, struct http_handler)
-    {
-        if(tmp_handler->method != req_method){
-            continue;
-        }
+    content_len = 0;
+    clen = http_header(hc, *hdr_end, "Content-Length");
+    if(clen != NULL){
+        content_len = strtoul(clen, NULL, 10);
+    }
 
-        if(strncmp(path, tmp_handler->path, strlen(tmp_handler->path) + 1)){
-            continue;
-        }
+    if(content_len >= MAX_PAGE_SIZE - hdr_len){
+        printf("[%s] request too large\n", __func__);
+        hc->keep_alive = false;
+        http_reply(hc, HTTP_413, MIME_TEXT, "too large\n",
+                   strlen("too large\n"));
+        goto err_out;
+    }
 
-        handler = tmp_handler;
-        break;
+    /* curl asks before sending bodies larger than 1k */
+    if(hc->len < hdr_len + content_len
+            && http_header(hc, *hdr_end, "Expect") != NULL){
+        netconn_write(hc->conn, HTTP_CONTINUE, strlen(HTTP_CONTINUE),
+                      NETCONN_COPY);
     }
 
-    if(handler == NULL){
-        printf("[%s] no handler found for method %s and path %s\n",
-                __func__, method, path);
-        handler = &handler_404;
+    while(hc->len < hdr_len + content_len){
+        if(http_fill(hc) != ERR_OK){
+            printf("[%s] incomplete request\n", __func__);
+            goto err_out;
+        }
     }
 
-    result = handler->func(handler, conn, rcv_buff);
+    hc->body = *hdr_end;
+    hc->body_len = content_len;
+    hc->used = hdr_len + content_len;
+
+    result = 0;
 
+err_out:
     return result;
+}
+
+/* Serve requests on a connection until the client is done with it. It is
+ * kept open for further requests if the client wants that, but not for more
+ * than HTTP_MAX_REQUESTS or while other connections wait for a worker. */
+static int handle_conn(struct netconn *conn)
+{
+    struct http_conn hc;
+    char method[8];
+    char path[33];
+    char *hdr_end, *value;
+    char next;
+    unsigned int minor;
+    int result;
+    enum http_method req_method;
+    struct http_handler *handler, *tmp_handler;
+
+    memset(&hc, 0x0, sizeof(hc));
+    hc.conn = conn;
+    result = -1;
+
+    /* request and response buffer in one */
+    hc.buf = malloc(MAX_PAGE_SIZE + HTTP_SEG_SIZE);
+    if(hc.buf == NULL){
+        printf("[%s] malloc failed\n", __func__);
+        goto err_out;
+    }
+
+    hc.buf[0] = '\0';
+    hc.seg = hc.buf + MAX_PAGE_SIZE;
+
+    do{
+        result = http_read_request(&hc, method, path, &minor, &hdr_end);
+        if(result != 0){
+            break;
+        }
+
+        value = http_header(&hc, hdr_end, "Connection");
+        if(minor > 0){
+            hc.keep_alive = value == NULL
+                            || strncasecmp(value, "close", strlen("close"));
+        }else{
+            hc.keep_alive = value != NULL
+                            && !strncasecmp(value, "keep-alive",
+                                            strlen("keep-alive"));
+        }
+
+        ++hc.requests;
+        if(hc.requests >= HTTP_MAX_REQUESTS
+                || uxQueueMessagesWaiting(conn_queue) > 0){
+            hc.keep_alive = false;
+        }
+
+        if(!strncmp(method, "GET", strlen("GET"))){
+            req_method = http_get;
+        }else if(!strncmp(method, "POST", strlen("POST"))){
+            req_method = http_post;
+        }else if(!strncmp(method, "PUT", strlen("PUT"))){
+            req_method = http_put;
+        }else if(!strncmp(method, "PATCH", strlen("PATCH"))){
+            req_method = http_patch;
+        }else{
+            printf("[%s] invalid HTTP method: %s\n", __func__, method);
+            hc.keep_alive = false;
+            http_reply(&hc, HTTP_400, MIME_TEXT, "bad request\n",
+                       strlen("bad request\n"));
+            break;
+        }
+
+        handler = NULL;
+        list_for_each_entry(tmp_handler, &req_handlers, list,
+                            struct http_handler)
+        {
+            if(tmp_handler->method != req_method){
+                continue;
+            }
+
+            if(strncmp(path, tmp_handler->path,
+                       strlen(tmp_handler->path) + 1)){
+                continue;
+            }
+
+            handler = tmp_handler;
+            break;
+        }
+
+        if(handler == NULL){
+            printf("[%s] no handler found for method %s and path %s\n",
+                    __func__, method, path);
+            handler = &handler_404;
+        }
+
+        /* terminate the body, the next request may start right behind it */
+        next = hc.buf[hc.used];
+        hc.buf[hc.used] = '\0';
+
+        result = handler->func(handler, &hc);
+
+        hc.buf[hc.used] = next;
+        hc.len -= hc.used;
+        memmove(hc.buf, hc.buf + hc.used, hc.len + 1);
+        hc.used = 0;
+    }while(hc.keep_alive);
 
 err_out:
-    netbuf_delete(rcv_buff);
+    if(hc.rx != NULL){
+        netbuf_delete(hc.rx);
+    }
+
+    if(hc.buf != NULL){
+        free(hc.buf);
+    }
+
     netconn_close(conn);
     netconn_delete(conn);
 
@@ -1522,7 +2484,65 @@ err_out:
 TaskHandle_t blinken_task = NULL;
 SemaphoreHandle_t blinken_sema = NULL;
 volatile u8_t blinken_terminate = 0;
-extern p_wlan_init_done_callback;
+
+static TaskHandle_t worker_tasks[HTTP_WORKERS];
+static SemaphoreHandle_t worker_sema = NULL;
+
+/* A NULL connection tells a worker to exit. */
+static void http_worker_fn(void *pvParameters)
+{
+    struct netconn *conn;
+    TaskHandle_t *slot;
+
+    slot = (TaskHandle_t *) pvParameters;
+
+    while(1){
+        if(xQueueReceive(conn_queue, &conn, portMAX_DELAY) != pdTRUE){
+            continue;
+        }
+
+        if(conn == NULL){
+            break;
+        }
+
+        handle_conn(conn);
+    }
+
+    *slot = NULL;
+    xSemaphoreGive(worker_sema);
+    vTaskDelete(NULL);
+}
+
+static void reject_conn(struct netconn *conn)
+{
+    netconn_write(conn, HTTP_503, (u16_t) strlen(HTTP_503), NETCONN_COPY);
+    netconn_close(conn);
+    netconn_delete(conn);
+}
+
+static void stop_workers(void)
+{
+    struct netconn *conn;
+    unsigned int i, num;
+
+    conn = NULL;
+    num = 0;
+    for(i = 0; i < HTTP_WORKERS; ++i){
+        if(worker_tasks[i] != NULL){
+            xQueueSend(conn_queue, &conn, portMAX_DELAY);
+            ++num;
+        }
+    }
+
+    for(i = 0; i < num; ++i){
+        if(xSemaphoreTake(worker_sema, 5 * configTICK_RATE_HZ) != pdTRUE){
+            printf("[%s] worker did not exit\n", __func__);
+            break;
+        }
+    }
+}
+
+extern int (*p_wlan_init_done_callback)(void);
 void blinken_task_fn(void *pvParameters __attribute__((unused)))
 {
     struct netconn *work_conn;
@@ -1549,12 +2569,25 @@ void blinken_task_fn(void *pvParameters __attribute__((unused)))
         /* Wait for connection. */
         port_netconn_accept(listen_conn, work_conn, result);
 
-        if(work_conn != NULL && result == ERR_OK){
-            /* Service connection. */
-            handle_conn(work_conn);
+        if(work_conn == NULL || result != ERR_OK){
+            continue;
+        }
+
+        work_conn->recv_timeout = HTTP_RECV_TIMEOUT;
+#if LWIP_SO_SNDTIMEO
+        work_conn->send_timeout = HTTP_SEND_TIMEOUT;
+#endif
+
+        /* Hand the connection to a worker. */
+        if(xPortGetFreeHeapSize() < HTTP_MIN_HEAP
+                || xQueueSend(conn_queue, &work_conn, 0) != pdTRUE){
+            printf("[%s] busy, connection rejected\n", __func__);
+            reject_conn(work_conn);
         }
     }
 
+    stop_workers();
+
     if(listen_conn){
         netconn_abort(listen_conn);
         netconn_close(listen_conn);
@@ -1570,7 +2603,6 @@ void blinken_task_fn(void *pvParameters __attribute__((unused)))
 int blinken_server_init(void)
 {
     BaseType_t result;
-    struct http_handler *handler;
     unsigned int i;
 
     p_wlan_init_done_callback = NULL;
@@ -1580,14 +2612,69 @@ int blinken_server_init(void)
     blinken_terminate = 0;
 
     INIT_LIST_HEAD(&req_handlers);
-    for(i = 0;i < ARRAY_SIZE(local_handlers);++i){
+    for(i = 0;local_handlers[i].path != NULL;++i){
         list_add_tail(&(local_handlers[i].list), &req_handlers);
     }
 
+    page_tag = page_crc(led_page, ARRAY_SIZE(led_page));
+    api_tag = api_crc();
+
+    if(asset_handlers == NULL){
+        asset_handlers = malloc(blinken_num_assets * sizeof(*asset_handlers));
+    }
+
+    if(asset_handlers != NULL){
+        for(i = 0;i < blinken_num_assets;++i){
+            asset_handlers[i].method = http_get;
+            asset_handlers[i].path = (char *) blinken_assets[i].path;
+            asset_handlers[i].func = handle_asset;
+            asset_handlers[i].priv = (void *) &blinken_assets[i];
+            list_add_tail(&(asset_handlers[i].list), &req_handlers);
+        }
+    }else{
+        printf("[%s] malloc failed, static files not served\n", __func__);
+    }
+
     if(blinken_sema == NULL){
         blinken_sema = xSemaphoreCreateCounting(0xffffffff, 0);
     }
 
+    if(worker_sema == NULL){
+        worker_sema = xSemaphoreCreateCounting(HTTP_WORKERS, 0);
+    }
+
+    if(wifi_lock == NULL){
+        wifi_lock = xSemaphoreCreateMutex();
+    }
+
+    if(conn_queue == NULL){
+        conn_queue = xQueueCreate(HTTP_BACKLOG, sizeof(struct netconn *));
+    }
+
+    if(blinken_sema == NULL || worker_sema == NULL || wifi_lock == NULL
+            || conn_queue == NULL){
+        printf("[%s] Creating server semaphores failed!\n", __func__);
+        return -1;
+    }
+
+    for(i = 0; i < HTTP_WORKERS; ++i){
+        if(worker_tasks[i] != NULL){
+            continue;
+        }
+
+        result = xTaskCreate(http_worker_fn,
+                             "blinken_worker",
+                             STACKSIZE,
+                             &worker_tasks[i],
+                             tskIDLE_PRIORITY + 2,
+                             &worker_tasks[i]);
+
+        if(result != pdPASS){
+            printf("[%s] Creating worker task %u failed!\n", __func__, i);
+            worker_tasks[i] = NULL;
+        }
+    }
+
     if(blinken_task == NULL){
         result = xTaskCreate(blinken_task_fn,
                              "blinken_server",
@@ -1613,6 +2700,7 @@ void start_blinken_server()
 void stop_blinken_server()
 {
     BaseType_t result;
+    unsigned int i;
 
     blinken_terminate = 1;
 
@@ -1633,6 +2721,13 @@ void stop_blinken_server()
         blinken_sema = NULL;
     }
 
+    for(i = 0; i < HTTP_WORKERS; ++i){
+        if(worker_tasks[i] != NULL){
+            vTaskDelete(worker_tasks[i]);
+            worker_tasks[i] = NULL;
+        }
+    }
+
     if(blinken_task){
         vTaskDelete(blinken_task);
         blinken_task = NULL;
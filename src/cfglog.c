@@ -0,0 +1,220 @@
+/**
+ * RTL8710 Blinkenlights. WiFi-controlled WS2812B LED strip.
+ * Copyright (C) 2016  Tido Klaassen <tido@4gh.eu>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+#include <platform_opts.h>
+#include <platform_stdlib.h>
+#include <flash_api.h>
+#include <stdbool.h>
+#include "device_lock.h"
+#include "crc32.h"
+#include "cfglog.h"
+
+#ifndef min
+#define min(a,b)            ((a) < (b) ? (a) : (b))
+#endif
+
+#define CFGLOG_MAGIC        0x4C47 // "GL"
+#define CFGLOG_SECTOR_SIZE  0x1000
+#define CFGLOG_ERASED       0xffff
+
+#define sector_addr(x)      (BLINKEN_LOG_SECTOR + (x) * CFGLOG_SECTOR_SIZE)
+#define rec_size(len)       ((sizeof(struct cfglog_rec) + (len) + 3) & ~3u)
+
+struct cfglog_rec {
+    uint16_t magic;
+    uint16_t len;       // payload bytes following the header
+    uint32_t seq;
+    uint32_t crc;       // over magic, len, seq and the payload
+} __attribute__((packed));
+
+static struct {
+    bool valid;         // addr points to the newest valid record
+    uint32_t addr;
+    uint32_t seq;
+    uint16_t len;
+    unsigned int sector;
+    uint32_t offset;    // where the next record goes in sector
+} cfglog;
+
+/* sequence numbers may wrap around */
+static inline bool seq_after(uint32_t a, uint32_t b)
+{
+    return (int32_t) (a - b) > 0;
+}
+
+static int flash_read(uint32_t addr, void *data, size_t len)
+{
+    flash_t flash;
+    int result;
+
+    device_mutex_lock(RT_DEV_LOCK_FLASH);
+    result = flash_stream_read(&flash, addr, len, (uint8_t *) data);
+    device_mutex_unlock(RT_DEV_LOCK_FLASH);
+
+    return result == 1 ? 0 : -1;
+}
+
+/* check a record's CRC, reading the payload in small chunks */
+static bool rec_valid(uint32_t addr, const struct cfglog_rec *rec)
+{
+    uint8_t buff[64];
+    uint32_t crc;
+    size_t done, chunk;
+
+    crc = crc32_update(0, rec, offsetof(struct cfglog_rec, crc));
+
+    for(done = 0; done < rec->len; done += chunk){
+        chunk = min(rec->len - done, sizeof(buff));
+        if(flash_read(addr + sizeof(*rec) + done, buff, chunk) != 0){
+            return false;
+        }
+
+        crc = crc32_update(crc, buff, chunk);
+    }
+
+    return crc == rec->crc;
+}
+
+int cfglog_init(void)
+{
+    struct cfglog_rec rec;
+    uint32_t ends[BLINKEN_LOG_SECTORS];
+    uint32_t base, off;
+    unsigned int i;
+
+    memset(&cfglog, 0x0, sizeof(cfglog));
+
+    for(i = 0; i < BLINKEN_LOG_SECTORS; ++i){
+        base = sector_addr(i);
+        off = 0;
+
+        while(off + sizeof(rec) <= CFGLOG_SECTOR_SIZE){
+            if(flash_read(base + off, &rec, sizeof(rec)) != 0){
+                off = CFGLOG_SECTOR_SIZE;
+                break;
+            }
+
+            /* free space starts here */
+            if(rec.magic == CFGLOG_ERASED && rec.len == CFGLOG_ERASED){
+                break;
+            }
+
+            /* no way to find the next record, treat the sector as full */
+            if(rec.magic != CFGLOG_MAGIC
+               || off + rec_size(rec.len) > CFGLOG_SECTOR_SIZE){
+                off = CFGLOG_SECTOR_SIZE;
+                break;
+            }
+
+            if((!cfglog.valid || seq_after(rec.seq, cfglog.seq))
+               && rec_valid(base + off, &rec)){
+                cfglog.valid = true;
+                cfglog.addr = base + off;
+                cfglog.seq = rec.seq;
+                cfglog.len = rec.len;
+                cfglog.sector = i;
+            }
+
+            off += rec_size(rec.len);
+        }
+
+        ends[i] = off;
+    }
+
+    if(cfglog.valid){
+        cfglog.offset = ends[cfglog.sector];
+        printf("[%s] newest record %u in sector %u\n", __func__,
+               (unsigned int) cfglog.seq, cfglog.sector);
+    } else {
+        /* make the first write start over in sector 0 */
+        cfglog.sector = BLINKEN_LOG_SECTORS - 1;
+        cfglog.offset = CFGLOG_SECTOR_SIZE;
+        printf("[%s] no valid record found\n", __func__);
+    }
+
+    return cfglog.valid ? 0 : -1;
+}
+
+/* Read the newest record. If it is shorter than len, the rest of data is
+ * filled with 0xff, just like unwritten flash. */
+int cfglog_read(void *data, size_t len)
+{
+    if(!cfglog.valid){
+        return -1;
+    }
+
+    memset(data, 0xff, len);
+
+    return flash_read(cfglog.addr + sizeof(struct cfglog_rec), data,
+                      min(len, cfglog.len));
+}
+
+int cfglog_write(const void *data, size_t len)
+{
+    struct cfglog_rec rec;
+    flash_t flash;
+    uint32_t addr;
+    int result;
+
+    if(rec_size(len) > CFGLOG_SECTOR_SIZE || len >= CFGLOG_ERASED){
+        return -1;
+    }
+
+    /* The current sector is full, move on and reclaim the oldest one. The
+     * newest record stays where it is until the new one has been written. */
+    if(cfglog.offset + rec_size(len) > CFGLOG_SECTOR_SIZE){
+        cfglog.sector = (cfglog.sector + 1) % BLINKEN_LOG_SECTORS;
+        cfglog.offset = 0;
+
+        device_mutex_lock(RT_DEV_LOCK_FLASH);
+        flash_erase_sector(&flash, sector_addr(cfglog.sector));
+        device_mutex_unlock(RT_DEV_LOCK_FLASH);
+    }
+
+    rec.magic = CFGLOG_MAGIC;
+    rec.len = (uint16_t) len;
+    rec.seq = cfglog.seq + 1;
+    rec.crc = crc32_update(0, &rec, offsetof(struct cfglog_rec, crc));
+    rec.crc = crc32_update(rec.crc, data, len);
+
+    addr = sector_addr(cfglog.sector) + cfglog.offset;
+
+    /* the space is used up even if writing fails */
+    cfglog.offset += rec_size(len);
+
+    device_mutex_lock(RT_DEV_LOCK_FLASH);
+    result = flash_stream_write(&flash, addr, sizeof(rec), (uint8_t *) &rec);
+    if(result == 1){
+        result = flash_stream_write(&flash, addr + sizeof(rec), len,
+                                    (uint8_t *) data);
+    }
+    device_mutex_unlock(RT_DEV_LOCK_FLASH);
+
+    if(result != 1 || !rec_valid(addr, &rec)){
+        printf("[%s] writing record %u failed\n", __func__,
+               (unsigned int) rec.seq);
+        return -1;
+    }
+
+    cfglog.valid = true;
+    cfglog.addr = addr;
+    cfglog.seq = rec.seq;
+    cfglog.len = rec.len;
+
+    return 0;
+}
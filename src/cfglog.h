@@ -0,0 +1,35 @@
+/**
+ * RTL8710 Blinkenlights. WiFi-controlled WS2812B LED strip.
+ * Copyright (C) 2016  Tido Klaassen <tido@4gh.eu>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+#ifndef __CFGLOG_H__
+#define __CFGLOG_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* Append-only log of config records over a ring of flash sectors. Every
+ * save appends a complete record with a sequence number and CRC, the newest
+ * valid record wins. A sector is only erased when the log has filled the
+ * one before it and moves on, so most saves are a plain program operation.
+ *
+ * Not thread safe, callers have to serialise access. */
+extern int cfglog_init(void);
+extern int cfglog_read(void *data, size_t len);
+extern int cfglog_write(const void *data, size_t len);
+
+#endif
@@ -0,0 +1,69 @@
+/**
+ * RTL8710 Blinkenlights. WiFi-controlled WS2812B LED strip.
+ * Copyright (C) 2016  Tido Klaassen <tido@4gh.eu>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+#include <stdint.h>
+#include "fixmath.h"
+
+#include "fixmath_tab.h"
+
+static inline uint16_t cube16(uint16_t t)
+{
+    return mul16(mul16(t, t), t);
+}
+
+uint16_t ease16(enum ease_curve curve, uint16_t t)
+{
+    uint16_t u;
+    int32_t tmp;
+    uint64_t x;
+
+    u = UINT16_MAX - t;
+
+    switch(curve){
+    case ease_in_quad:
+        return mul16(t, t);
+    case ease_out_quad:
+        return UINT16_MAX - mul16(u, u);
+    case ease_inout_quad:
+        if(t < 0x8000){
+            return 2 * mul16(t, t);
+        }
+        return UINT16_MAX - 2 * mul16(u, u);
+    case ease_in_cubic:
+        return cube16(t);
+    case ease_out_cubic:
+        return UINT16_MAX - cube16(u);
+    case ease_inout_cubic:
+        if(t < 0x8000){
+            return 4 * cube16(t);
+        }
+        return UINT16_MAX - 4 * cube16(u);
+    case ease_smooth:
+        /* in 64 bits, rounding two separate products breaks monotony */
+        x = t + (t >> 15);
+        x = (x * x * (3 * 0x10000 - 2 * x)) >> 32;
+        return x > UINT16_MAX ? UINT16_MAX : (uint16_t) x;
+    case ease_inout_sine:
+        /* (1 - cos(pi * t)) / 2 */
+        tmp = 32767 - fix_cos((t + (t >> 15)) >> 1);
+        return (uint16_t) (tmp + (tmp >> 15));
+    case ease_linear:
+    default:
+        return t;
+    }
+}
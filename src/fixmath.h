@@ -0,0 +1,198 @@
+/**
+ * RTL8710 Blinkenlights. WiFi-controlled WS2812B LED strip.
+ * Copyright (C) 2016  Tido Klaassen <tido@4gh.eu>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+#ifndef __FIXMATH_H__
+#define __FIXMATH_H__
+
+#include <stdint.h>
+
+/* Fixed point helpers for the effects. Q8.8 and Q16.16 are signed numbers
+ * with 8 and 16 fractional bits. Angles are given in 1/65536 turns and
+ * sines are returned in Q15. Easing curves map 0-65535 onto 0-65535. */
+typedef int16_t q8_8_t;
+typedef int32_t q16_16_t;
+
+#define Q8_8_ONE        (1 << 8)
+#define Q16_16_ONE      (1 << 16)
+
+/* The sine table holds a quarter wave in FIX_SIN_STEPS steps, plus the
+ * end point. It is generated by host/gen_sine. */
+#define FIX_SIN_LOG2    8
+#define FIX_SIN_STEPS   (1u << FIX_SIN_LOG2)
+
+extern const int16_t fix_sin_tab[FIX_SIN_STEPS + 1];
+
+enum ease_curve {
+    ease_linear,
+    ease_in_quad,
+    ease_out_quad,
+    ease_inout_quad,
+    ease_in_cubic,
+    ease_out_cubic,
+    ease_inout_cubic,
+    ease_smooth,        // smoothstep, 3t^2 - 2t^3
+    ease_inout_sine,
+    ease_last,
+};
+
+extern uint16_t ease16(enum ease_curve curve, uint16_t t);
+
+/* x * y / 255, rounded */
+static inline uint8_t mul8(uint8_t x, uint8_t y)
+{
+    uint32_t tmp;
+
+    tmp = x * y + 128u;
+
+    return (uint8_t) ((tmp + (tmp >> 8)) >> 8);
+}
+
+/* x * y / 65535, rounded */
+static inline uint16_t mul16(uint16_t x, uint16_t y)
+{
+    uint32_t tmp;
+
+    tmp = (uint32_t) x * y + 32768u;
+
+    return (uint16_t) ((tmp + (tmp >> 16)) >> 16);
+}
+
+static inline uint8_t qadd8(uint8_t x, uint8_t y)
+{
+    uint32_t tmp;
+
+    tmp = x + y;
+
+    return tmp > UINT8_MAX ? UINT8_MAX : (uint8_t) tmp;
+}
+
+static inline uint8_t qsub8(uint8_t x, uint8_t y)
+{
+    return x > y ? x - y : 0;
+}
+
+static inline int16_t sat16(int32_t x)
+{
+    if(x > INT16_MAX){
+        return INT16_MAX;
+    }
+
+    if(x < INT16_MIN){
+        return INT16_MIN;
+    }
+
+    return (int16_t) x;
+}
+
+static inline int32_t sat32(int64_t x)
+{
+    if(x > INT32_MAX){
+        return INT32_MAX;
+    }
+
+    if(x < INT32_MIN){
+        return INT32_MIN;
+    }
+
+    return (int32_t) x;
+}
+
+static inline int16_t qadd16(int16_t x, int16_t y)
+{
+    return sat16((int32_t) x + y);
+}
+
+static inline int16_t qsub16(int16_t x, int16_t y)
+{
+    return sat16((int32_t) x - y);
+}
+
+/* products are truncated towards minus infinity */
+static inline q8_8_t q8_8_mul(q8_8_t x, q8_8_t y)
+{
+    return sat16(((int32_t) x * y) >> 8);
+}
+
+static inline q16_16_t q16_16_mul(q16_16_t x, q16_16_t y)
+{
+    return sat32(((int64_t) x * y) >> 16);
+}
+
+/* t runs from 0 for x to Q8_8_ONE or Q16_16_ONE for y */
+static inline q8_8_t q8_8_lerp(q8_8_t x, q8_8_t y, q8_8_t t)
+{
+    return (q8_8_t) (x + ((((int32_t) y - x) * t) >> 8));
+}
+
+static inline q16_16_t q16_16_lerp(q16_16_t x, q16_16_t y, q16_16_t t)
+{
+    return (q16_16_t) (x + ((((int64_t) y - x) * t) >> 16));
+}
+
+/* t runs from 0 for x to 255 for y */
+static inline uint8_t lerp8(uint8_t x, uint8_t y, uint8_t t)
+{
+    uint32_t tmp;
+
+    tmp = x * (255u - t) + y * t + 128u;
+
+    return (uint8_t) ((tmp + (tmp >> 8)) >> 8);
+}
+
+/* Linear interpolation between the table entries. The table's second
+ * quarter is the first one mirrored, the second half the first one
+ * negated. */
+static inline int16_t fix_sin(uint16_t angle)
+{
+    uint32_t pos, idx, frac;
+    int32_t val;
+
+    pos = angle & 0x3fff;
+    if(angle & 0x4000){
+        pos = 0x4000 - pos;
+    }
+
+    idx = pos >> (14 - FIX_SIN_LOG2);
+    frac = pos & ((1u << (14 - FIX_SIN_LOG2)) - 1);
+
+    val = fix_sin_tab[idx];
+    if(frac != 0){
+        val += ((fix_sin_tab[idx + 1] - val) * (int32_t) frac)
+                    >> (14 - FIX_SIN_LOG2);
+    }
+
+    return (int16_t) ((angle & 0x8000) ? -val : val);
+}
+
+static inline int16_t fix_cos(uint16_t angle)
+{
+    return fix_sin(angle + 0x4000);
+}
+
+/* theta in 1/256 turns, the result is centred around 128 like noise1() */
+static inline uint8_t sin8(uint8_t theta)
+{
+    return (uint8_t) (128 + (fix_sin((uint16_t) (theta << 8)) >> 8));
+}
+
+static inline uint8_t ease8(enum ease_curve curve, uint8_t t)
+{
+    return ease16(curve, (uint16_t) (t * 257u)) >> 8;
+}
+
+#endif
@@ -0,0 +1,390 @@
+/**
+ * RTL8710 Blinkenlights. WiFi-controlled WS2812B LED strip.
+ * Copyright (C) 2016  Tido Klaassen <tido@4gh.eu>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+#include "json.h"
+
+/* what the parser expects next */
+enum json_state
+{
+    st_value,
+    st_key_or_end,      // behind {
+    st_key,             // behind a comma in an object
+    st_value_or_end,    // behind [
+    st_more,            // behind a value in an object or array
+    st_done,            // behind the outermost value
+    st_error,
+};
+
+#define is_space(c) ((c) == ' ' || (c) == '\t' || (c) == '\r' || (c) == '\n')
+#define is_digit(c) ((c) >= '0' && (c) <= '9')
+#define is_xdigit(c) \
+    (is_digit(c) || ((c) >= 'a' && (c) <= 'f') || ((c) >= 'A' && (c) <= 'F'))
+
+void json_init(struct json_parser *p, const char *text, size_t len)
+{
+    memset(p, 0x0, sizeof(*p));
+    p->pos = text;
+    p->end = text + len;
+    p->state = st_value;
+}
+
+static void skip_space(struct json_parser *p)
+{
+    while(p->pos < p->end && is_space(*p->pos)){
+        ++p->pos;
+    }
+}
+
+static bool in_array(const struct json_parser *p)
+{
+    return p->depth > 0 && (p->arrays & (1u << (p->depth - 1)));
+}
+
+/* errors stick, the parser does not try to recover */
+static enum json_type fail(struct json_parser *p, struct json_token *tok)
+{
+    p->state = st_error;
+    tok->type = json_error;
+    tok->start = p->pos;
+    tok->len = 0;
+
+    return json_error;
+}
+
+static enum json_type value_done(struct json_parser *p,
+                                 struct json_token *tok, enum json_type type)
+{
+    p->state = p->depth == 0 ? st_done : st_more;
+    tok->type = type;
+
+    return type;
+}
+
+static enum json_type open_container(struct json_parser *p,
+                                     struct json_token *tok, bool array)
+{
+    if(p->depth >= JSON_MAX_DEPTH){
+        return fail(p, tok);
+    }
+
+    if(array){
+        p->arrays |= 1u << p->depth;
+    }
+
+    ++p->depth;
+    ++p->pos;
+    p->state = array ? st_value_or_end : st_key_or_end;
+    tok->type = array ? json_arr_start : json_obj_start;
+
+    return tok->type;
+}
+
+static enum json_type close_container(struct json_parser *p,
+                                      struct json_token *tok, char c)
+{
+    bool array;
+
+    array = in_array(p);
+    if(p->depth == 0 || c != (array ? ']' : '}')){
+        return fail(p, tok);
+    }
+
+    ++p->pos;
+    --p->depth;
+    p->arrays &= ~(1u << p->depth);
+
+    return value_done(p, tok, array ? json_arr_end : json_obj_end);
+}
+
+/* p->pos is on the opening quote */
+static int scan_string(struct json_parser *p, struct json_token *tok)
+{
+    const char *start;
+    unsigned int i;
+
+    start = ++p->pos;
+    while(p->pos < p->end){
+        switch(*p->pos){
+        case '"':
+            tok->start = start;
+            tok->len = p->pos - start;
+            ++p->pos;
+            return 0;
+        case '\\':
+            if(++p->pos >= p->end){
+                return -1;
+            }
+
+            switch(*p->pos){
+            case '"': case '\\': case '/':
+            case 'b': case 'f': case 'n': case 'r': case 't':
+                break;
+            case 'u':
+                for(i = 1; i <= 4; ++i){
+                    if(p->pos + i >= p->end || !is_xdigit(p->pos[i])){
+                        return -1;
+                    }
+                }
+
+                p->pos += 4;
+                break;
+            default:
+                return -1;
+            }
+            break;
+        default:
+            if((unsigned char) *p->pos < 0x20){
+                return -1;
+            }
+            break;
+        }
+
+        ++p->pos;
+    }
+
+    return -1;
+}
+
+static int scan_digits(struct json_parser *p)
+{
+    const char *start;
+
+    start = p->pos;
+    while(p->pos < p->end && is_digit(*p->pos)){
+        ++p->pos;
+    }
+
+    return p->pos > start ? 0 : -1;
+}
+
+static int scan_number(struct json_parser *p, struct json_token *tok)
+{
+    tok->start = p->pos;
+
+    if(*p->pos == '-'){
+        ++p->pos;
+    }
+
+    /* no leading zeros */
+    if(p->pos < p->end && *p->pos == '0'){
+        ++p->pos;
+    }else if(scan_digits(p) != 0){
+        return -1;
+    }
+
+    if(p->pos < p->end && *p->pos == '.'){
+        ++p->pos;
+        if(scan_digits(p) != 0){
+            return -1;
+        }
+    }
+
+    if(p->pos < p->end && (*p->pos == 'e' || *p->pos == 'E')){
+        ++p->pos;
+        if(p->pos < p->end && (*p->pos == '+' || *p->pos == '-')){
+            ++p->pos;
+        }
+
+        if(scan_digits(p) != 0){
+            return -1;
+        }
+    }
+
+    tok->len = p->pos - tok->start;
+
+    return 0;
+}
+
+static int scan_literal(struct json_parser *p, struct json_token *tok)
+{
+    static const char *const literals[] = { "true", "false", "null" };
+    unsigned int i;
+    size_t len;
+
+    for(i = 0; i < sizeof(literals) / sizeof(*literals); ++i){
+        len = strlen(literals[i]);
+        if((size_t) (p->end - p->pos) >= len
+                && !memcmp(p->pos, literals[i], len)){
+            tok->start = p->pos;
+            tok->len = len;
+            p->pos += len;
+            return 0;
+        }
+    }
+
+    return -1;
+}
+
+static enum json_type scan_value(struct json_parser *p,
+                                 struct json_token *tok)
+{
+    switch(*p->pos){
+    case '{':
+        return open_container(p, tok, false);
+    case '[':
+        return open_container(p, tok, true);
+    case '"':
+        if(scan_string(p, tok) == 0){
+            return value_done(p, tok, json_string);
+        }
+        break;
+    case 't': case 'f': case 'n':
+        if(scan_literal(p, tok) == 0){
+            return value_done(p, tok, json_literal);
+        }
+        break;
+    default:
+        if(*p->pos == '-' || is_digit(*p->pos)){
+            if(scan_number(p, tok) == 0){
+                return value_done(p, tok, json_number);
+            }
+        }
+        break;
+    }
+
+    return fail(p, tok);
+}
+
+enum json_type json_next(struct json_parser *p, struct json_token *tok)
+{
+    skip_space(p);
+    tok->start = p->pos;
+    tok->len = 0;
+
+    if(p->state == st_more && p->pos < p->end && *p->pos == ','){
+        ++p->pos;
+        skip_space(p);
+        p->state = in_array(p) ? st_value : st_key;
+    }
+
+    if(p->pos >= p->end){
+        if(p->state == st_done){
+            tok->type = json_end;
+            return json_end;
+        }
+
+        return fail(p, tok);
+    }
+
+    switch(p->state){
+    case st_more:
+        return close_container(p, tok, *p->pos);
+    case st_key_or_end:
+        if(*p->pos == '}'){
+            return close_container(p, tok, *p->pos);
+        }
+        /* fall through */
+    case st_key:
+        if(*p->pos != '"' || scan_string(p, tok) != 0){
+            break;
+        }
+
+        skip_space(p);
+        if(p->pos >= p->end || *p->pos != ':'){
+            break;
+        }
+
+        ++p->pos;
+        p->state = st_value;
+        tok->type = json_key;
+        return json_key;
+    case st_value_or_end:
+        if(*p->pos == ']'){
+            return close_container(p, tok, *p->pos);
+        }
+        /* fall through */
+    case st_value:
+        return scan_value(p, tok);
+    default:
+        break;
+    }
+
+    return fail(p, tok);
+}
+
+int json_skip(struct json_parser *p, const struct json_token *tok)
+{
+    struct json_token next;
+    enum json_type type;
+    unsigned int depth;
+
+    if(tok->type == json_error){
+        return -1;
+    }
+
+    if(tok->type != json_obj_start && tok->type != json_arr_start){
+        return 0;
+    }
+
+    depth = p->depth;
+    while(p->depth >= depth){
+        type = json_next(p, &next);
+        if(type == json_error || type == json_end){
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+int json_int(const struct json_token *tok, int32_t *value)
+{
+    const char *pos, *end;
+    int64_t val;
+    bool neg;
+
+    if(tok->type != json_number){
+        return -1;
+    }
+
+    pos = tok->start;
+    end = tok->start + tok->len;
+
+    neg = *pos == '-';
+    if(neg){
+        ++pos;
+    }
+
+    val = 0;
+    while(pos < end && is_digit(*pos)){
+        val = val * 10 + (*pos - '0');
+        if(val > (int64_t) INT32_MAX + 1){
+            return -1;
+        }
+
+        ++pos;
+    }
+
+    /* fraction or exponent */
+    if(pos != end){
+        return -1;
+    }
+
+    val = neg ? -val : val;
+    if(val > INT32_MAX){
+        return -1;
+    }
+
+    *value = (int32_t) val;
+
+    return 0;
+}
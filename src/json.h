@@ -0,0 +1,76 @@
+/**
+ * RTL8710 Blinkenlights. WiFi-controlled WS2812B LED strip.
+ * Copyright (C) 2016  Tido Klaassen <tido@4gh.eu>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+#ifndef __JSON_H__
+#define __JSON_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* nesting of objects and arrays, one bit per level */
+#define JSON_MAX_DEPTH  32
+
+enum json_type
+{
+    json_error,
+    json_end,           // end of input after a complete value
+    json_obj_start,
+    json_obj_end,
+    json_arr_start,
+    json_arr_end,
+    json_key,
+    json_string,
+    json_number,
+    json_literal,       // true, false or null
+};
+
+/* Strings and keys are given without the quotes and escapes are left as
+ * they are. On errors, start points to where the input went wrong. */
+struct json_token
+{
+    enum json_type type;
+    const char *start;
+    size_t len;
+};
+
+struct json_parser
+{
+    const char *pos;
+    const char *end;
+    uint32_t arrays;    // bit set for each level that is an array
+    unsigned int depth;
+    unsigned int state;
+};
+
+/* A single pass over the text, which is not modified and need not be
+ * terminated. Each call returns the next token, the parser checks the
+ * syntax on the way, so commas and colons are never seen by the caller.
+ * Nothing is allocated and the text is only read once. */
+extern void json_init(struct json_parser *p, const char *text, size_t len);
+extern enum json_type json_next(struct json_parser *p,
+                                struct json_token *tok);
+
+/* Skip the rest of a value whose first token was tok. Returns -1 if the
+ * input ends or is not valid before the value does. */
+extern int json_skip(struct json_parser *p, const struct json_token *tok);
+
+/* Value of a number token, -1 if it has a fraction or exponent or does not
+ * fit into an int32_t. */
+extern int json_int(const struct json_token *tok, int32_t *value);
+
+#endif
@@ -0,0 +1,204 @@
+/**
+ * RTL8710 Blinkenlights. WiFi-controlled WS2812B LED strip.
+ * Copyright (C) 2016  Tido Klaassen <tido@4gh.eu>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+#include <stdint.h>
+#include "noise.h"
+
+/* Ken Perlin's reference permutation */
+static const uint8_t perm[256] = {
+    151, 160, 137,  91,  90,  15, 131,  13, 201,  95,  96,  53,
+    194, 233,   7, 225, 140,  36, 103,  30,  69, 142,   8,  99,
+     37, 240,  21,  10,  23, 190,   6, 148, 247, 120, 234,  75,
+      0,  26, 197,  62,  94, 252, 219, 203, 117,  35,  11,  32,
+     57, 177,  33,  88, 237, 149,  56,  87, 174,  20, 125, 136,
+    171, 168,  68, 175,  74, 165,  71, 134, 139,  48,  27, 166,
+     77, 146, 158, 231,  83, 111, 229, 122,  60, 211, 133, 230,
+    220, 105,  92,  41,  55,  46, 245,  40, 244, 102, 143,  54,
+     65,  25,  63, 161,   1, 216,  80,  73, 209,  76, 132, 187,
+    208,  89,  18, 169, 200, 196, 135, 130, 116, 188, 159,  86,
+    164, 100, 109, 198, 173, 186,   3,  64,  52, 217, 226, 250,
+    124, 123,   5, 202,  38, 147, 118, 126, 255,  82,  85, 212,
+    207, 206,  59, 227,  47,  16,  58,  17, 182, 189,  28,  42,
+    223, 183, 170, 213, 119, 248, 152,   2,  44, 154, 163,  70,
+    221, 153, 101, 155, 167,  43, 172,   9, 129,  22,  39, 253,
+     19,  98, 108, 110,  79, 113, 224, 232, 178, 185, 112, 104,
+    218, 246,  97, 228, 251,  34, 242, 193, 238, 210, 144,  12,
+    191, 179, 162, 241,  81,  51, 145, 235, 249,  14, 239, 107,
+     49, 192, 214,  31, 181, 199, 106, 157, 184,  84, 204, 176,
+    115, 121,  50,  45, 127,   4, 150, 254, 138, 236, 205,  93,
+    222, 114,  67,  29,  24,  72, 243, 141, 128, 195,  78,  66,
+    215,  61, 156, 180,
+};
+
+/* 6t^5 - 15t^4 + 10t^3, scaled to 0-255 */
+static const uint8_t fade_tab[256] = {
+      0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+      0,   0,   0,   0,   1,   1,   1,   1,   1,   1,   1,   2,
+      2,   2,   2,   3,   3,   3,   3,   4,   4,   4,   5,   5,
+      6,   6,   7,   7,   8,   8,   9,   9,  10,  10,  11,  12,
+     12,  13,  14,  15,  15,  16,  17,  18,  19,  20,  21,  22,
+     22,  23,  24,  25,  26,  28,  29,  30,  31,  32,  33,  34,
+     36,  37,  38,  39,  41,  42,  43,  45,  46,  47,  49,  50,
+     52,  53,  55,  56,  58,  59,  61,  62,  64,  66,  67,  69,
+     70,  72,  74,  75,  77,  79,  81,  82,  84,  86,  88,  89,
+     91,  93,  95,  96,  98, 100, 102, 104, 106, 107, 109, 111,
+    113, 115, 117, 119, 121, 122, 124, 126, 128, 130, 132, 134,
+    135, 137, 139, 141, 143, 145, 147, 149, 150, 152, 154, 156,
+    158, 160, 161, 163, 165, 167, 168, 170, 172, 174, 175, 177,
+    179, 181, 182, 184, 186, 187, 189, 190, 192, 194, 195, 197,
+    198, 200, 201, 203, 204, 206, 207, 209, 210, 211, 213, 214,
+    215, 217, 218, 219, 220, 222, 223, 224, 225, 226, 227, 228,
+    230, 231, 232, 233, 234, 234, 235, 236, 237, 238, 239, 240,
+    241, 241, 242, 243, 244, 244, 245, 246, 246, 247, 247, 248,
+    248, 249, 249, 250, 250, 251, 251, 252, 252, 252, 253, 253,
+    253, 253, 254, 254, 254, 254, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255,
+};
+
+static const int8_t grad1_tab[8] = { 1, 2, 3, 4, -1, -2, -3, -4 };
+
+static const int8_t grad2_tab[8][2] = {
+    {  1,  1 }, { -1,  1 }, {  1, -1 }, { -1, -1 },
+    {  1,  0 }, { -1,  0 }, {  0,  1 }, {  0, -1 },
+};
+
+/* the twelve cube edge directions, padded to 16 entries */
+static const int8_t grad3_tab[16][3] = {
+    {  1,  1,  0 }, { -1,  1,  0 }, {  1, -1,  0 }, { -1, -1,  0 },
+    {  1,  0,  1 }, { -1,  0,  1 }, {  1,  0, -1 }, { -1,  0, -1 },
+    {  0,  1,  1 }, {  0, -1,  1 }, {  0,  1, -1 }, {  0, -1, -1 },
+    {  1,  1,  0 }, {  0, -1,  1 }, { -1,  1,  0 }, {  0, -1, -1 },
+};
+
+#define P(x)        perm[(x) & 0xff]
+
+/* shifts that bring the raw results of each dimension to +/-128 */
+#define NOISE1_SHIFT    2
+#define NOISE2_SHIFT    1
+#define NOISE3_SHIFT    1
+
+static inline int32_t lerp(int32_t a, int32_t b, uint8_t t)
+{
+    return a + (((b - a) * t) >> 8);
+}
+
+static inline int32_t grad1(uint8_t hash, int32_t x)
+{
+    return grad1_tab[hash & 0x7] * x;
+}
+
+static inline int32_t grad2(uint8_t hash, int32_t x, int32_t y)
+{
+    const int8_t *g = grad2_tab[hash & 0x7];
+
+    return g[0] * x + g[1] * y;
+}
+
+static inline int32_t grad3(uint8_t hash, int32_t x, int32_t y, int32_t z)
+{
+    const int8_t *g = grad3_tab[hash & 0xf];
+
+    return g[0] * x + g[1] * y + g[2] * z;
+}
+
+/* map a signed noise value to 0-255 */
+static inline uint8_t to_u8(int32_t val, unsigned int shift)
+{
+    val = 128 + (val >> shift);
+
+    if(val < 0){
+        val = 0;
+    }else if(val > 255){
+        val = 255;
+    }
+
+    return (uint8_t) val;
+}
+
+uint8_t noise1(uint32_t x)
+{
+    uint32_t xi;
+    int32_t fx, a, b;
+
+    xi = x >> 8;
+    fx = x & 0xff;
+
+    a = grad1(P(xi), fx);
+    b = grad1(P(xi + 1), fx - 256);
+
+    return to_u8(lerp(a, b, fade_tab[fx]), NOISE1_SHIFT);
+}
+
+uint8_t noise2(uint32_t x, uint32_t y)
+{
+    uint32_t xi, yi;
+    int32_t fx, fy, a, b;
+    uint8_t u, v, h0, h1;
+
+    xi = x >> 8;
+    yi = y >> 8;
+    fx = x & 0xff;
+    fy = y & 0xff;
+    u = fade_tab[fx];
+    v = fade_tab[fy];
+
+    h0 = P(xi) + yi;
+    h1 = P(xi + 1) + yi;
+
+    a = lerp(grad2(P(h0), fx, fy), grad2(P(h1), fx - 256, fy), u);
+    b = lerp(grad2(P(h0 + 1), fx, fy - 256),
+             grad2(P(h1 + 1), fx - 256, fy - 256), u);
+
+    return to_u8(lerp(a, b, v), NOISE2_SHIFT);
+}
+
+uint8_t noise3(uint32_t x, uint32_t y, uint32_t z)
+{
+    uint32_t xi, yi, zi;
+    int32_t fx, fy, fz, a, b, c, d;
+    uint8_t u, v, w, h0, h1, h00, h01, h10, h11;
+
+    xi = x >> 8;
+    yi = y >> 8;
+    zi = z >> 8;
+    fx = x & 0xff;
+    fy = y & 0xff;
+    fz = z & 0xff;
+    u = fade_tab[fx];
+    v = fade_tab[fy];
+    w = fade_tab[fz];
+
+    h0 = P(xi) + yi;
+    h1 = P(xi + 1) + yi;
+    h00 = P(h0) + zi;
+    h01 = P(h0 + 1) + zi;
+    h10 = P(h1) + zi;
+    h11 = P(h1 + 1) + zi;
+
+    a = lerp(grad3(P(h00), fx, fy, fz),
+             grad3(P(h10), fx - 256, fy, fz), u);
+    b = lerp(grad3(P(h01), fx, fy - 256, fz),
+             grad3(P(h11), fx - 256, fy - 256, fz), u);
+    c = lerp(grad3(P(h00 + 1), fx, fy, fz - 256),
+             grad3(P(h10 + 1), fx - 256, fy, fz - 256), u);
+    d = lerp(grad3(P(h01 + 1), fx, fy - 256, fz - 256),
+             grad3(P(h11 + 1), fx - 256, fy - 256, fz - 256), u);
+
+    return to_u8(lerp(lerp(a, b, v), lerp(c, d, v), w), NOISE3_SHIFT);
+}
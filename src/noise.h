@@ -0,0 +1,31 @@
+/**
+ * RTL8710 Blinkenlights. WiFi-controlled WS2812B LED strip.
+ * Copyright (C) 2016  Tido Klaassen <tido@4gh.eu>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+#ifndef __NOISE_H__
+#define __NOISE_H__
+
+#include <stdint.h>
+
+/* Integer gradient noise. Coordinates are fixed point with 8 fractional
+ * bits, the integer part selects the lattice cell. All functions return
+ * values in the range 0-255, centred around 128. */
+extern uint8_t noise1(uint32_t x);
+extern uint8_t noise2(uint32_t x, uint32_t y);
+extern uint8_t noise3(uint32_t x, uint32_t y, uint32_t z);
+
+#endif
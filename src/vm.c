@@ -0,0 +1,390 @@
+/**
+ * RTL8710 Blinkenlights. WiFi-controlled WS2812B LED strip.
+ * Copyright (C) 2016  Tido Klaassen <tido@4gh.eu>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+#include <stdint.h>
+#include <string.h>
+#include "crc32.h"
+#include "noise.h"
+#include "fixmath.h"
+#include "vm.h"
+
+#ifndef min
+#define min(a,b)            ((a) < (b) ? (a) : (b))
+#define max(a,b)            ((a) > (b) ? (a) : (b))
+#endif
+
+const struct vm_opinfo vm_opinfo[VM_OP_LAST] = {
+    [VM_END]    = { "end",      0, 0, 0 },
+    [VM_PUSH8]  = { "push8",    1, 0, 1 },
+    [VM_PUSH16] = { "push16",   2, 0, 1 },
+    [VM_PUSH32] = { "push32",   4, 0, 1 },
+    [VM_DUP]    = { "dup",      0, 1, 2 },
+    [VM_DROP]   = { "drop",     0, 1, 0 },
+    [VM_SWAP]   = { "swap",     0, 2, 2 },
+    [VM_OVER]   = { "over",     0, 2, 3 },
+    [VM_ADD]    = { "add",      0, 2, 1 },
+    [VM_SUB]    = { "sub",      0, 2, 1 },
+    [VM_MUL]    = { "mul",      0, 2, 1 },
+    [VM_DIV]    = { "div",      0, 2, 1 },
+    [VM_MOD]    = { "mod",      0, 2, 1 },
+    [VM_NEG]    = { "neg",      0, 1, 1 },
+    [VM_ABS]    = { "abs",      0, 1, 1 },
+    [VM_MIN]    = { "min",      0, 2, 1 },
+    [VM_MAX]    = { "max",      0, 2, 1 },
+    [VM_FLOOR]  = { "floor",    0, 1, 1 },
+    [VM_FRAC]   = { "frac",     0, 1, 1 },
+    [VM_LT]     = { "lt",       0, 2, 1 },
+    [VM_GT]     = { "gt",       0, 2, 1 },
+    [VM_EQ]     = { "eq",       0, 2, 1 },
+    [VM_NOT]    = { "not",      0, 1, 1 },
+    [VM_JMP]    = { "jmp",      2, 0, 0 },
+    [VM_JZ]     = { "jz",       2, 1, 0 },
+    [VM_JNZ]    = { "jnz",      2, 1, 0 },
+    [VM_LD]     = { "ld",       1, 0, 1 },
+    [VM_ST]     = { "st",       1, 1, 0 },
+    [VM_IDX]    = { "idx",      0, 0, 1 },
+    [VM_LEN]    = { "len",      0, 0, 1 },
+    [VM_POS]    = { "pos",      0, 0, 1 },
+    [VM_TIME]   = { "time",     0, 0, 1 },
+    [VM_DT]     = { "dt",       0, 0, 1 },
+    [VM_SIN]    = { "sin",      0, 1, 1 },
+    [VM_NOISE]  = { "noise",    0, 2, 1 },
+    [VM_RAND]   = { "rand",     0, 0, 1 },
+    [VM_GET]    = { "get",      0, 0, 3 },
+    [VM_HSV]    = { "hsv",      0, 3, 0 },
+    [VM_PUT]    = { "put",      0, 4, 0 },
+};
+
+/* sine of an angle given in 1/256 turns, scaled to +-256. Rounded
+ * symmetrically, so both halves of the wave are mirror images. */
+static int32_t vm_sin(int32_t angle)
+{
+    int32_t val;
+
+    val = fix_sin((uint16_t) ((uint32_t) angle << 8));
+
+    return val < 0 ? -((64 - val) >> 7) : (val + 64) >> 7;
+}
+
+static uint32_t vm_rand(struct vm_state *vm)
+{
+    uint32_t x;
+
+    x = vm->seed;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    vm->seed = x;
+
+    return x;
+}
+
+static inline uint16_t rd16(const uint8_t *p)
+{
+    return (uint16_t) (p[0] | (p[1] << 8));
+}
+
+static inline uint32_t rd32(const uint8_t *p)
+{
+    return (uint32_t) p[0] | ((uint32_t) p[1] << 8)
+            | ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+static inline uint8_t to_u8(int32_t val)
+{
+    return (uint8_t) (val < 0 ? 0 : min(val, 255));
+}
+
+/* Check a program before it is run, so the interpreter only has to check
+ * the stack depth. len is the number of bytes available, header included. */
+int vm_verify(const struct vm_program *prog, size_t len)
+{
+    uint8_t starts[VM_MAX_CODE / 8];
+    const uint8_t *code;
+    unsigned int pc, code_len, target;
+    uint8_t op;
+
+    if(len < sizeof(prog->hdr)
+       || prog->hdr.magic != VM_MAGIC
+       || prog->hdr.version != VM_VERSION
+       || prog->hdr.mode >= vm_mode_last
+       || prog->hdr.code_len > VM_MAX_CODE
+       || prog->hdr.code_len > len - sizeof(prog->hdr)){
+        return -1;
+    }
+
+    code = prog->code;
+    code_len = prog->hdr.code_len;
+
+    if(crc32_update(0, code, code_len) != prog->hdr.crc){
+        return -1;
+    }
+
+    /* first pass: decode all instructions and note where they start */
+    memset(starts, 0x0, sizeof(starts));
+    for(pc = 0; pc < code_len; pc += 1 + vm_opinfo[op].imm){
+        op = code[pc];
+        if(op >= VM_OP_LAST || pc + vm_opinfo[op].imm >= code_len){
+            return -1;
+        }
+
+        if((op == VM_LD || op == VM_ST) && code[pc + 1] >= VM_NUM_REGS){
+            return -1;
+        }
+
+        starts[pc / 8] |= 1u << (pc % 8);
+    }
+
+    /* second pass: jumps must land on an instruction or the end of code */
+    for(pc = 0; pc < code_len; pc += 1 + vm_opinfo[op].imm){
+        op = code[pc];
+        if(op != VM_JMP && op != VM_JZ && op != VM_JNZ){
+            continue;
+        }
+
+        target = rd16(&code[pc + 1]);
+        if(target > code_len){
+            return -1;
+        }
+
+        if(target < code_len && !(starts[target / 8] & (1u << (target % 8)))){
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+void vm_reset(struct vm_state *vm, uint32_t budget, uint32_t seed)
+{
+    memset(vm, 0x0, sizeof(*vm));
+    vm->budget = budget;
+    vm->seed = seed != 0 ? seed : 1u;
+}
+
+int vm_run(const struct vm_program *prog, struct vm_state *vm,
+           const struct vm_env *env, uint8_t hsv[], unsigned int len)
+{
+    int32_t stack[VM_STACK_DEPTH];
+    const struct vm_opinfo *info;
+    const uint8_t *code;
+    unsigned int pc, sp, end, i, runs, idx;
+    uint32_t left;
+    int32_t a, b;
+    uint8_t op;
+    int result;
+
+    result = 0;
+    code = prog->code;
+    end = prog->hdr.code_len;
+    left = vm->budget;
+
+    runs = prog->hdr.mode == vm_frame ? 1 : len;
+    if(len == 0){
+        runs = 0;
+    }
+
+    for(i = 0; i < runs; ++i){
+        pc = 0;
+        sp = 0;
+
+        while(pc < end){
+            if(left == 0){
+                ++vm->overruns;
+                result = 1;
+                goto out;
+            }
+            --left;
+
+            op = code[pc];
+            info = &vm_opinfo[op];
+            if(sp < info->pop || sp - info->pop + info->push > VM_STACK_DEPTH){
+                vm->fault = "stack";
+                goto fault;
+            }
+
+            switch(op){
+            case VM_END:
+                pc = end;
+                continue;
+            case VM_PUSH8:
+                stack[sp++] = (int8_t) code[pc + 1];
+                break;
+            case VM_PUSH16:
+                stack[sp++] = (int16_t) rd16(&code[pc + 1]);
+                break;
+            case VM_PUSH32:
+                stack[sp++] = (int32_t) rd32(&code[pc + 1]);
+                break;
+            case VM_DUP:
+                stack[sp] = stack[sp - 1];
+                ++sp;
+                break;
+            case VM_DROP:
+                --sp;
+                break;
+            case VM_SWAP:
+                a = stack[sp - 1];
+                stack[sp - 1] = stack[sp - 2];
+                stack[sp - 2] = a;
+                break;
+            case VM_OVER:
+                stack[sp] = stack[sp - 2];
+                ++sp;
+                break;
+            case VM_ADD:
+                b = stack[--sp];
+                stack[sp - 1] = (int32_t) ((uint32_t) stack[sp - 1] + b);
+                break;
+            case VM_SUB:
+                b = stack[--sp];
+                stack[sp - 1] = (int32_t) ((uint32_t) stack[sp - 1] - b);
+                break;
+            case VM_MUL:
+                b = stack[--sp];
+                stack[sp - 1] = (int32_t) (((int64_t) stack[sp - 1] * b) >> 8);
+                break;
+            case VM_DIV:
+            case VM_MOD:
+                b = stack[--sp];
+                if(b == 0){
+                    vm->fault = "division by zero";
+                    goto fault;
+                }
+
+                if(op == VM_DIV){
+                    stack[sp - 1] = (int32_t) (((int64_t) stack[sp - 1]
+                                                    * 256) / b);
+                } else {
+                    stack[sp - 1] = (int32_t) ((int64_t) stack[sp - 1] % b);
+                }
+                break;
+            case VM_NEG:
+                stack[sp - 1] = (int32_t) (0u - (uint32_t) stack[sp - 1]);
+                break;
+            case VM_ABS:
+                a = stack[sp - 1];
+                stack[sp - 1] = a < 0 ? (int32_t) (0u - (uint32_t) a) : a;
+                break;
+            case VM_MIN:
+                b = stack[--sp];
+                stack[sp - 1] = min(stack[sp - 1], b);
+                break;
+            case VM_MAX:
+                b = stack[--sp];
+                stack[sp - 1] = max(stack[sp - 1], b);
+                break;
+            case VM_FLOOR:
+                stack[sp - 1] &= ~0xff;
+                break;
+            case VM_FRAC:
+                stack[sp - 1] &= 0xff;
+                break;
+            case VM_LT:
+                b = stack[--sp];
+                stack[sp - 1] = stack[sp - 1] < b ? 256 : 0;
+                break;
+            case VM_GT:
+                b = stack[--sp];
+                stack[sp - 1] = stack[sp - 1] > b ? 256 : 0;
+                break;
+            case VM_EQ:
+                b = stack[--sp];
+                stack[sp - 1] = stack[sp - 1] == b ? 256 : 0;
+                break;
+            case VM_NOT:
+                stack[sp - 1] = stack[sp - 1] == 0 ? 256 : 0;
+                break;
+            case VM_JMP:
+                pc = rd16(&code[pc + 1]);
+                continue;
+            case VM_JZ:
+            case VM_JNZ:
+                a = stack[--sp];
+                if((a == 0) == (op == VM_JZ)){
+                    pc = rd16(&code[pc + 1]);
+                    continue;
+                }
+                break;
+            case VM_LD:
+                stack[sp++] = vm->regs[code[pc + 1]];
+                break;
+            case VM_ST:
+                vm->regs[code[pc + 1]] = stack[--sp];
+                break;
+            case VM_IDX:
+                stack[sp++] = (int32_t) (i << 8);
+                break;
+            case VM_LEN:
+                stack[sp++] = (int32_t) (len << 8);
+                break;
+            case VM_POS:
+                stack[sp++] = (int32_t) ((i << 8) / len);
+                break;
+            case VM_TIME:
+                stack[sp++] = env->time;
+                break;
+            case VM_DT:
+                stack[sp++] = env->delta;
+                break;
+            case VM_SIN:
+                stack[sp - 1] = vm_sin(stack[sp - 1]);
+                break;
+            case VM_NOISE:
+                b = stack[--sp];
+                a = stack[sp - 1];
+                stack[sp - 1] = noise2((uint32_t) a, (uint32_t) b);
+                break;
+            case VM_RAND:
+                stack[sp++] = vm_rand(vm) & 0xff;
+                break;
+            case VM_GET:
+                stack[sp++] = hsv[i * 3];
+                stack[sp++] = hsv[i * 3 + 1];
+                stack[sp++] = hsv[i * 3 + 2];
+                break;
+            case VM_HSV:
+                hsv[i * 3 + 2] = to_u8(stack[--sp]);
+                hsv[i * 3 + 1] = to_u8(stack[--sp]);
+                hsv[i * 3] = (uint8_t) stack[--sp];
+                break;
+            case VM_PUT:
+                sp -= 4;
+                a = stack[sp] >> 8;
+                if(a >= 0 && (unsigned int) a < len){
+                    idx = (unsigned int) a * 3;
+                    hsv[idx] = (uint8_t) stack[sp + 1];
+                    hsv[idx + 1] = to_u8(stack[sp + 2]);
+                    hsv[idx + 2] = to_u8(stack[sp + 3]);
+                }
+                break;
+            }
+
+            pc += 1 + info->imm;
+        }
+    }
+
+out:
+    vm->used = vm->budget - left;
+    return result;
+
+fault:
+    vm->fault_pc = pc;
+    vm->used = vm->budget - left;
+    return -1;
+}
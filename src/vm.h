@@ -0,0 +1,136 @@
+/**
+ * RTL8710 Blinkenlights. WiFi-controlled WS2812B LED strip.
+ * Copyright (C) 2016  Tido Klaassen <tido@4gh.eu>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+#ifndef __VM_H__
+#define __VM_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* Effect programs are run by a small stack machine. All values are signed
+ * fixed point numbers with 8 fractional bits, so 1.0 is 256. Hues are given
+ * in turns, i.e. 1.0 is a full circle. */
+#define VM_MAGIC            0x4D564B42 // "BKVM"
+#define VM_VERSION          1
+#define VM_MAX_CODE         1024
+#define VM_STACK_DEPTH      16
+#define VM_NUM_REGS         8
+
+/* Instructions a program may execute per frame and filter. A program that
+ * runs out of budget is stopped, pixels not reached keep their values. */
+#define VM_BUDGET_DEF       4096
+#define VM_BUDGET_MAX       16384
+
+enum vm_mode {
+    vm_pixel,           // program is run once for every pixel
+    vm_frame,           // program is run once per frame
+    vm_mode_last,
+};
+
+enum vm_opcode {
+    VM_END,
+    VM_PUSH8,
+    VM_PUSH16,
+    VM_PUSH32,
+    VM_DUP,
+    VM_DROP,
+    VM_SWAP,
+    VM_OVER,
+    VM_ADD,
+    VM_SUB,
+    VM_MUL,
+    VM_DIV,
+    VM_MOD,
+    VM_NEG,
+    VM_ABS,
+    VM_MIN,
+    VM_MAX,
+    VM_FLOOR,
+    VM_FRAC,
+    VM_LT,
+    VM_GT,
+    VM_EQ,
+    VM_NOT,
+    VM_JMP,
+    VM_JZ,
+    VM_JNZ,
+    VM_LD,
+    VM_ST,
+    VM_IDX,
+    VM_LEN,
+    VM_POS,
+    VM_TIME,
+    VM_DT,
+    VM_SIN,
+    VM_NOISE,
+    VM_RAND,
+    VM_GET,
+    VM_HSV,
+    VM_PUT,
+    VM_OP_LAST,
+};
+
+struct vm_opinfo {
+    const char *name;
+    uint8_t imm;        // bytes of immediate data following the opcode
+    uint8_t pop;
+    uint8_t push;
+};
+
+extern const struct vm_opinfo vm_opinfo[VM_OP_LAST];
+
+/* Programs are stored and uploaded as the header followed by code_len bytes
+ * of code. Immediates are little endian, jump targets are absolute. */
+struct vm_header {
+    uint32_t magic;
+    uint8_t  version;
+    uint8_t  mode;
+    uint16_t code_len;
+    uint32_t crc;       // CRC-32 of the code
+} __attribute__((packed));
+
+struct vm_program {
+    struct vm_header hdr;
+    uint8_t code[VM_MAX_CODE];
+} __attribute__((packed));
+
+struct vm_state {
+    int32_t regs[VM_NUM_REGS];
+    uint32_t seed;
+    uint32_t budget;
+    uint32_t used;      // instructions executed by the last run
+    uint32_t overruns;
+    uint32_t fault_pc;
+    const char *fault;
+};
+
+struct vm_env {
+    int32_t time;       // animation time in seconds
+    int32_t delta;      // time since the last frame in seconds
+};
+
+extern int vm_verify(const struct vm_program *prog, size_t len);
+extern void vm_reset(struct vm_state *vm, uint32_t budget, uint32_t seed);
+
+/* Run a verified program over len pixels given as hue, saturation and value
+ * triplets, just like hsvValue_t. Returns 0 if the program completed, 1 if
+ * it ran out of budget and -1 on a fault. */
+extern int vm_run(const struct vm_program *prog, struct vm_state *vm,
+                  const struct vm_env *env, uint8_t hsv[], unsigned int len);
+
+#endif
@@ -64,9 +64,8 @@ static void master_tr_done_callback(void *pdata, SpiIrq event)
     }
 }
 
-static void hsv2rgb(hsvValue_t *hsv, rgbValue_t *rgb)
+void ws2812_hsv2rgb(const hsvValue_t *hsv, rgbValue_t *rgb)
 {
-    uint8_t r, g, b;
     uint8_t hue, sat, val;
     uint8_t base, sector, offset;
     uint8_t rise, fall;
@@ -171,9 +170,10 @@ static int ws2812_tx(ws2812_t *cfg, uint16_t delay)
         goto err_out;
     }
 
+    /* the buffer is locked, only the DMA reads it from here on */
     xEventGroupClearBits(cfg->events, BIT_DONE);
     spi_master_write_stream_dma(&cfg->spi_master,
-                                &(cfg->dma_buff[0]),
+                                (char *) &(cfg->dma_buff[0]),
                                 cfg->buff_len);
 
     timeout = 1000 / portTICK_PERIOD_MS;
@@ -197,15 +197,13 @@ err_out:
     return result;
 }
 
-int ws2812_send(ws2812_t *cfg, hsvValue_t hsv_values[],
-                unsigned int strip_len, uint16_t delay)
+/* Wait for the DMA buffer to become idle and lock it for filling. The
+ * buffer is only volatile because the DMA reads it. While it is idle and
+ * locked nothing else touches it, so it can be filled through a plain
+ * pointer. Returns NULL if the lock could not be taken. */
+static uint8_t *ws2812_lock_buff(ws2812_t *cfg)
 {
-    uint32_t i;
-    uint8_t *bufp;
-    uint16_t len, empty;
     BaseType_t status;
-    int result;
-    rgbValue_t rgb;
 
     /* make sure DMA buffer is not in use */
     while(cfg->spi_master.state & SPI_STATE_TX_BUSY){
@@ -216,37 +214,117 @@ int ws2812_send(ws2812_t *cfg, hsvValue_t hsv_values[],
     status = xSemaphoreTake(cfg->mutex, configTICK_RATE_HZ);
     if(status != pdTRUE){
         printf("[%s] Timeout waiting for config mutex.\n", __func__);
+        return NULL;
+    }
+
+    return (uint8_t *) &(cfg->dma_buff[0]);
+}
+
+/* blank unused pixels, add the reset pulse and send the buffer off */
+static int ws2812_flush_buff(ws2812_t *cfg, uint8_t *bufp, uint16_t len,
+                             uint16_t delay)
+{
+    /* turn unused pixels at end of strip off */ 
+    if(cfg->strip_len > len){
+        memset(bufp, WS_BITS_00, (cfg->strip_len - len) * 3 * 4);
+        bufp += (cfg->strip_len - len) * 3 * 4;
+    }
+
+    /* add reset pulse */
+    memset(bufp, 0x0, WS2812_RESET_LEN); 
+
+    /* release buffer mutex */
+    xSemaphoreGive(cfg->mutex);
+ 
+    /* send it off to the strip */   
+    return ws2812_tx(cfg, delay);
+}
+
+int ws2812_send(ws2812_t *cfg, hsvValue_t hsv_values[],
+                unsigned int strip_len, uint16_t delay)
+{
+    uint32_t i;
+    uint8_t *bufp;
+    uint16_t len;
+    int result;
+    rgbValue_t rgb;
+
+    bufp = ws2812_lock_buff(cfg);
+    if(bufp == NULL){
         result = -1;
         goto err_out;
     }
-
-    bufp = &(cfg->dma_buff[0]);
     
     /* make sure that we do not exceed the buffer */
     len = min(strip_len, cfg->strip_len);
 
     /* copy pixel data into DMA buffer */
     for(i = 0; i < len; ++i){
-        hsv2rgb(&hsv_values[i], &rgb);
+        ws2812_hsv2rgb(&hsv_values[i], &rgb);
         bufp = rgb2pwm(bufp, rgb.green);
         bufp = rgb2pwm(bufp, rgb.red);
         bufp = rgb2pwm(bufp, rgb.blue);
     }
-    
-    /* turn unused pixels at end of strip off */ 
-    if(cfg->strip_len > len){
-        memset(bufp, WS_BITS_00, cfg->strip_len - len);
-        bufp += cfg->strip_len - len;
+
+    result = ws2812_flush_buff(cfg, bufp, len, delay);
+
+err_out:    
+    return result;
+}
+
+int ws2812_send_rgb(ws2812_t *cfg, rgbValue_t rgb_values[],
+                    unsigned int strip_len, uint16_t delay)
+{
+    uint32_t i;
+    uint8_t *bufp;
+    uint16_t len;
+    int result;
+
+    bufp = ws2812_lock_buff(cfg);
+    if(bufp == NULL){
+        result = -1;
+        goto err_out;
+    }
+    len = min(strip_len, cfg->strip_len);
+
+    for(i = 0; i < len; ++i){
+        bufp = rgb2pwm(bufp, rgb_values[i].green);
+        bufp = rgb2pwm(bufp, rgb_values[i].red);
+        bufp = rgb2pwm(bufp, rgb_values[i].blue);
     }
 
-    /* add reset pulse */
-    memset(bufp, 0x0, WS2812_RESET_LEN); 
+    result = ws2812_flush_buff(cfg, bufp, len, delay);
 
-    /* release buffer mutex */
-    xSemaphoreGive(cfg->mutex);
- 
-    /* send it off to the strip */   
-    result = ws2812_tx(cfg, delay);
+err_out:    
+    return result;
+}
+
+/* look up each pixel's colour in a 256 entry palette, rotated by shift */
+int ws2812_send_indexed(ws2812_t *cfg, const uint8_t index[],
+                        const rgbValue_t palette[], uint8_t shift,
+                        unsigned int strip_len, uint16_t delay)
+{
+    uint32_t i;
+    uint8_t *bufp;
+    uint16_t len;
+    int result;
+    const rgbValue_t *rgb;
+
+    bufp = ws2812_lock_buff(cfg);
+    if(bufp == NULL){
+        result = -1;
+        goto err_out;
+    }
+    len = min(strip_len, cfg->strip_len);
+
+    for(i = 0; i < len; ++i){
+        rgb = &palette[(uint8_t) (index[i] + shift)];
+        bufp = rgb2pwm(bufp, rgb->green);
+        bufp = rgb2pwm(bufp, rgb->red);
+        bufp = rgb2pwm(bufp, rgb->blue);
+    }
+
+    result = ws2812_flush_buff(cfg, bufp, len, delay);
 
 err_out:    
     return result;
@@ -255,8 +333,6 @@ err_out:
 ws2812_t *ws2812_init(uint16_t strip_len)
 {
     int result;
-    BaseType_t status;
-    uint32_t reset_off;
     ws2812_t *cfg;
 
     result = 0;
@@ -287,7 +363,9 @@ ws2812_t *ws2812_init(uint16_t strip_len)
     spi_init(&(cfg->spi_master), SPI0_MOSI, SPI0_MISO, SPI0_SCLK, SPI0_CS);
     spi_format(&(cfg->spi_master), 8, 3, 0);
     spi_frequency(&(cfg->spi_master), SCLK_FREQ);
-    spi_irq_hook(&(cfg->spi_master), master_tr_done_callback, (uint32_t)cfg);
+    /* ids are 32 bits wide in the SDK, as are pointers on the target */
+    spi_irq_hook(&(cfg->spi_master), master_tr_done_callback,
+                 (uint32_t) (uintptr_t) cfg);
 
     result = ws2812_set_len(cfg, strip_len);
     if(result != 0){
@@ -304,10 +382,7 @@ err_out:
             vEventGroupDelete(cfg->events);
         }
 
-        if(cfg->dma_buff != NULL){
-            free(cfg->dma_buff);
-        }
-
+        /* the DMA buffer is static, it must not be freed */
         free(cfg);
         cfg = NULL;
     }
@@ -341,10 +416,11 @@ int ws2812_set_len(ws2812_t *cfg, uint16_t strip_len)
         /* TODO: use dynamically allocated buffer */
         cfg->dma_buff = dma_buffer;
 
-        /* initialise LEDs to off and add reset pulse at end of strip */
+        /* initialise LEDs to off and add reset pulse at end of strip, the
+         * buffer is locked and not being sent */
         reset_off = WS2812_DMABUF_LEN(strip_len) - WS2812_RESET_LEN;
-        memset(&(cfg->dma_buff[0]), WS_BITS_00, reset_off);
-        memset(&(cfg->dma_buff[reset_off]), 0x0, WS2812_RESET_LEN);
+        memset(&dma_buffer[0], WS_BITS_00, reset_off);
+        memset(&dma_buffer[reset_off], 0x0, WS2812_RESET_LEN);
         cfg->strip_len = strip_len;
         cfg->buff_len = WS2812_DMABUF_LEN(strip_len);
     } else {
@@ -26,7 +26,9 @@
 #include "semphr.h"
 #include "event_groups.h"
 
+#ifndef WS2812_MAX_LEDS
 #define WS2812_MAX_LEDS         500
+#endif
 #define WS2812_RESET_LEN        (50 / 2)
 #define WS2812_DMABUF_LEN(x)    ((x) * 3 * 4 + WS2812_RESET_LEN)
 
@@ -60,8 +62,14 @@ typedef struct {
 extern ws2812_t *ws2812_init(uint16_t strip_len);
 extern int ws2812_set_len(ws2812_t *cfg, uint16_t strip_len);
 extern int ws2812_deinit(ws2812_t *cfg);
-extern int ws2812_update(ws2812_t *cfg, hsvValue_t hsv_values[],
-                         unsigned int strip_len, uint16_t delay);
+extern int ws2812_send(ws2812_t *cfg, hsvValue_t hsv_values[],
+                       unsigned int strip_len, uint16_t delay);
+extern int ws2812_send_rgb(ws2812_t *cfg, rgbValue_t rgb_values[],
+                           unsigned int strip_len, uint16_t delay);
+extern int ws2812_send_indexed(ws2812_t *cfg, const uint8_t index[],
+                               const rgbValue_t palette[], uint8_t shift,
+                               unsigned int strip_len, uint16_t delay);
+extern void ws2812_hsv2rgb(const hsvValue_t *hsv, rgbValue_t *rgb);
 
 /* scale uint8 value from range 2-255 to range 0-scale */
 static inline uint8_t scale(uint8_t value, uint8_t scale)
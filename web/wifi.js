@@ -0,0 +1,35 @@
+function onChangeSecType()
+{
+    x=document.getElementById("sec");
+    y=document.getElementById("pwd");
+    if(x.value == "open"){
+        y.style.display="none";
+    }else{
+        y.style.display="block";
+    }
+}
+
+function onSubmitForm()
+{
+    x=document.getElementById("Ssid");
+    y=document.getElementById("pwd");
+    z=document.getElementById("pwd_val");
+    if(x.value.length>32)
+    {
+        alert("SoftAP SSID is too long!(1-32)");
+        return false;
+    }
+    /*if(!(/^[A-Za-z0-9]+$/.test(x.value)))
+    {
+        alert("SoftAP SSID can only be [A-Za-z0-9]");
+        return false;
+    }*/
+    if(y.style.display == "block")
+    {
+        if((z.value.length < 8)||(z.value.length>32))
+        {
+            alert("Password length is between 8 to 32");
+            return false;
+        }
+    }
+}